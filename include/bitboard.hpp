@@ -0,0 +1,98 @@
+/**
+ * Hashlife
+ * Dense grid of cells of a fixed size, either wrapping around or surrounded
+ * by dead cells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "static_vector.hpp"
+
+namespace life {
+class thread_pool;
+class universe;
+
+enum class boundary {
+  torus, // Opposite edges are neighbours
+  dead   // Everything outside the board is dead, and stays dead
+};
+
+/**
+ * A universe of unbounded size cannot express a bounded one, such as a torus,
+ * so bounded universes are simulated directly on a bitboard instead. Each row
+ * is packed into 64-bit words, with the lowest bit of the first word being the
+ * leftmost cell, and advanced with the same adder network as cells::step().
+ * The loops over the words of a row are free of branches, so that compilers
+ * may vectorise them, and rows may be divided into bands that are computed by
+ * separate threads.
+ *
+ * Given a thread pool, each worker always computes the same band, and the
+ * board may be placed such that the memory of each band lies on the NUMA node
+ * of the worker computing it.
+ *
+ * The width of a board must be a multiple of 64 and its height a multiple of
+ * 8, so that boards consist of whole words and whole leaves of the quadtree.
+ */
+class bitboard {
+public:
+  bitboard(std::size_t width, std::size_t height,
+           boundary edges = boundary::torus);
+
+  static auto from(const universe &source, std::int64_t left, std::int64_t top,
+                   std::size_t width, std::size_t height,
+                   boundary edges = boundary::torus) -> bitboard;
+  void write_to(universe &target, std::int64_t left, std::int64_t top) const;
+
+  auto get(std::size_t x, std::size_t y) const -> bool;
+  void set(std::size_t x, std::size_t y, bool alive = true);
+  void step(std::size_t threads = 1);
+  void step(thread_pool &pool);
+  void advance(std::uint64_t generations, std::size_t threads = 1);
+  void advance(std::uint64_t generations, thread_pool &pool);
+  void place(thread_pool &pool);
+
+  auto width() const noexcept { return _width; }
+  auto height() const noexcept { return _height; }
+  auto edges() const noexcept { return _edges; }
+  auto generation() const noexcept { return _generation; }
+  auto population() const noexcept -> std::uint64_t;
+
+private:
+  auto row(std::size_t y) noexcept -> std::uint64_t * {
+    return _cells.data() + y * _words;
+  }
+  auto row(std::size_t y) const noexcept -> const std::uint64_t * {
+    return _cells.data() + y * _words;
+  }
+  void add_row(const std::uint64_t *cells, std::uint64_t *sum1,
+               std::uint64_t *sum2) const noexcept;
+  void step_rows(std::size_t begin, std::size_t end);
+  auto band(std::size_t worker, std::size_t workers) const noexcept
+      -> std::pair<std::size_t, std::size_t>;
+
+  std::size_t _width, _height;
+  std::size_t _words; // Words per row
+  boundary _edges;
+  static_vector<std::uint64_t> _cells;
+  static_vector<std::uint64_t> _next; // Next generation, while stepping
+  std::uint64_t _generation = 0;
+};
+} // namespace life
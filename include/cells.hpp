@@ -42,12 +42,15 @@ public:
   cells() noexcept = default;
   cells(const cells &) = default;
   cells(cells &&) = default;
+  auto operator=(const cells &) -> cells & = default;
+  auto operator=(cells &&) -> cells & = default;
 
   auto operator==(const cells &) const noexcept -> bool;
   auto operator!=(const cells &) const noexcept -> bool;
   auto hash() const noexcept -> std::size_t;
 
   auto operator()(std::size_t x, std::size_t y) const noexcept -> bool;
+  auto bits() const noexcept -> std::uint64_t { return bitmap; }
   auto next() const noexcept -> cells;
   auto step() const noexcept -> cells;
   auto population_count() const noexcept -> std::size_t;
@@ -62,6 +65,8 @@ public:
   static auto center(cells nw, cells ne, cells sw, cells se) noexcept -> cells;
   static auto horizontal(cells west, cells east) noexcept -> cells;
   static auto vertical(cells north, cells south) noexcept -> cells;
+  static auto combine(cells nw, cells ne, cells sw, cells se) noexcept
+      -> cells;
 
   /**
    * Default cells
@@ -69,12 +74,16 @@ public:
   static auto empty_square() noexcept { return cells{"$$$$$$$$"}; }
   static auto block() noexcept { return cells{"$$$...**...$...**...$$$$"}; }
   static auto beehive() noexcept { return cells{"$$$...**$..*..*$...**$$$"}; }
-  static auto loaf() noexcept { return cells{"$$..**$.*..*$..*.*$...*$$$"}; }
+  static auto loaf() noexcept {
+    return cells{"$$...**$..*..*$...*.*$....*$$$"};
+  }
   static auto boat() noexcept { return cells{"$$$..**$..*.*$...*$$$"}; }
   static auto tub() noexcept { return cells{"$$$...*$..*.*$...*$$$"}; }
   static auto blinker() noexcept { return cells{"$$.***$$$$$$"}; }
   static auto toad() noexcept { return cells{"$$$...***$..***$$$$"}; }
-  static auto beacon() noexcept { return cells{"$$**$**$..**$..**$$$"}; }
+  static auto beacon() noexcept {
+    return cells{"$$..**$..**$....**$....**$$$"};
+  }
   static auto glider() noexcept { return cells{"$$...*$..*$..***$$$$"}; }
   static auto filled() noexcept { return cells{0xffffffffffffffffull}; }
 
@@ -0,0 +1,71 @@
+/**
+ * Hashlife
+ * Append-only log of the nodes created in between checkpoints, from which
+ * the tree can be recovered.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cells.hpp"
+
+namespace life {
+class snapshot;
+
+/**
+ * Hash-consed nodes never change, apart from their memoized futures, so a
+ * node only has to be written once. Nodes are numbered per level in order of
+ * writing, and refer to their children by those numbers, which therefore
+ * have to be written first. Futures are written as separate links.
+ * The first checkpoint of a log writes the entire tree, and so serves as its
+ * base snapshot; each later checkpoint only adds the nodes and links that are
+ * new since, followed by the root, whose record completes the checkpoint.
+ *
+ * Replaying a log recovers the tree as of its last complete checkpoint, so a
+ * log that was cut short while writing is still usable.
+ */
+class checkpoint_log {
+public:
+  explicit checkpoint_log(std::string path);
+
+  auto append(cells leaf) -> std::uint32_t;
+  auto append(std::size_t level, const std::array<std::uint32_t, 4> &children)
+      -> std::uint32_t;
+  void link(std::size_t level, std::uint32_t node, std::uint32_t next);
+  void commit(std::size_t level, std::uint32_t root, std::uint64_t generation);
+
+  auto path() const noexcept -> const std::string & { return _path; }
+  auto checkpoints() const noexcept { return _checkpoints; }
+  auto size() const noexcept -> std::size_t;
+
+  static auto replay(const std::string &path) -> snapshot;
+
+private:
+  template <typename... Words> void write(char tag, Words... words);
+
+  std::string _path;
+  std::ofstream _file;
+  std::vector<std::uint32_t> _written; // Number of nodes written per level
+  std::size_t _checkpoints = 0;
+};
+} // namespace life
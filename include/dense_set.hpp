@@ -1,8 +1,8 @@
 /**
  * Hashlife
  * Hash table based set implementation, meant for fast insertion.
- * Based on the premise that insertion is allowed to fail, and that no
- * deletions occur. This allows us to neglect tombstones, and mean we have no
+ * Based on the premise that insertion is allowed to fail, and that deletions
+ * are rare. This allows us to get away with tombstones, and mean we have no
  * need for robin-hood-like reordering techniques.
  *
  * Copyright 2020 Quinten van Woerkom
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
@@ -31,10 +32,10 @@
 
 /**
  * Hashlife requires a rather specialized hash table, requiring open addressing
- * and stability of reference. In addition, the knowledge that no deletions
- * occur (in principle garbage cleaning is necessary, but better implemented
- * as a full hash table reset) can be exploited since no tombstones are
- * necessary.
+ * and stability of reference. In addition, the knowledge that deletions are
+ * rare (garbage cleaning is mostly better implemented as a full hash table
+ * reset) can be exploited: erased elements just leave a tombstone behind,
+ * which may be reused by later insertions but is only removed by a reset.
  */
 template <typename Key, typename Hash = std::hash<Key>,
           typename KeyEqual = std::equal_to<Key>>
@@ -108,15 +109,23 @@ private:
      * (non-)existence of the currently pointed-to object.
      */
     constexpr auto empty() const noexcept {
-      return owner->_sentinels[index].empty();
+      return owner->_sentinels[index].empty(owner->_epoch);
+    }
+
+    constexpr auto vacant() const noexcept {
+      return !owner->_sentinels[index].filled(owner->_epoch);
+    }
+
+    constexpr auto erased() const noexcept {
+      return owner->_sentinels[index].erased(owner->_epoch);
     }
 
     constexpr auto matches(size_type reduced_hash) const noexcept {
-      return owner->_sentinels[index].matches(reduced_hash);
+      return owner->_sentinels[index].matches(reduced_hash, owner->_epoch);
     }
 
     constexpr void colonize(hash_type reduced_hash) const noexcept {
-      owner->_sentinels[index].colonize(reduced_hash);
+      owner->_sentinels[index].colonize(reduced_hash, owner->_epoch);
     }
 
     constexpr auto contains(const Key &key) const noexcept {
@@ -165,7 +174,7 @@ public:
      */
     constexpr auto operator++() noexcept -> iterator_implementation & {
       ++inner;
-      while (inner.empty())
+      while (inner.vacant())
         ++inner;
       return *this;
     }
@@ -215,7 +224,7 @@ public:
   /**************************************************************************
    * Constructors
    */
-  dense_set(size_type count);
+  dense_set(size_type count, size_type probe_limit = 10);
   dense_set(const dense_set &) = default;
   constexpr dense_set(dense_set &&) = default;
 
@@ -245,17 +254,23 @@ public:
   constexpr auto empty() const noexcept { return _size == 0; }
   constexpr auto size() const noexcept { return _size; }
   constexpr auto capacity() const noexcept { return _elements.capacity(); }
+  constexpr auto probe_limit() const noexcept { return _probe_limit; }
+  constexpr auto tombstones() const noexcept { return _tombstones; }
+  constexpr auto data() const noexcept { return _elements.data(); }
 
   /**************************************************************************
    * Modifiers
    */
   void clear() noexcept;
+  void erase(size_type index) noexcept;
   auto insert(const value_type &value) noexcept -> std::pair<iterator, bool> {
     return emplace(value);
   };
   auto insert(value_type &&value) noexcept -> std::pair<iterator, bool> {
     return emplace(std::move(value));
   };
+  auto insert(const value_type &value, size_type probe_limit) noexcept
+      -> std::pair<iterator, bool>;
   void swap(dense_set &&other) noexcept(is_nothrow_swappable) {
     std::swap(*this, other);
   }
@@ -270,16 +285,7 @@ public:
     if (location != end())
       return {location, false};
 
-    location = iterator{*this, hash % capacity()};
-    auto free_location = probe(location);
-
-    if (free_location == end())
-      return {location, false};
-
-    free_location.colonize(reduced_hash);
-    *free_location = std::move(object);
-    ++_size;
-    return {location, true};
+    return colonize(std::move(object), hash, reduced_hash, _probe_limit);
   }
 
   /**************************************************************************
@@ -291,50 +297,73 @@ public:
   auto find(const Key &key) noexcept -> iterator;
   auto find(const Key &key) const noexcept -> const_iterator;
   auto contains(const Key &key) const noexcept -> bool;
+  auto filled(size_type index) const noexcept -> bool;
 
 private:
   auto find(const Key &key, hash_type hash, hash_type reduced_hash) noexcept
       -> iterator;
   auto find(const Key &key, hash_type hash, hash_type reduced_hash) const
       noexcept -> const_iterator;
-  auto probe(inner_iterator<false> start) noexcept -> inner_iterator<false>;
-  auto probe(inner_iterator<false> start) const noexcept
+  auto probe(inner_iterator<false> start, size_type probe_limit) noexcept
+      -> inner_iterator<false>;
+  auto probe(inner_iterator<false> start, size_type probe_limit) const noexcept
       -> inner_iterator<true>;
+  auto colonize(Key &&object, hash_type hash, hash_type reduced_hash,
+                size_type probe_limit) noexcept -> std::pair<iterator, bool>;
 
   /**
    * Piece of metadata that stores whether or not an element is present at a
    * location, and the 7 high bits of the hash, if this is the case.
    * This allows for faster comparison by also allowing hash-comparison
    * without actually entering the table.
+   * Metadata written in an earlier epoch than the current one of the set is
+   * stale, and counts as never having been used at all.
    */
   class sentinel {
   public:
-    constexpr sentinel() noexcept : _filled{false}, _reduced_hash{0x00} {}
-    void colonize(hash_type reduced_hash) noexcept;
-    bool filled() const noexcept { return _filled; }
-    bool empty() const noexcept { return !filled(); }
-    bool matches(hash_type reduced_hash) const noexcept;
+    constexpr sentinel() noexcept
+        : _epoch{0}, _filled{false}, _erased{false}, _reduced_hash{0x00} {}
+    void colonize(hash_type reduced_hash, std::uint8_t epoch) noexcept;
+    void erase() noexcept;
+    bool filled(std::uint8_t epoch) const noexcept {
+      return _epoch == epoch && _filled;
+    }
+    bool erased(std::uint8_t epoch) const noexcept {
+      return _epoch == epoch && _erased;
+    }
+    bool empty(std::uint8_t epoch) const noexcept {
+      return !filled(epoch) && !erased(epoch);
+    }
+    bool matches(hash_type reduced_hash, std::uint8_t epoch) const noexcept;
 
   private:
+    std::uint8_t _epoch;
     bool _filled : 1;
+    bool _erased : 1;
     hash_type _reduced_hash : 7;
   };
 
   static_vector<Key> _elements;
   static_vector<sentinel> _sentinels;
   size_type _size = 0;
+  size_type _tombstones = 0;
+  size_type _probe_limit;
+  std::uint8_t _epoch = 0;
 };
 
 /******************************************************************************
  * Constructors
  */
 /**
- * Constructs an empty hash table of size <count>.
+ * Constructs an empty hash table of size <count>, in which insertions give up
+ * after visiting <probe_limit> occupied spots.
  * Note that all sentinels must be value-initialized.
  */
 template <typename Key, typename Hash, typename KeyEqual>
-dense_set<Key, Hash, KeyEqual>::dense_set(std::size_t count)
-    : _elements{count}, _sentinels{count, sentinel{}} {
+dense_set<Key, Hash, KeyEqual>::dense_set(std::size_t count,
+                                          std::size_t probe_limit)
+    : _elements{count}, _sentinels{count, sentinel{}},
+      _probe_limit{probe_limit} {
   if (count <= 0)
     throw std::domain_error{"dense_set: element counts equal to or smaller "
                             "than 0 are not supported."};
@@ -351,7 +380,7 @@ template <typename Key, typename Hash, typename KeyEqual>
 auto dense_set<Key, Hash, KeyEqual>::operator[](std::size_t index) noexcept
     -> Key & {
   assert(index < capacity() && "dense_set: Index access out of bound");
-  assert(_sentinels[index].filled() &&
+  assert(_sentinels[index].filled(_epoch) &&
          "dense_set: Trying to access non-existent element");
   return _elements[index];
 }
@@ -364,7 +393,7 @@ template <typename Key, typename Hash, typename KeyEqual>
 auto dense_set<Key, Hash, KeyEqual>::operator[](std::size_t index) const
     noexcept -> const Key & {
   assert(index < capacity() && "dense_set: Index access out of bound");
-  assert(_sentinels[index].filled() &&
+  assert(_sentinels[index].filled(_epoch) &&
          "dense_set: Trying to access non-existent element");
   return _elements[index];
 }
@@ -430,7 +459,7 @@ template <typename Key, typename Hash, typename KeyEqual>
 auto dense_set<Key, Hash, KeyEqual>::find(const Key &key, hash_type hash,
                                           hash_type reduced_hash) const noexcept
     -> const_iterator {
-  return const_cast<dense_set *>(this)->find(key, hash, hash_type);
+  return const_cast<dense_set *>(this)->find(key, hash, reduced_hash);
 }
 
 /**
@@ -443,38 +472,110 @@ auto dense_set<Key, Hash, KeyEqual>::contains(const Key &key) const noexcept
 }
 
 /**
- * Finds the first free location at or after a given index.
- * If none can be found within 10 (or capacity()) spots, fails and returns the
- * end iterator.
+ * Checks if the spot at the given index is occupied by an element.
+ * Allows for traversal of all elements by index.
  */
 template <typename Key, typename Hash, typename KeyEqual>
-auto dense_set<Key, Hash, KeyEqual>::probe(inner_iterator<false> start) noexcept
+auto dense_set<Key, Hash, KeyEqual>::filled(size_type index) const noexcept
+    -> bool {
+  assert(index < capacity() && "dense_set: Index access out of bound");
+  return _sentinels[index].filled(_epoch);
+}
+
+/**
+ * Finds the first free location at or after a given index, which may be a
+ * tombstone left behind by an erased element.
+ * If none can be found within <probe_limit> (or capacity()) spots, fails and
+ * returns the end iterator.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto dense_set<Key, Hash, KeyEqual>::probe(inner_iterator<false> start,
+                                           size_type probe_limit) noexcept
     -> inner_iterator<false> {
-  auto spots_visited = 0;
+  auto spots_visited = 0u;
   auto current = start;
 
   do {
-    if (current.empty())
+    if (current.vacant())
       return current;
     ++current, ++spots_visited;
-  } while (current != start && spots_visited != 10);
+  } while (current != start && spots_visited != probe_limit);
 
   return end();
 }
 
 template <typename Key, typename Hash, typename KeyEqual>
-auto dense_set<Key, Hash, KeyEqual>::probe(inner_iterator<false> start) const
-    noexcept -> inner_iterator<true> {
-  return const_cast<dense_set *>(this)->probe(start);
+auto dense_set<Key, Hash, KeyEqual>::probe(inner_iterator<false> start,
+                                           size_type probe_limit) const noexcept
+    -> inner_iterator<true> {
+  return const_cast<dense_set *>(this)->probe(start, probe_limit);
+}
+
+/**
+ * Stores <object>, which is known not to be present yet, in the first free
+ * spot of its probe sequence.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto dense_set<Key, Hash, KeyEqual>::colonize(Key &&object, hash_type hash,
+                                              hash_type reduced_hash,
+                                              size_type probe_limit) noexcept
+    -> std::pair<iterator, bool> {
+  auto location = iterator{*this, hash % capacity()};
+  auto free_location = probe(location, probe_limit);
+
+  if (free_location == end())
+    return {end(), false};
+
+  if (free_location.erased())
+    --_tombstones;
+  free_location.colonize(reduced_hash);
+  *free_location = std::move(object);
+  ++_size;
+  return {free_location, true};
+}
+
+/**
+ * Inserts <value> like insert(), but gives up only after visiting
+ * <probe_limit> occupied spots instead of probe_limit() of them.
+ * Used for bulk insertions that must not fail while there is room left.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto dense_set<Key, Hash, KeyEqual>::insert(const value_type &value,
+                                            size_type probe_limit) noexcept
+    -> std::pair<iterator, bool> {
+  auto object = value;
+  auto hash = hasher()(object);
+  auto reduced_hash = (std::uint8_t)(hash >> (8 * sizeof(hash) - 7)) & 0xef;
+
+  auto location = find(object, hash, reduced_hash);
+  if (location != end())
+    return {location, false};
+  return colonize(std::move(object), hash, reduced_hash, probe_limit);
 }
 
 /**
- * Clears all elements by resetting the sentinels.
- * Allows for fast resetting of the hash table.
+ * Clears all elements in constant time, by moving on to the next epoch: all
+ * sentinels written in earlier epochs are thereby invalidated at once.
+ * Only once the epoch counter wraps around are the sentinels actually reset.
  */
 template <typename Key, typename Hash, typename KeyEqual>
 void dense_set<Key, Hash, KeyEqual>::clear() noexcept {
-  std::fill(_sentinels.begin(), _sentinels.end(), sentinel{});
+  if (++_epoch == 0)
+    std::fill(_sentinels.begin(), _sentinels.end(), sentinel{});
+  _size = 0;
+  _tombstones = 0;
+}
+
+/**
+ * Erases the element at the given index, leaving a tombstone behind so that
+ * lookups of elements further along the probe sequence keep working.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+void dense_set<Key, Hash, KeyEqual>::erase(size_type index) noexcept {
+  assert(filled(index) && "dense_set: Trying to erase non-existent element");
+  _sentinels[index].erase();
+  --_size;
+  ++_tombstones;
 }
 
 /**
@@ -483,17 +584,28 @@ void dense_set<Key, Hash, KeyEqual>::clear() noexcept {
  */
 template <typename Key, typename Hash, typename KeyEqual>
 void dense_set<Key, Hash, KeyEqual>::sentinel::colonize(
-    hash_type reduced_hash) noexcept {
+    hash_type reduced_hash, std::uint8_t epoch) noexcept {
+  _epoch = epoch;
   _filled = true;
+  _erased = false;
   _reduced_hash = reduced_hash;
 }
 
+/**
+ * Marks the spot guarded by this metadata as a tombstone.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+void dense_set<Key, Hash, KeyEqual>::sentinel::erase() noexcept {
+  _filled = false;
+  _erased = true;
+}
+
 /**
  * Returns true if the spot is occupied and contains an object with a
  * similar (i.e. same 7 high bits) hash.
  */
 template <typename Key, typename Hash, typename KeyEqual>
 bool dense_set<Key, Hash, KeyEqual>::sentinel::matches(
-    hash_type reduced_hash) const noexcept {
-  return filled() && _reduced_hash == reduced_hash;
+    hash_type reduced_hash, std::uint8_t epoch) const noexcept {
+  return filled(epoch) && _reduced_hash == reduced_hash;
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**
+ * Hashlife
+ * Content hashes of nodes, identical across runs and processes.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "cells.hpp"
+#include "hash.hpp"
+
+namespace life {
+/**
+ * Pointers are only meaningful within the layers of one universe, but a
+ * digest identifies a node by its contents: leaves are hashed from their
+ * bitmaps, and macrocells from the digests of their quadrants, as in a Merkle
+ * tree. Equal subtrees therefore have equal digests in every run.
+ *
+ * The 128 bits are computed as two independently seeded 64-bit lanes, which
+ * makes accidental collisions vanishingly unlikely; digests are not meant to
+ * withstand deliberately crafted collisions. The all-zero digest is reserved
+ * to mean "unknown", much like the null pointer.
+ */
+class digest {
+public:
+  constexpr digest() noexcept = default;
+  constexpr digest(std::uint64_t high, std::uint64_t low) noexcept
+      : _high{high}, _low{low} {}
+
+  static auto of(cells leaf) noexcept -> digest {
+    return digest{mix(leaf_seed[0] ^ leaf.bits()),
+                  mix(leaf_seed[1] + leaf.bits())}
+        .known();
+  }
+
+  static constexpr auto of(const std::array<digest, 4> &quadrants) noexcept
+      -> digest {
+    auto high = node_seed[0], low = node_seed[1];
+    for (const auto &quadrant : quadrants) {
+      high = mix(high ^ quadrant._high) + quadrant._low;
+      low = mix(low + quadrant._low) ^ quadrant._high;
+    }
+    return digest{mix(high), mix(low)}.known();
+  }
+
+  constexpr auto high() const noexcept { return _high; }
+  constexpr auto low() const noexcept { return _low; }
+
+  constexpr operator bool() const noexcept { return _high != 0 || _low != 0; }
+  constexpr bool operator==(const digest &other) const noexcept {
+    return _high == other._high && _low == other._low;
+  }
+  constexpr bool operator!=(const digest &other) const noexcept {
+    return !(*this == other);
+  }
+  constexpr auto hash() const noexcept { return std::size_t(_low); }
+
+private:
+  static constexpr std::uint64_t leaf_seed[2] = {0x243f6a8885a308d3,
+                                                 0x13198a2e03707344};
+  static constexpr std::uint64_t node_seed[2] = {0xa4093822299f31d0,
+                                                 0x082efa98ec4e6c89};
+
+  /**
+   * Finalizer of splitmix64: every input bit affects every output bit.
+   */
+  static constexpr auto mix(std::uint64_t x) noexcept -> std::uint64_t {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+  }
+
+  constexpr auto known() const noexcept -> digest {
+    return *this ? *this : digest{0, 1};
+  }
+
+  std::uint64_t _high = 0;
+  std::uint64_t _low = 0;
+};
+} // namespace life
+
+HASHLIFE_DEFINE_HASH(life::digest);
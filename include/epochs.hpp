@@ -0,0 +1,60 @@
+/**
+ * Hashlife
+ * Epoch-based reclamation of memory that concurrent readers may still see.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace life {
+/**
+ * Readers that traverse memory owned by a writer on another thread pin the
+ * current epoch for as long as they do so. Whenever the writer replaces some
+ * memory, it retires the old copy under the current epoch and moves on to
+ * the next one; retired memory is freed only once no reader that pinned that
+ * epoch or an earlier one remains, as only those can still have seen it.
+ * Readers never wait on the writer: pinning and unpinning only briefly take
+ * a lock, and nothing at all is locked in between.
+ */
+class epochs {
+public:
+  auto pin() -> std::uint64_t;
+  void unpin(std::uint64_t ticket);
+  auto pinned(std::uint64_t ticket) const -> bool;
+  auto readers() const -> std::size_t;
+
+  void retire(std::shared_ptr<void> garbage);
+  auto retired() const -> std::size_t;
+  auto epoch() const -> std::uint64_t;
+
+private:
+  void reclaim();
+
+  mutable std::mutex _mutex;
+  std::uint64_t _epoch = 0;
+  std::uint64_t _tickets = 0;
+  std::map<std::uint64_t, std::uint64_t> _readers; // Ticket to pinned epoch
+  std::vector<std::pair<std::uint64_t, std::shared_ptr<void>>> _retired;
+};
+} // namespace life
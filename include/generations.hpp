@@ -0,0 +1,120 @@
+/**
+ * Hashlife
+ * Multi-state cell squares, following the rules of the Generations family.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "cells.hpp"
+#include "hash.hpp"
+
+namespace life {
+/**
+ * Rule of the Generations family: cells are either dead (state 0), alive
+ * (state 1), or dying (states 2 up to the number of states). Dead cells are
+ * born if their number of living neighbours is in the birth set, living cells
+ * stay alive if it is in the survival set, and all other living cells start
+ * dying. Dying cells age by one state each generation, until they die, and
+ * neither count as living neighbours nor can be born again in the meantime.
+ * With two states, these are the ordinary life-like rules.
+ */
+class generations_rule {
+public:
+  static constexpr std::size_t max_states = 256;
+
+  generations_rule(std::uint16_t birth, std::uint16_t survival,
+                   std::size_t states);
+  static auto parse(std::string_view rule) -> generations_rule;
+
+  static auto conway() { return generations_rule{1u << 3, 3u << 2, 2}; }
+  static auto brians_brain() { return generations_rule{1u << 2, 0, 3}; }
+  static auto star_wars() { return generations_rule{1u << 2, 7u << 3, 4}; }
+
+  auto operator==(const generations_rule &other) const noexcept -> bool;
+  auto birth() const noexcept { return _birth; }       // Bit n: n neighbours
+  auto survival() const noexcept { return _survival; } // Bit n: n neighbours
+  auto states() const noexcept { return _states; }
+  auto planes() const noexcept { return _planes; } // Bits per state
+
+private:
+  std::uint16_t _birth, _survival;
+  std::size_t _states, _planes;
+};
+
+/**
+ * Square of 8x8 cells with multiple states, stored as bit planes: plane n
+ * holds bit n of the state of every cell, laid out as in cells. Equality and
+ * hashing cover all planes, so that squares can be hash-consed as leaves.
+ *
+ * Transitions are computed for all 64 cells at once by a bit-sliced kernel:
+ * neighbours are counted by the same adders as in cells, and dying cells are
+ * aged by rippling a carry through the planes. As with cells, only the inner
+ * 6x6 cells of a step can be determined from the square alone.
+ */
+class state_cells {
+public:
+  static constexpr std::size_t max_planes = 8;
+  using planes_type = std::array<std::uint64_t, max_planes>;
+
+  state_cells() noexcept = default;
+  explicit state_cells(const planes_type &planes) noexcept
+      : _planes{planes} {}
+  explicit state_cells(cells alive) noexcept : _planes{alive.bits()} {}
+
+  auto operator==(const state_cells &other) const noexcept -> bool;
+  auto operator!=(const state_cells &other) const noexcept -> bool;
+  auto hash() const noexcept -> std::size_t;
+
+  auto operator()(std::size_t x, std::size_t y) const noexcept
+      -> std::uint8_t;
+  auto with(std::size_t x, std::size_t y, std::uint8_t state) const noexcept
+      -> state_cells;
+  auto plane(std::size_t index) const noexcept { return _planes[index]; }
+  auto alive() const noexcept -> cells;
+  auto occupied() const noexcept -> cells;
+  auto population_count() const noexcept -> std::size_t;
+  auto empty() const noexcept -> bool;
+
+  auto step(const generations_rule &rule) const noexcept -> state_cells;
+  auto next(const generations_rule &rule) const noexcept -> state_cells;
+
+  static auto center(const state_cells &nw, const state_cells &ne,
+                     const state_cells &sw, const state_cells &se) noexcept
+      -> state_cells;
+  static auto horizontal(const state_cells &west,
+                         const state_cells &east) noexcept -> state_cells;
+  static auto vertical(const state_cells &north,
+                       const state_cells &south) noexcept -> state_cells;
+  static auto combine(const state_cells &nw, const state_cells &ne,
+                      const state_cells &sw, const state_cells &se) noexcept
+      -> state_cells;
+
+private:
+  template <typename Function>
+  static auto planewise(Function &&function) noexcept -> state_cells;
+  auto equals(std::size_t state) const noexcept -> std::uint64_t;
+
+  planes_type _planes = {};
+};
+} // namespace life
+
+HASHLIFE_DEFINE_HASH(life::state_cells);
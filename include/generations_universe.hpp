@@ -0,0 +1,78 @@
+/**
+ * Hashlife
+ * A universe of multi-state cells, following a rule of the Generations
+ * family, stored as a quadtree of hash-consed macrocells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "generations.hpp"
+#include "hashlife_engine.hpp"
+#include "layer.hpp"
+
+namespace life {
+/**
+ * The multi-state counterpart of universe: leaves are state_cells rather than
+ * cells, hash-consed over all of their planes, and advanced by the kernel of
+ * the rule given on construction. Everything above the leaves is the same
+ * quadtree of macrocells, with the same memoized next() and step() results,
+ * so that multi-state patterns see the same speedups.
+ *
+ * Nodes are never freed, and layers grow in between computations as in an
+ * unmanaged universe.
+ */
+class generations_universe {
+public:
+  explicit generations_universe(generations_rule rule);
+
+  auto get(std::int64_t x, std::int64_t y) const -> std::uint8_t;
+  void set(std::int64_t x, std::int64_t y, std::uint8_t state);
+  void advance(std::uint64_t generations) { _engine.advance(generations); }
+
+  auto rule() const noexcept -> const generations_rule & {
+    return _engine.kernel().rule;
+  }
+  auto generation() const noexcept { return _engine.generation(); }
+  auto level() const noexcept { return _engine.level(); }
+  auto population() const -> std::uint64_t { return _engine.population(); }
+  auto statistics() const -> std::vector<layer_statistics> {
+    return _engine.statistics();
+  }
+
+private:
+  /**
+   * Advances nodes of level 1 by combining the transitions of their leaves.
+   */
+  struct kernel {
+    using leaf_type = state_cells;
+
+    auto base_level() const noexcept -> std::size_t { return 1; }
+    auto base_reach() const noexcept -> std::uint64_t { return 4; }
+    auto range() const noexcept -> std::uint64_t { return 1; }
+    auto advance(hashlife_engine<kernel> &engine, pointer node,
+                 std::uint64_t generations) const -> pointer;
+
+    generations_rule rule;
+  };
+
+  hashlife_engine<kernel> _engine;
+};
+} // namespace life
@@ -0,0 +1,832 @@
+/**
+ * Hashlife
+ * The hashlife recursion over a quadtree of hash-consed macrocells, shared by
+ * universes whose leaves and rules differ.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cells.hpp"
+#include "layer.hpp"
+#include "macrocell.hpp"
+#include "static_vector.hpp"
+
+namespace life {
+/**
+ * Number of next() and step() results that were found memoized, whether in
+ * a macrocell or in the result cache, and that had to be computed.
+ */
+struct memo_statistics {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+};
+
+/**
+ * Everything of hashlife that depends neither on what a leaf holds, nor on
+ * the rule, nor on how nodes are managed: hash-consing of macrocells into a
+ * layer per level, the memoized next() and step() recursion over nine
+ * subnodes, expansion of the root, and growth of the layers that overflow.
+ * Both universe and hashlife_engine are built on it.
+ *
+ * <Tree> derives from hashlife_tree and supplies the base of the recursion:
+ *  base_level():    lowest level whose nodes the tree advances itself.
+ *  base_reach():    number of generations, a power of two, by which next()
+ *                   advances nodes of the base level.
+ *  range():         distance that information travels per generation.
+ *  advance_base():  center half of a node of the base level, advanced by a
+ *                   power of two generations of at most base_reach().
+ * Every level above the base level advances twice as far as the one below.
+ *
+ * Trees may hide the following with their own, to keep nodes or results
+ * elsewhere, or to manage them otherwise; the defaults are those of nodes
+ * that are never freed:
+ *  fetch():         copy of a node or leaf.
+ *  opened():        prepares the layer of a level that is first used.
+ *  memoized_next(), memoize_next(), memoized_step(), memoize_step() and
+ *  forget_steps():  where results are memoized.
+ *  recall(), record(): results kept outside the tree, looked up before a
+ *                   node is computed and added afterwards.
+ *  evaluate():      called for every node that is computed.
+ *  dispatch():      called with the nodes about to be advanced by next().
+ *  for_each_root(): every root, which moves along with its layer.
+ *  relocated():     called with the new locations of a layer that moved.
+ *  completed(), recover(): called after a computation completes, and after
+ *                   an attempt at it overflowed a layer.
+ */
+template <typename Tree, typename Leaf> class hashlife_tree {
+public:
+  using leaf_type = Leaf;
+
+  auto generation() const noexcept { return _generation; }
+  auto level() const noexcept { return _level; }
+  auto statistics() const -> std::vector<layer_statistics>;
+  auto memo_usage() const noexcept -> memo_statistics { return _memo; }
+
+  static constexpr auto side(std::size_t level) noexcept -> std::int64_t {
+    return std::int64_t{cells::columns} << level;
+  }
+
+protected:
+  hashlife_tree(lifetime mode, std::size_t level);
+
+  auto nodes(std::size_t level) -> layer<macrocell> &;
+  auto nodes(std::size_t level) const -> const layer<macrocell> &;
+  auto make(const Leaf &leaf) -> pointer;
+  auto make(std::size_t level, pointer nw, pointer ne, pointer sw, pointer se)
+      -> pointer;
+  auto empty(std::size_t level) -> pointer;
+  void retain(std::size_t level, pointer node) noexcept;
+  void release(std::size_t level, pointer node);
+  void replace_root(std::size_t level, pointer root);
+
+  auto subnodes(std::size_t level, pointer node) -> std::array<pointer, 9>;
+  auto center(std::size_t level, pointer node) -> pointer;
+  auto horizon(std::size_t level) const noexcept -> std::size_t;
+  auto next(std::size_t level, pointer node) -> pointer;
+  auto step(std::size_t level, pointer node) -> pointer;
+  void set_step(std::size_t exponent);
+  void jump(std::size_t exponent);
+
+  auto contains(std::int64_t x, std::int64_t y) const noexcept -> bool;
+  auto centered() -> bool;
+  void expand();
+  auto expanded(std::size_t level, pointer node) -> pointer;
+
+  template <typename Function> void guarded(Function &&function);
+  auto grow() -> bool;
+  void rehash(std::size_t level, std::size_t capacity);
+
+  // Defaults of what trees may hide
+  auto fetch(std::size_t level, pointer node) -> macrocell {
+    return nodes(level)[node];
+  }
+  auto fetch(pointer leaf) -> Leaf { return _leaves[leaf]; }
+  void opened(std::size_t, layer<macrocell> &) {}
+  auto memoized_next(std::size_t level, pointer node) -> pointer {
+    return self().fetch(level, node).next();
+  }
+  auto memoize_next(std::size_t level, pointer node, pointer result)
+      -> pointer;
+  auto memoized_step(std::size_t level, pointer node) -> pointer {
+    return self().fetch(level, node).step();
+  }
+  auto memoize_step(std::size_t level, pointer node, pointer result)
+      -> pointer;
+  void forget_steps();
+  auto recall(std::size_t, pointer, std::size_t) -> pointer {
+    return nullptr;
+  }
+  void record(std::size_t, pointer, std::size_t, pointer) {}
+  void evaluate() {}
+  void dispatch(std::size_t, std::initializer_list<pointer>) {}
+  template <typename Function> void for_each_root(Function &&function) {
+    if (_root)
+      function(_level, _root);
+  }
+  void relocated(std::size_t, const static_vector<pointer> &) {}
+  void completed() {}
+  auto recover(std::size_t) -> bool { return grow(); }
+
+  lifetime _mode;
+  layer<Leaf> _leaves;
+  std::vector<layer<macrocell>> _nodes; // Level n is stored at n - 1
+  std::vector<pointer> _empty;          // Empty node of each level
+  pointer _root;
+  std::size_t _level;
+  std::size_t _step = 0; // Memoized step() results advance 2^_step
+  std::uint64_t _generation = 0;
+  memo_statistics _memo;
+
+private:
+  auto self() noexcept -> Tree & { return static_cast<Tree &>(*this); }
+  auto self() const noexcept -> const Tree & {
+    return static_cast<const Tree &>(*this);
+  }
+};
+
+/**
+ * Hashlife of any leaf and rule, the rule being given by a kernel that
+ * supplies the base of the recursion:
+ *  leaf_type:    squares of 8x8 cells stored at level 0, with the static
+ *                center(), horizontal() and vertical() of cells.
+ *  base_level(), base_reach(), range() and advance(), the latter being
+ *                passed the engine, as those of hashlife_tree.
+ * Nodes are never freed, and layers grow in between computations as in an
+ * unmanaged universe.
+ */
+template <typename Kernel>
+class hashlife_engine
+    : public hashlife_tree<hashlife_engine<Kernel>,
+                           typename Kernel::leaf_type> {
+  using tree = hashlife_tree<hashlife_engine<Kernel>,
+                             typename Kernel::leaf_type>;
+  friend tree;
+
+public:
+  using leaf_type = typename Kernel::leaf_type;
+  using state_type = decltype(std::declval<const leaf_type &>()(0, 0));
+
+  explicit hashlife_engine(Kernel kernel);
+
+  auto get(std::int64_t x, std::int64_t y) const -> state_type;
+  template <typename Update>
+  void set(std::int64_t x, std::int64_t y, Update &&update);
+  void advance(std::uint64_t generations);
+
+  auto kernel() const noexcept -> const Kernel & { return _kernel; }
+  auto population() const -> std::uint64_t;
+
+  // Building blocks for the kernel
+  auto leaf(pointer node) const -> const leaf_type & {
+    return this->_leaves[node];
+  }
+  using tree::make;
+  using tree::nodes;
+  using tree::subnodes;
+
+private:
+  auto base_level() const noexcept -> std::size_t {
+    return _kernel.base_level();
+  }
+  auto base_reach() const noexcept -> std::uint64_t {
+    return _kernel.base_reach();
+  }
+  auto range() const noexcept -> std::uint64_t { return _kernel.range(); }
+  auto advance_base(pointer node, std::uint64_t generations) -> pointer {
+    return _kernel.advance(*this, node, generations);
+  }
+
+  auto get(std::size_t level, pointer node, std::uint64_t x,
+           std::uint64_t y) const -> state_type;
+  template <typename Update>
+  auto set(std::size_t level, pointer node, std::uint64_t x, std::uint64_t y,
+           Update &update) -> pointer;
+  auto population(std::size_t level, pointer node,
+                  std::vector<static_vector<std::uint64_t>> &cache) const
+      -> std::uint64_t;
+
+  Kernel _kernel;
+};
+
+template <typename Tree, typename Leaf>
+hashlife_tree<Tree, Leaf>::hashlife_tree(lifetime mode, std::size_t level)
+    : _mode{mode}, _leaves{layer_policy::for_level(0), mode}, _level{level} {}
+
+/**
+ * Returns the usage statistics of all layers, indexed by level.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::statistics() const
+    -> std::vector<layer_statistics> {
+  auto result = std::vector<layer_statistics>{_leaves.statistics()};
+  for (const auto &layer : _nodes)
+    result.push_back(layer.statistics());
+  return result;
+}
+
+/**
+ * Returns the layer of the given level, which must be at least 1.
+ * Layers are created on first use, so that the tree can keep on growing.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::nodes(std::size_t level)
+    -> layer<macrocell> & {
+  while (_nodes.size() < level) {
+    _nodes.emplace_back(layer_policy::for_level(_nodes.size() + 1), _mode);
+    self().opened(_nodes.size(), _nodes.back());
+  }
+  return _nodes[level - 1];
+}
+
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::nodes(std::size_t level) const
+    -> const layer<macrocell> & {
+  return _nodes[level - 1];
+}
+
+/**
+ * Returns the unique copy of the given leaf.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::make(const Leaf &leaf) -> pointer {
+  return _leaves.insert(leaf);
+}
+
+/**
+ * Returns the unique macrocell of the given level with the given quadrants.
+ * A newly created macrocell references its quadrants.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::make(std::size_t level, pointer nw,
+                                     pointer ne, pointer sw, pointer se)
+    -> pointer {
+  auto [node, inserted] = nodes(level).emplace(macrocell{nw, ne, sw, se});
+  if (inserted)
+    for (auto quadrant : {nw, ne, sw, se})
+      retain(level - 1, quadrant);
+  return node;
+}
+
+/**
+ * Returns the empty node of the given level.
+ * Empty nodes are kept alive for as long as the tree exists.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::empty(std::size_t level) -> pointer {
+  while (_empty.size() <= level) {
+    auto below = _empty.empty() ? pointer{nullptr} : _empty.back();
+    if (_empty.empty())
+      _empty.push_back(make(Leaf{}));
+    else
+      _empty.push_back(make(_empty.size(), below, below, below, below));
+    retain(_empty.size() - 1, _empty.back());
+  }
+  return _empty[level];
+}
+
+/**
+ * Registers a reference to the given node, if nodes are counted.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::retain(std::size_t level,
+                                       pointer node) noexcept {
+  if (level == 0)
+    _leaves.retain(node);
+  else
+    nodes(level).retain(node);
+}
+
+/**
+ * Removes a reference to the given node, if nodes are counted.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::release(std::size_t level, pointer node) {
+  if (level == 0)
+    _leaves.release(node);
+  else
+    nodes(level).release(node);
+}
+
+/**
+ * Replaces the root, moving the reference held by the tree along.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::replace_root(std::size_t level,
+                                             pointer root) {
+  retain(level, root);
+  if (_root)
+    release(_level, _root);
+  _root = root;
+  _level = level;
+}
+
+/**
+ * Returns the nine overlapping nodes of one level down that make up the given
+ * node, in row-major order. The corner nodes are just its quadrants.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::subnodes(std::size_t level, pointer node)
+    -> std::array<pointer, 9> {
+  auto &tree = self();
+  const auto cell = tree.fetch(level, node);
+  const auto nw = cell.nw(), ne = cell.ne(), sw = cell.sw(), se = cell.se();
+
+  if (level == 1) {
+    const auto a = tree.fetch(nw), b = tree.fetch(ne), c = tree.fetch(sw),
+               d = tree.fetch(se);
+    return {nw,
+            make(Leaf::horizontal(a, b)),
+            ne,
+            make(Leaf::vertical(a, c)),
+            make(Leaf::center(a, b, c, d)),
+            make(Leaf::vertical(b, d)),
+            sw,
+            make(Leaf::horizontal(c, d)),
+            se};
+  }
+
+  const auto down = level - 1;
+  const auto a = tree.fetch(down, nw), b = tree.fetch(down, ne),
+             c = tree.fetch(down, sw), d = tree.fetch(down, se);
+  return {nw,
+          make(down, a.ne(), b.nw(), a.se(), b.sw()),
+          ne,
+          make(down, a.sw(), a.se(), c.nw(), c.ne()),
+          make(down, a.se(), b.sw(), c.ne(), d.nw()),
+          make(down, b.sw(), b.se(), d.nw(), d.ne()),
+          sw,
+          make(down, c.ne(), d.nw(), c.se(), d.sw()),
+          se};
+}
+
+/**
+ * Returns the node of one level down centered in the given node, without
+ * advancing it in time.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::center(std::size_t level, pointer node)
+    -> pointer {
+  auto &tree = self();
+  const auto cell = tree.fetch(level, node);
+  if (level == 1) {
+    return make(Leaf::center(tree.fetch(cell.nw()), tree.fetch(cell.ne()),
+                             tree.fetch(cell.sw()), tree.fetch(cell.se())));
+  }
+  const auto down = level - 1;
+  return make(down, tree.fetch(down, cell.nw()).se(),
+              tree.fetch(down, cell.ne()).sw(),
+              tree.fetch(down, cell.sw()).ne(),
+              tree.fetch(down, cell.se()).nw());
+}
+
+/**
+ * Returns the binary logarithm of the number of generations by which next()
+ * advances nodes of the given level, which must be at least the base level.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::horizon(std::size_t level) const noexcept
+    -> std::size_t {
+  auto exponent = level - self().base_level();
+  for (auto reach = self().base_reach(); reach > 1; reach >>= 1)
+    ++exponent;
+  return exponent;
+}
+
+/**
+ * Computes the center of a node 2^horizon(level) generations into the future,
+ * i.e. as far as can be determined from the node alone. Results are memoized,
+ * so that every unique node is computed just once.
+ * The nine overlapping subnodes are first advanced by half that time,
+ * combined into four nodes, and then advanced once more. Nodes of the base
+ * level are left to the tree.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::next(std::size_t level, pointer node)
+    -> pointer {
+  auto &tree = self();
+  if (auto result = tree.memoized_next(level, node)) {
+    ++_memo.hits;
+    return result;
+  }
+  if (auto result = tree.recall(level, node, horizon(level))) {
+    ++_memo.hits;
+    return tree.memoize_next(level, node, result);
+  }
+  ++_memo.misses;
+  tree.evaluate();
+
+  auto result = pointer{nullptr};
+  if (level == tree.base_level()) {
+    result = tree.advance_base(node, std::uint64_t{1} << horizon(level));
+  } else {
+    auto [n00, n01, n02, n10, n11, n12, n20, n21, n22] = subnodes(level, node);
+    auto down = level - 1;
+    tree.dispatch(down, {n00, n01, n02, n10, n11, n12, n20, n21, n22});
+    auto r00 = next(down, n00), r01 = next(down, n01), r02 = next(down, n02),
+         r10 = next(down, n10), r11 = next(down, n11), r12 = next(down, n12),
+         r20 = next(down, n20), r21 = next(down, n21), r22 = next(down, n22);
+    auto q00 = make(down, r00, r01, r10, r11),
+         q01 = make(down, r01, r02, r11, r12),
+         q10 = make(down, r10, r11, r20, r21),
+         q11 = make(down, r11, r12, r21, r22);
+    tree.dispatch(down, {q00, q01, q10, q11});
+    result = make(down, next(down, q00), next(down, q01), next(down, q10),
+                  next(down, q11));
+  }
+
+  tree.record(level, node, horizon(level), result);
+  return tree.memoize_next(level, node, result);
+}
+
+/**
+ * Computes the center of a node 2^_step generations into the future, where
+ * _step may be at most horizon(level). Rather than advancing the nine
+ * subnodes, only their centers are combined into four nodes, which are then
+ * advanced by the full 2^_step generations.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::step(std::size_t level, pointer node)
+    -> pointer {
+  if (_step == horizon(level))
+    return next(level, node);
+  auto &tree = self();
+  if (auto result = tree.memoized_step(level, node)) {
+    ++_memo.hits;
+    return result;
+  }
+  if (auto result = tree.recall(level, node, _step)) {
+    ++_memo.hits;
+    return tree.memoize_step(level, node, result);
+  }
+  ++_memo.misses;
+  tree.evaluate();
+
+  auto result = pointer{nullptr};
+  if (level == tree.base_level()) {
+    result = tree.advance_base(node, std::uint64_t{1} << _step);
+  } else {
+    auto [n00, n01, n02, n10, n11, n12, n20, n21, n22] = subnodes(level, node);
+    auto down = level - 1;
+    auto c00 = center(down, n00), c01 = center(down, n01),
+         c02 = center(down, n02), c10 = center(down, n10),
+         c11 = center(down, n11), c12 = center(down, n12),
+         c20 = center(down, n20), c21 = center(down, n21),
+         c22 = center(down, n22);
+    auto q00 = make(down, c00, c01, c10, c11),
+         q01 = make(down, c01, c02, c11, c12),
+         q10 = make(down, c10, c11, c20, c21),
+         q11 = make(down, c11, c12, c21, c22);
+    if (_step == horizon(down))
+      tree.dispatch(down, {q00, q01, q10, q11});
+    result = make(down, step(down, q00), step(down, q01), step(down, q10),
+                  step(down, q11));
+  }
+
+  tree.record(level, node, _step, result);
+  return tree.memoize_step(level, node, result);
+}
+
+/**
+ * Changes the number of generations computed by step() to 2^exponent.
+ * Since macrocells have room for only one such result, all of them are
+ * forgotten when the exponent changes.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::set_step(std::size_t exponent) {
+  if (exponent == _step)
+    return;
+  _step = exponent;
+  self().forget_steps();
+}
+
+/**
+ * Advances the tree by 2^exponent generations.
+ * The root is first expanded until the pattern lies within its center
+ * quarter, and then until the pattern cannot spread beyond the center half
+ * of the root in that time, which at range r takes a root r times as large
+ * as for life. Since no cell moves faster than that, the pattern cannot
+ * escape the center half of the root, which is exactly what step() returns.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::jump(std::size_t exponent) {
+  auto &tree = self();
+  const auto lowest = std::max<std::size_t>(2, tree.base_level() + 1);
+  while (_level < lowest || !centered())
+    expand();
+  // Further expansion only serves this jump, so it is not kept if the jump
+  // is interrupted.
+  auto level = _level + 1;
+  auto root = expanded(_level, _root);
+  while ((tree.range() << exponent) > (std::uint64_t{1} << level))
+    root = expanded(level++, root);
+
+  set_step(exponent);
+  replace_root(level - 1, step(level, root));
+  _generation += std::uint64_t{1} << exponent;
+}
+
+/**
+ * Checks whether the given coordinates fall within the root.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::contains(std::int64_t x, std::int64_t y) const
+    noexcept -> bool {
+  auto half = side(_level) / 2;
+  return -half <= x && x < half && -half <= y && y < half;
+}
+
+/**
+ * Checks whether all cells that are not dead lie within the center half of
+ * the root, i.e. whether all grandchildren on the outside of the root are
+ * empty. Requires the root to be at least of level 2.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::centered() -> bool {
+  auto &tree = self();
+  const auto root = tree.fetch(_level, _root);
+  const auto down = _level - 1;
+  const auto empty = this->empty(_level - 2);
+  const auto nw = tree.fetch(down, root.nw()), ne = tree.fetch(down, root.ne()),
+             sw = tree.fetch(down, root.sw()), se = tree.fetch(down, root.se());
+  return nw.nw() == empty && nw.ne() == empty && nw.sw() == empty &&
+         ne.nw() == empty && ne.ne() == empty && ne.se() == empty &&
+         sw.nw() == empty && sw.sw() == empty && sw.se() == empty &&
+         se.ne() == empty && se.sw() == empty && se.se() == empty;
+}
+
+/**
+ * Doubles the size of the root, keeping its contents centered.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::expand() {
+  replace_root(_level + 1, expanded(_level, _root));
+}
+
+/**
+ * Returns the node of one level up with the given node at its center.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::expanded(std::size_t level, pointer node)
+    -> pointer {
+  const auto cell = self().fetch(level, node);
+  const auto border = empty(level - 1);
+  const auto nw = make(level, border, border, border, cell.nw());
+  const auto ne = make(level, border, border, cell.ne(), border);
+  const auto sw = make(level, border, cell.sw(), border, border);
+  const auto se = make(level, cell.se(), border, border, border);
+  return make(level + 1, nw, ne, sw, se);
+}
+
+/**
+ * Runs <function> until it completes without any layer overflowing, leaving
+ * it to the tree to make room in between attempts. <function> must therefore
+ * only commit its results once it can no longer fail.
+ */
+template <typename Tree, typename Leaf>
+template <typename Function>
+void hashlife_tree<Tree, Leaf>::guarded(Function &&function) {
+  for (auto attempt = std::size_t{0};; ++attempt) {
+    try {
+      function();
+      self().completed();
+      return;
+    } catch (const std::length_error &) {
+      if (!self().recover(attempt))
+        throw;
+    }
+  }
+}
+
+/**
+ * Grows all layers that have overflowed, returning whether any were found.
+ * Generational layers only ever overflow their nursery, which is empty in
+ * between computations and can therefore simply be replaced.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::grow() -> bool {
+  auto grown = false;
+  if (_leaves.overflowed()) {
+    if (_leaves.generational())
+      _leaves.grow_nursery();
+    else
+      rehash(0, _leaves.grown_capacity());
+    grown = true;
+  }
+  for (auto level = 1u; level <= _nodes.size(); ++level) {
+    auto &layer = nodes(level);
+    if (layer.overflowed()) {
+      if (layer.generational())
+        layer.grow_nursery();
+      else
+        rehash(level, layer.grown_capacity());
+      grown = true;
+    }
+  }
+  return grown;
+}
+
+/**
+ * Rehashes the layer of the given level into a table of <capacity> slots.
+ * Since this moves its nodes, all levels above are relocated and rehashed as
+ * well: the hash of a macrocell depends on the indices of its children.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::rehash(std::size_t level,
+                                       std::size_t capacity) {
+  auto keep = [](auto &) { return true; };
+  auto remap = level == 0 ? _leaves.rehash(capacity, keep)
+                          : nodes(level).rehash(capacity, keep);
+
+  while (true) {
+    self().for_each_root([&](std::size_t at, pointer &root) {
+      if (at == level)
+        root = remap[root.index()];
+    });
+    if (level < _empty.size())
+      _empty[level] = remap[_empty[level].index()];
+    self().relocated(level, remap);
+    if (++level > _nodes.size())
+      break;
+
+    auto &above = nodes(level);
+    auto relocate = [&remap](macrocell &node) {
+      node.relocate(remap);
+      return true;
+    };
+    remap = above.rehash(above.capacity(), relocate);
+  }
+}
+
+/**
+ * Memoizes <result> as the next() result of <node>, returning it. The node
+ * references its result.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::memoize_next(std::size_t level, pointer node,
+                                             pointer result) -> pointer {
+  nodes(level)[node].memoize_next(result);
+  retain(level - 1, result);
+  return result;
+}
+
+/**
+ * As above, but for the step() result of <node>.
+ */
+template <typename Tree, typename Leaf>
+auto hashlife_tree<Tree, Leaf>::memoize_step(std::size_t level, pointer node,
+                                             pointer result) -> pointer {
+  nodes(level)[node].memoize_step(result);
+  retain(level - 1, result);
+  return result;
+}
+
+/**
+ * Forgets all memoized step() results, releasing the nodes they refer to.
+ */
+template <typename Tree, typename Leaf>
+void hashlife_tree<Tree, Leaf>::forget_steps() {
+  for (auto level = 1u; level <= _nodes.size(); ++level) {
+    nodes(level).for_each([&](pointer, macrocell &node) {
+      if (node.step())
+        release(level - 1, node.step());
+      node.memoize_step(nullptr);
+    });
+  }
+}
+
+/**
+ * A new engine starts out empty, as a single macrocell of the base level.
+ */
+template <typename Kernel>
+hashlife_engine<Kernel>::hashlife_engine(Kernel kernel)
+    : tree{lifetime::unmanaged, kernel.base_level()},
+      _kernel{std::move(kernel)} {
+  this->guarded(
+      [&] { this->replace_root(this->_level, this->empty(this->_level)); });
+}
+
+/**
+ * Returns the state of the cell at the given coordinates.
+ */
+template <typename Kernel>
+auto hashlife_engine<Kernel>::get(std::int64_t x, std::int64_t y) const
+    -> state_type {
+  if (!this->contains(x, y))
+    return state_type{};
+  auto half = this->side(this->_level) / 2;
+  return get(this->_level, this->_root, x + half, y + half);
+}
+
+/**
+ * Replaces the leaf holding the cell at the given coordinates by
+ * update(leaf, column, row), where (column, row) locates the cell within the
+ * leaf. The engine is expanded as far as necessary to contain the cell.
+ */
+template <typename Kernel>
+template <typename Update>
+void hashlife_engine<Kernel>::set(std::int64_t x, std::int64_t y,
+                                  Update &&update) {
+  this->guarded([&] {
+    while (!this->contains(x, y))
+      this->expand();
+    auto half = this->side(this->_level) / 2;
+    this->replace_root(this->_level, set(this->_level, this->_root, x + half,
+                                         y + half, update));
+  });
+}
+
+/**
+ * Advances the engine by the given number of generations.
+ */
+template <typename Kernel>
+void hashlife_engine<Kernel>::advance(std::uint64_t generations) {
+  for (auto exponent = 0u; generations != 0; ++exponent, generations >>= 1)
+    if (generations & 1u)
+      this->guarded([&] { this->jump(exponent); });
+}
+
+/**
+ * Counts the cells that are not dead.
+ */
+template <typename Kernel>
+auto hashlife_engine<Kernel>::population() const -> std::uint64_t {
+  auto cache = std::vector<static_vector<std::uint64_t>>{};
+  for (auto level = 0u; level <= this->_level; ++level) {
+    auto capacity = level == 0 ? this->_leaves.capacity()
+                               : nodes(level).capacity();
+    cache.emplace_back(capacity, std::numeric_limits<std::uint64_t>::max());
+  }
+  return population(this->_level, this->_root, cache);
+}
+
+template <typename Kernel>
+auto hashlife_engine<Kernel>::get(std::size_t level, pointer node,
+                                  std::uint64_t x, std::uint64_t y) const
+    -> state_type {
+  for (; level > 0; --level) {
+    auto half = static_cast<std::uint64_t>(this->side(level) / 2);
+    auto quadrant = (x >= half) + 2 * (y >= half);
+    node = nodes(level)[node].quadrants()[quadrant];
+    x %= half, y %= half;
+  }
+  return this->_leaves[node](x, y);
+}
+
+template <typename Kernel>
+template <typename Update>
+auto hashlife_engine<Kernel>::set(std::size_t level, pointer node,
+                                  std::uint64_t x, std::uint64_t y,
+                                  Update &update) -> pointer {
+  if (level == 0)
+    return make(update(this->_leaves[node], x, y));
+
+  auto half = static_cast<std::uint64_t>(this->side(level) / 2);
+  auto quadrants = nodes(level)[node].quadrants();
+  auto quadrant = (x >= half) + 2 * (y >= half);
+  quadrants[quadrant] =
+      set(level - 1, quadrants[quadrant], x % half, y % half, update);
+  return make(level, quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+}
+
+template <typename Kernel>
+auto hashlife_engine<Kernel>::population(
+    std::size_t level, pointer node,
+    std::vector<static_vector<std::uint64_t>> &cache) const -> std::uint64_t {
+  auto &count = cache[level][node.index()];
+  if (count != std::numeric_limits<std::uint64_t>::max())
+    return count;
+
+  if (level == 0) {
+    count = this->_leaves[node].population_count();
+  } else {
+    count = 0;
+    for (auto quadrant : nodes(level)[node].quadrants())
+      count += population(level - 1, quadrant, cache);
+  }
+  return count;
+}
+} // namespace life
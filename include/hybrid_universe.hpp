@@ -0,0 +1,83 @@
+/**
+ * Hashlife
+ * Universe that switches between hashlife and direct simulation, depending on
+ * which suits the pattern best.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tile_engine.hpp"
+#include "universe.hpp"
+
+namespace life {
+enum class engine { tree, tiles };
+
+/**
+ * Thresholds at which a hybrid universe changes engines. Both are evaluated
+ * once per window of generations.
+ */
+struct hybrid_policy {
+  double minimum_hit_rate = 0.5;  // Memo hit rate below which tiles are used
+  double maximum_activity = 0.05; // Tile activity below which the tree is used
+  std::uint64_t window = 64;      // Generations in between decisions
+  std::size_t minimum_lookups = 4096; // Lookups needed to judge the memo
+};
+
+/**
+ * Hashlife only pays off if the results it memoizes are used again. For
+ * chaotic patterns they hardly are: the memo keeps missing, and all nodes it
+ * creates are overhead. A hybrid universe therefore keeps track of the hit
+ * rate of the memo, and falls back to the sparse tile engine if it drops too
+ * low. Once the pattern has settled, and only a small fraction of its tiles
+ * still changes from one generation to the next, it switches back to the
+ * tree, which can then leap ahead through the regular parts.
+ *
+ * Conversions are exact in both directions: the non-empty leaves of the tree
+ * become tiles and vice versa, and the memo of the tree is kept throughout,
+ * so that results memoized before a detour through the tiles stay useful.
+ */
+class hybrid_universe {
+public:
+  explicit hybrid_universe(hybrid_policy policy = {});
+
+  auto get(std::int64_t x, std::int64_t y) const -> bool;
+  void set(std::int64_t x, std::int64_t y, bool alive = true);
+  void advance(std::uint64_t generations);
+
+  auto generation() const noexcept { return _generation; }
+  auto population() const -> std::uint64_t;
+  auto current() const noexcept { return _engine; }
+  auto tree() const noexcept -> const universe & { return _tree; }
+  auto tiles() const noexcept -> const tile_engine & { return _tiles; }
+
+private:
+  void advance_tree(std::uint64_t generations);
+  void advance_tiles(std::uint64_t generations);
+  void to_tiles();
+  void to_tree();
+
+  hybrid_policy _policy;
+  engine _engine = engine::tree;
+  universe _tree;
+  tile_engine _tiles;
+  std::uint64_t _generation = 0;
+  bool _settling = false; // Whether the memo is still warming up
+};
+} // namespace life
@@ -0,0 +1,773 @@
+/**
+ * Hashlife
+ * A single level of the quadtree, storing all of its unique nodes in a hash
+ * table. Nodes are referred to by their index into the table.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dense_set.hpp"
+#include "digest.hpp"
+#include "epochs.hpp"
+#include "macrocell.hpp"
+#include "shared_set.hpp"
+#include "static_vector.hpp"
+
+namespace life {
+/**
+ * Sizing of the table of a single level.
+ * Levels differ enormously in their number of nodes: the lowest few levels
+ * may contain millions, whereas the highest levels contain only a handful.
+ * Each level therefore starts out at a size that fits its expected number of
+ * nodes, and grows on its own once it reaches its maximum load factor.
+ */
+struct layer_policy {
+  std::size_t capacity;
+  double max_load_factor;
+  std::size_t probe_limit;
+
+  static auto for_level(std::size_t level) noexcept -> layer_policy;
+};
+
+/**
+ * Determines how the lifetime of nodes is managed:
+ *  unmanaged:  nodes live as long as the layer does.
+ *  counted:    nodes count the references to them, and are freed in batches
+ *              once they have become unreferenced.
+ *  generational: nodes are created in a nursery, and only those that are
+ *              still reachable after a computation are promoted to the
+ *              tenured table; the remainder is dropped all at once.
+ */
+enum class lifetime { unmanaged, counted, generational };
+
+/**
+ * Usage statistics of a single level, used to tune the layer policies.
+ */
+struct layer_statistics {
+  std::size_t size = 0;
+  std::size_t capacity = 0;
+  std::size_t lookups = 0;   // Number of nodes requested
+  std::size_t hits = 0;      // Requested nodes that existed already
+  std::size_t overflows = 0; // Insertions rejected due to a lack of space
+  std::size_t rehashes = 0;  // Number of times the table was rebuilt
+  std::size_t reclaimed = 0; // Unreferenced nodes that were freed
+  std::size_t promoted = 0;  // Nursery nodes moved into the tenured table
+  std::size_t spilled = 0;   // Cold nodes moved out of memory
+};
+
+/**
+ * Result of promoting nursery nodes into the tenured table of a layer: where
+ * the tenured nodes moved to, if the table had to be rehashed, and where each
+ * promoted nursery node ended up. Translates pointers held by the level above.
+ */
+struct promotion {
+  static_vector<pointer> relocated; // Empty if the table was not rehashed
+  static_vector<pointer> promoted;  // Indexed by nursery index
+
+  auto operator()(pointer node) const noexcept -> pointer {
+    if (node.nursery())
+      return promoted[node.index()];
+    return relocated.empty() ? node : relocated[node.index()];
+  }
+};
+
+/**
+ * A layer hash-conses all nodes of one level of the quadtree, such that each
+ * unique node is stored exactly once.
+ * Insertion into a layer never reallocates, since that would invalidate the
+ * pointers held by the level above. Instead, an insertion that would exceed
+ * the maximum load factor fails by throwing std::length_error, after which
+ * the owner is expected to rehash() the layer in between computations.
+ *
+ * Reference counts, if enabled, are stored alongside the table rather than
+ * inside the nodes, so that unmanaged layers do not pay for them.
+ * Nodes that are inserted or lose their last reference are queued as
+ * unreferenced, since they may still be in use by an ongoing computation.
+ * It is up to the owner to later erase those that are still unreferenced.
+ *
+ * Generational layers insert new nodes into a separate nursery table, marked
+ * as such in their pointers. In between computations, the owner promotes the
+ * nursery nodes that survived into the tenured table, after which the nursery
+ * is reset in constant time. Tenured nodes are never created directly, so the
+ * tenured table only ever holds nodes that outlived a computation.
+ *
+ * Layers may also track when each node was last accessed, counted in epochs
+ * that the owner advances in between computations, so that nodes that have
+ * gone cold can be evicted.
+ *
+ * Journaled layers keep the identifier under which each node was written to
+ * a checkpoint log, and queue the nodes whose futures changed since, so that
+ * checkpoints only have to visit what is new.
+ *
+ * Hashed layers remember the digest of each node once it has been computed.
+ *
+ * The nodes of an unmanaged layer may also live in a shared set instead, so
+ * that processes opening the same one share nodes and memoized results.
+ * Shared layers cannot be rehashed, and therefore never grow.
+ *
+ * Finally, layers may be protected by the epochs of concurrent readers, which
+ * read tenured nodes straight from the table. Tables replaced by a rehash are
+ * then retired rather than freed, while any reader is around.
+ */
+template <typename Node> class layer {
+public:
+  using node_type = Node;
+  using size_type = std::size_t;
+
+  layer(layer_policy policy, lifetime mode = lifetime::unmanaged);
+
+  auto emplace(const Node &node) -> std::pair<pointer, bool>;
+  auto insert(const Node &node) -> pointer { return emplace(node).first; }
+  auto find(const Node &node) const noexcept -> pointer;
+  auto operator[](pointer node) noexcept -> Node &;
+  auto operator[](pointer node) const noexcept -> const Node &;
+  auto contains(pointer node) const noexcept -> bool;
+
+  auto size() const noexcept -> size_type {
+    return shared() ? _shared->size() : _nodes.size();
+  }
+  auto capacity() const noexcept -> size_type {
+    return shared() ? _shared->capacity() : _nodes.capacity();
+  }
+  auto load_factor() const noexcept -> double;
+  auto max_load_factor() const noexcept { return _policy.max_load_factor; }
+  auto overflowed() const noexcept { return _overflowed; }
+  auto tombstones() const noexcept { return _nodes.tombstones(); }
+  auto clogged() const noexcept { return tombstones() > capacity() / 4; }
+  auto statistics() const noexcept -> layer_statistics;
+
+  auto generational() const noexcept { return _nursery.has_value(); }
+  auto nursery_size() const noexcept -> size_type;
+  auto nursery_capacity() const noexcept -> size_type;
+  template <typename Transform>
+  auto promote(const std::vector<pointer> &survivors, bool relocate,
+               Transform &&transform) -> promotion;
+  void reset_nursery() noexcept;
+  void grow_nursery();
+
+  auto tracked() const noexcept { return !_accessed.empty(); }
+  void track_access();
+  void tick() noexcept { ++_epoch; }
+  auto idle(pointer node) const noexcept -> std::uint32_t;
+  void evict(pointer node) noexcept;
+
+  static constexpr auto unlogged = std::numeric_limits<std::uint32_t>::max();
+  auto journaled() const noexcept { return !_ids.empty(); }
+  void journal();
+  auto id(pointer node) const noexcept -> std::uint32_t;
+  void identify(pointer node, std::uint32_t id) noexcept;
+  void mark_dirty(pointer node);
+  auto dirty() noexcept -> pointer;
+
+  auto hashed() const noexcept { return !_digests.empty(); }
+  void hash_contents();
+  auto digest(pointer node) const noexcept -> life::digest;
+  void set_digest(pointer node, life::digest digest) noexcept;
+
+  auto shared() const noexcept { return _shared.has_value(); }
+  void share(std::string name, size_type capacity);
+
+  void protect(epochs *readers) noexcept { _readers = readers; }
+  auto data() const noexcept -> const Node * { return _nodes.data(); }
+
+  auto counted() const noexcept { return !_references.empty(); }
+  auto references(pointer node) const noexcept -> std::uint32_t;
+  void retain(pointer node) noexcept;
+  void release(pointer node);
+  auto unreferenced() noexcept -> pointer;
+  void erase(pointer node) noexcept;
+
+  template <typename Function> void for_each(Function &&function);
+  template <typename Function> void for_each(Function &&function) const;
+  template <typename Function> void for_each_young(Function &&function) const;
+  template <typename Transform>
+  auto rehash(size_type capacity, Transform &&transform)
+      -> static_vector<pointer>;
+  auto grown_capacity(size_type incoming = 0) const noexcept -> size_type;
+  auto shrunk_capacity() const noexcept -> size_type;
+  void clear() noexcept;
+
+private:
+  auto nursery_find(const Node &node) const noexcept -> pointer;
+  void touch(pointer node) noexcept;
+
+  dense_set<Node> _nodes;
+  std::optional<dense_set<Node>> _nursery; // Only if generational
+  std::optional<shared_set<Node>> _shared; // Replaces _nodes if shared
+  layer_policy _policy;
+  size_type _minimum_capacity;
+  layer_statistics _statistics;
+  bool _overflowed = false;
+  static_vector<std::uint32_t> _references; // Empty unless counted
+  std::vector<pointer> _unreferenced;
+  static_vector<std::uint32_t> _accessed; // Empty unless tracked
+  std::uint32_t _epoch = 0;
+  static_vector<std::uint32_t> _ids; // Empty unless journaled
+  std::vector<pointer> _dirty;
+  static_vector<life::digest> _digests; // Empty unless hashed
+  epochs *_readers = nullptr;            // Unless unprotected
+};
+
+/**
+ * Creates an empty layer sized according to the given policy.
+ */
+template <typename Node>
+layer<Node>::layer(layer_policy policy, lifetime mode)
+    : _nodes{policy.capacity, policy.probe_limit}, _policy{policy},
+      _minimum_capacity{policy.capacity} {
+  if (mode == lifetime::counted)
+    _references = static_vector<std::uint32_t>{policy.capacity, 0u};
+  if (mode == lifetime::generational)
+    _nursery.emplace(policy.capacity, policy.probe_limit);
+}
+
+/**
+ * Returns a pointer to the unique copy of <node>, inserting it if it did not
+ * exist yet, and whether an insertion took place. Throws std::length_error if
+ * the node is new and the layer has no room left for it.
+ * New nodes go into the nursery instead if the layer is generational.
+ */
+template <typename Node>
+auto layer<Node>::emplace(const Node &node) -> std::pair<pointer, bool> {
+  ++_statistics.lookups;
+  if (shared()) {
+    auto [index, inserted] = _shared->emplace(node);
+    if (index == capacity()) {
+      ++_statistics.overflows;
+      _overflowed = true;
+      throw std::length_error{"layer: shared table is full"};
+    }
+    _statistics.hits += !inserted;
+    return {pointer{index}, inserted};
+  }
+  if (auto existing = find(node)) {
+    ++_statistics.hits;
+    touch(existing);
+    return {existing, false};
+  }
+
+  auto &table = generational() ? *_nursery : _nodes;
+  if (table.size() + 1 > max_load_factor() * table.capacity()) {
+    ++_statistics.overflows;
+    _overflowed = true;
+    throw std::length_error{"layer: maximum load factor exceeded"};
+  }
+
+  auto [location, success] = table.emplace(node);
+  if (!success) {
+    ++_statistics.overflows;
+    _overflowed = true;
+    throw std::length_error{"layer: no free spot within probe limit"};
+  }
+
+  auto index = static_cast<std::size_t>(location - table.begin());
+  if (generational())
+    return {pointer::young(index), true};
+
+  auto result = pointer{index};
+  touch(result);
+  if (counted()) {
+    _references[result.index()] = 0;
+    _unreferenced.push_back(result);
+  }
+  return {result, true};
+}
+
+/**
+ * Looks up <node> without inserting it, returning a null pointer if it does
+ * not exist.
+ */
+template <typename Node>
+auto layer<Node>::find(const Node &node) const noexcept -> pointer {
+  if (shared()) {
+    auto index = _shared->find(node);
+    return index == capacity() ? pointer{nullptr} : pointer{index};
+  }
+  auto location = _nodes.find(node);
+  if (location == _nodes.end())
+    return nursery_find(node);
+  return pointer{static_cast<std::size_t>(location - _nodes.begin())};
+}
+
+template <typename Node>
+auto layer<Node>::nursery_find(const Node &node) const noexcept -> pointer {
+  if (!generational())
+    return nullptr;
+  auto location = _nursery->find(node);
+  if (location == _nursery->end())
+    return nullptr;
+  return pointer::young(static_cast<std::size_t>(location - _nursery->begin()));
+}
+
+/**
+ * Node access is unchecked, apart from the assertions in dense_set.
+ */
+template <typename Node>
+auto layer<Node>::operator[](pointer node) noexcept -> Node & {
+  touch(node);
+  if (shared())
+    return (*_shared)[node.index()];
+  return node.nursery() ? (*_nursery)[node.index()] : _nodes[node.index()];
+}
+
+template <typename Node>
+auto layer<Node>::operator[](pointer node) const noexcept -> const Node & {
+  if (shared())
+    return (*_shared)[node.index()];
+  return node.nursery() ? (*_nursery)[node.index()] : _nodes[node.index()];
+}
+
+/**
+ * Checks whether <node> points to an existing node of this layer.
+ */
+template <typename Node>
+auto layer<Node>::contains(pointer node) const noexcept -> bool {
+  if (node.nursery())
+    return node.index() < nursery_capacity() && _nursery->filled(node.index());
+  if (!node || node.index() >= capacity())
+    return false;
+  return shared() ? _shared->filled(node.index()) : _nodes.filled(node.index());
+}
+
+template <typename Node>
+auto layer<Node>::load_factor() const noexcept -> double {
+  return static_cast<double>(size()) / capacity();
+}
+
+template <typename Node>
+auto layer<Node>::statistics() const noexcept -> layer_statistics {
+  auto result = _statistics;
+  result.size = size();
+  result.capacity = capacity();
+  return result;
+}
+
+template <typename Node>
+auto layer<Node>::nursery_size() const noexcept -> size_type {
+  return generational() ? _nursery->size() : 0;
+}
+
+template <typename Node>
+auto layer<Node>::nursery_capacity() const noexcept -> size_type {
+  return generational() ? _nursery->capacity() : 0;
+}
+
+/**
+ * Moves the <survivors> out of the nursery into the tenured table, passing
+ * each through <transform> to translate its pointers. If <relocate> is set, or
+ * there is not enough room for the survivors, the tenured table is rehashed
+ * first, with its nodes passed through <transform> as well.
+ * Survivors are inserted without probe limit, which cannot fail since the
+ * table is left at most at its maximum load factor.
+ */
+template <typename Node>
+template <typename Transform>
+auto layer<Node>::promote(const std::vector<pointer> &survivors, bool relocate,
+                          Transform &&transform) -> promotion {
+  auto result = promotion{};
+  if (size() + survivors.size() > max_load_factor() * capacity())
+    result.relocated = rehash(grown_capacity(survivors.size()), transform);
+  else if (relocate)
+    result.relocated = rehash(capacity(), transform);
+
+  result.promoted = static_vector<pointer>{nursery_capacity(), pointer{}};
+  for (auto node : survivors) {
+    auto survivor = (*_nursery)[node.index()];
+    transform(survivor);
+    auto [location, success] = _nodes.insert(survivor, capacity());
+    assert(success && "layer: Promotion into a full table");
+    result.promoted[node.index()] =
+        static_cast<std::size_t>(location - _nodes.begin());
+  }
+  _statistics.promoted += survivors.size();
+  return result;
+}
+
+/**
+ * Drops all nodes left in the nursery, in constant time.
+ */
+template <typename Node> void layer<Node>::reset_nursery() noexcept {
+  if (generational())
+    _nursery->clear();
+}
+
+/**
+ * Doubles the capacity of the nursery, which must be empty, so that larger
+ * computations fit in between promotions.
+ */
+template <typename Node> void layer<Node>::grow_nursery() {
+  assert(nursery_size() == 0 && "layer: Growing a nursery that is in use");
+  _nursery.emplace(2 * nursery_capacity(), _policy.probe_limit);
+  _overflowed = false;
+}
+
+/**
+ * Starts tracking the epoch in which each node was last accessed, through
+ * either lookup or non-constant indexing. Existing nodes count as accessed
+ * in the current epoch.
+ */
+template <typename Node> void layer<Node>::track_access() {
+  if (!tracked())
+    _accessed = static_vector<std::uint32_t>{capacity(), _epoch};
+}
+
+/**
+ * Returns the number of epochs since <node> was last accessed; always 0 if
+ * accesses are not tracked.
+ */
+template <typename Node>
+auto layer<Node>::idle(pointer node) const noexcept -> std::uint32_t {
+  return tracked() ? _epoch - _accessed[node.index()] : 0;
+}
+
+/**
+ * Removes <node>, which has been moved elsewhere, from the layer.
+ */
+template <typename Node> void layer<Node>::evict(pointer node) noexcept {
+  _nodes.erase(node.index());
+  _overflowed = false;
+  ++_statistics.spilled;
+}
+
+template <typename Node> void layer<Node>::touch(pointer node) noexcept {
+  if (tracked() && !node.nursery())
+    _accessed[node.index()] = _epoch;
+}
+
+/**
+ * Starts a new journal, in which no node has been logged yet.
+ */
+template <typename Node> void layer<Node>::journal() {
+  _ids = static_vector<std::uint32_t>{capacity(), unlogged};
+  _dirty.clear();
+}
+
+/**
+ * Returns the identifier of <node> in the journal, or <unlogged>.
+ */
+template <typename Node>
+auto layer<Node>::id(pointer node) const noexcept -> std::uint32_t {
+  return journaled() ? _ids[node.index()] : unlogged;
+}
+
+template <typename Node>
+void layer<Node>::identify(pointer node, std::uint32_t id) noexcept {
+  if (journaled())
+    _ids[node.index()] = id;
+}
+
+/**
+ * Queues <node> as having a changed future, if journaled.
+ */
+template <typename Node> void layer<Node>::mark_dirty(pointer node) {
+  if (journaled())
+    _dirty.push_back(node);
+}
+
+/**
+ * Pops the next node from the queue of nodes with changed futures, returning
+ * a null pointer once the queue is exhausted. Nodes may be queued repeatedly,
+ * and may have been erased since.
+ */
+template <typename Node> auto layer<Node>::dirty() noexcept -> pointer {
+  if (_dirty.empty())
+    return nullptr;
+  auto node = _dirty.back();
+  _dirty.pop_back();
+  return node;
+}
+
+/**
+ * Starts remembering digests, none of which are known yet.
+ */
+template <typename Node> void layer<Node>::hash_contents() {
+  _digests = static_vector<life::digest>{capacity(), life::digest{}};
+}
+
+/**
+ * Returns the digest of <node>, or the unknown digest if it has not been
+ * computed yet.
+ */
+template <typename Node>
+auto layer<Node>::digest(pointer node) const noexcept -> life::digest {
+  return hashed() ? _digests[node.index()] : life::digest{};
+}
+
+template <typename Node>
+void layer<Node>::set_digest(pointer node, life::digest digest) noexcept {
+  if (hashed())
+    _digests[node.index()] = digest;
+}
+
+/**
+ * Moves the nodes of this layer into the shared set called <name>, which is
+ * created with room for <capacity> nodes unless another process already did.
+ * Only empty, unmanaged layers can be shared, as shared nodes can be neither
+ * freed nor moved.
+ */
+template <typename Node>
+void layer<Node>::share(std::string name, size_type capacity) {
+  if (!_nodes.empty() || counted() || generational() || tracked())
+    throw std::domain_error{"layer: only empty unmanaged layers are shared"};
+  _shared.emplace(std::move(name), capacity, _policy.probe_limit);
+  _nodes = dense_set<Node>{1, _policy.probe_limit};
+  _policy.capacity = capacity;
+}
+
+/**
+ * Returns the number of references to <node>; always 0 if not counted.
+ */
+template <typename Node>
+auto layer<Node>::references(pointer node) const noexcept -> std::uint32_t {
+  return counted() ? _references[node.index()] : 0;
+}
+
+/**
+ * Registers a new reference to <node>.
+ */
+template <typename Node> void layer<Node>::retain(pointer node) noexcept {
+  if (counted())
+    ++_references[node.index()];
+}
+
+/**
+ * Removes a reference to <node>, queueing it as unreferenced if this was its
+ * last reference.
+ */
+template <typename Node> void layer<Node>::release(pointer node) {
+  if (!counted())
+    return;
+  assert(_references[node.index()] > 0 && "layer: Unbalanced release");
+  if (--_references[node.index()] == 0)
+    _unreferenced.push_back(node);
+}
+
+/**
+ * Pops the next node from the queue of unreferenced nodes, returning a null
+ * pointer once the queue is exhausted.
+ * Queued nodes may have been referenced again since, or even have been freed
+ * and replaced by another node already, so the result must be checked.
+ */
+template <typename Node> auto layer<Node>::unreferenced() noexcept -> pointer {
+  if (_unreferenced.empty())
+    return nullptr;
+  auto node = _unreferenced.back();
+  _unreferenced.pop_back();
+  return node;
+}
+
+/**
+ * Frees the spot taken by <node>, which also makes room for any insertion
+ * that overflowed before.
+ */
+template <typename Node> void layer<Node>::erase(pointer node) noexcept {
+  _nodes.erase(node.index());
+  identify(node, unlogged);
+  set_digest(node, life::digest{});
+  _overflowed = false;
+  ++_statistics.reclaimed;
+}
+
+/**
+ * Calls <function> with the pointer and value of each node in the layer.
+ * Traversal happens in order of index, i.e. in memory order, with the nodes
+ * of the nursery, if any, visited last.
+ */
+template <typename Node>
+template <typename Function>
+void layer<Node>::for_each(Function &&function) {
+  if (shared()) {
+    for (auto index = 0u; index < capacity(); ++index)
+      if (_shared->filled(index))
+        function(pointer{index}, (*_shared)[index]);
+    return;
+  }
+  for (auto index = 0u; index < capacity(); ++index)
+    if (_nodes.filled(index))
+      function(pointer{index}, _nodes[index]);
+  for (auto index = 0u; index < nursery_capacity(); ++index)
+    if (_nursery->filled(index))
+      function(pointer::young(index), (*_nursery)[index]);
+}
+
+template <typename Node>
+template <typename Function>
+void layer<Node>::for_each(Function &&function) const {
+  if (shared()) {
+    for (auto index = 0u; index < capacity(); ++index)
+      if (_shared->filled(index))
+        function(pointer{index}, std::as_const(*_shared)[index]);
+    return;
+  }
+  for (auto index = 0u; index < capacity(); ++index)
+    if (_nodes.filled(index))
+      function(pointer{index}, _nodes[index]);
+  for (auto index = 0u; index < nursery_capacity(); ++index)
+    if (_nursery->filled(index))
+      function(pointer::young(index), (*_nursery)[index]);
+}
+
+/**
+ * As above, but only for the nodes of the nursery, if any.
+ */
+template <typename Node>
+template <typename Function>
+void layer<Node>::for_each_young(Function &&function) const {
+  for (auto index = 0u; index < nursery_capacity(); ++index)
+    if (_nursery->filled(index))
+      function(pointer::young(index), (*_nursery)[index]);
+}
+
+/**
+ * Rebuilds the tenured table with room for <capacity> nodes, passing each node
+ * through <transform> on the way. A transform returning false drops the node.
+ * Returns the table mapping old indices onto new ones, with dropped nodes
+ * mapping onto the null pointer, so that the level above can be relocated.
+ * Reference counts, queued nodes, access epochs, journal identifiers and
+ * digests move along with their nodes.
+ * Should the new table turn out too small after all, its capacity is doubled
+ * until all nodes fit.
+ */
+template <typename Node>
+template <typename Transform>
+auto layer<Node>::rehash(size_type capacity, Transform &&transform)
+    -> static_vector<pointer> {
+  if (shared())
+    throw std::domain_error{"layer: shared tables cannot be rehashed"};
+  auto remap = static_vector<pointer>{this->capacity(), pointer{nullptr}};
+  auto rebuilt = dense_set<Node>{capacity, _policy.probe_limit};
+
+  for (auto index = 0u; index < this->capacity(); ++index) {
+    if (!_nodes.filled(index))
+      continue;
+    auto node = _nodes[index];
+    if (!transform(node))
+      continue;
+
+    auto [location, success] = rebuilt.emplace(node);
+    if (!success) {
+      // Restart from scratch with twice the space, keeping the original intact
+      return rehash(2 * capacity, transform);
+    }
+    remap[index] = static_cast<std::size_t>(location - rebuilt.begin());
+  }
+
+  if (counted()) {
+    auto references = static_vector<std::uint32_t>{capacity, 0u};
+    for (auto index = 0u; index < remap.size(); ++index)
+      if (remap[index])
+        references[remap[index].index()] = _references[index];
+    _references = std::move(references);
+
+    auto unreferenced = std::vector<pointer>{};
+    for (auto node : _unreferenced)
+      if (remap[node.index()])
+        unreferenced.push_back(remap[node.index()]);
+    _unreferenced = std::move(unreferenced);
+  }
+
+  if (tracked()) {
+    auto accessed = static_vector<std::uint32_t>{capacity, _epoch};
+    for (auto index = 0u; index < remap.size(); ++index)
+      if (remap[index])
+        accessed[remap[index].index()] = _accessed[index];
+    _accessed = std::move(accessed);
+  }
+
+  if (journaled()) {
+    auto ids = static_vector<std::uint32_t>{capacity, unlogged};
+    for (auto index = 0u; index < remap.size(); ++index)
+      if (remap[index])
+        ids[remap[index].index()] = _ids[index];
+    _ids = std::move(ids);
+
+    auto dirty = std::vector<pointer>{};
+    for (auto node : _dirty)
+      if (remap[node.index()])
+        dirty.push_back(remap[node.index()]);
+    _dirty = std::move(dirty);
+  }
+
+  if (hashed()) {
+    auto digests = static_vector<life::digest>{capacity, life::digest{}};
+    for (auto index = 0u; index < remap.size(); ++index)
+      if (remap[index])
+        digests[remap[index].index()] = _digests[index];
+    _digests = std::move(digests);
+  }
+
+  if (_readers && _readers->readers() != 0)
+    _readers->retire(std::make_shared<dense_set<Node>>(std::move(_nodes)));
+  _nodes = std::move(rebuilt);
+  _policy.capacity = capacity;
+  _overflowed = false;
+  ++_statistics.rehashes;
+  return remap;
+}
+
+/**
+ * Determines the capacity the layer should grow to once it has overflowed:
+ * the capacity is doubled until the layer, including <incoming> nodes that are
+ * yet to be added, is filled to at most half of its maximum load factor.
+ */
+template <typename Node>
+auto layer<Node>::grown_capacity(size_type incoming) const noexcept
+    -> size_type {
+  auto result = 2 * capacity();
+  while (2 * (size() + incoming) > max_load_factor() * result)
+    result *= 2;
+  return result;
+}
+
+/**
+ * Determines the capacity the layer may shrink to once nodes have been
+ * removed: the capacity is halved for as long as the layer would be filled to
+ * at most half of its maximum load factor, but never below its initial size.
+ */
+template <typename Node>
+auto layer<Node>::shrunk_capacity() const noexcept -> size_type {
+  auto result = capacity();
+  while (result / 2 >= _minimum_capacity &&
+         2 * size() <= max_load_factor() * (result / 2))
+    result /= 2;
+  return result;
+}
+
+/**
+ * Removes all nodes from the layer, keeping its capacity.
+ */
+template <typename Node> void layer<Node>::clear() noexcept {
+  _nodes.clear();
+  reset_nursery();
+  _overflowed = false;
+  _unreferenced.clear();
+  _ids.fill(unlogged);
+  _digests.fill(life::digest{});
+  _dirty.clear();
+}
+} // namespace life
@@ -0,0 +1,59 @@
+/**
+ * Hashlife
+ * Larger-than-Life rules: outer-totalistic rules over neighbourhoods of a
+ * larger range.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace life {
+/**
+ * Larger-than-Life rule of range r: each cell counts the living cells in the
+ * (2r+1)x(2r+1) square around it, including itself if the middle is counted.
+ * Dead cells are born if that count lies within the birth interval, and
+ * living cells survive if it lies within the survival interval.
+ *
+ * Rules are written as in Golly, e.g. "R5,C0,M1,S34..58,B34..45,NM" for Bosco's
+ * rule. Only two states and the Moore neighbourhood are supported.
+ */
+class ltl_rule {
+public:
+  ltl_rule(std::size_t range, std::size_t birth_min, std::size_t birth_max,
+           std::size_t survival_min, std::size_t survival_max,
+           bool middle = true);
+  static auto parse(std::string_view rule) -> ltl_rule;
+
+  auto operator==(const ltl_rule &other) const noexcept -> bool;
+  auto range() const noexcept { return _range; }
+  auto middle() const noexcept { return _middle; }
+  auto born(std::size_t count) const noexcept -> bool;
+  auto survives(std::size_t count) const noexcept -> bool;
+
+  void step(std::vector<std::uint8_t> &grid, std::size_t side) const;
+
+private:
+  std::size_t _range;
+  std::size_t _birth_min, _birth_max;
+  std::size_t _survival_min, _survival_max;
+  bool _middle;
+};
+} // namespace life
@@ -0,0 +1,106 @@
+/**
+ * Hashlife
+ * A universe following a Larger-than-Life rule, stored as a quadtree of
+ * hash-consed macrocells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cells.hpp"
+#include "hashlife_engine.hpp"
+#include "layer.hpp"
+#include "ltl_rule.hpp"
+
+namespace life {
+/**
+ * Hashlife relies on the speed of light: the center half of a node of side s
+ * is determined by the node alone for s/4 generations if cells only see
+ * their direct neighbours. Under a rule of range r, information travels r
+ * cells per generation instead, so a node only determines its center half
+ * for s/4r generations.
+ *
+ * The lowest level whose nodes allow at least one generation, the base
+ * level, is therefore computed directly: its nodes are unpacked into a dense
+ * grid, advanced by the largest power of two generations that fits, and the
+ * center half is packed again. Every level above advances twice as far as
+ * the one below, by the usual recursion over nine subnodes, so that results
+ * are memoized exactly as for life. Levels below the base level only store
+ * cells.
+ *
+ * Nodes are never freed, and layers grow in between computations as in an
+ * unmanaged universe.
+ */
+class ltl_universe {
+public:
+  explicit ltl_universe(ltl_rule rule) : _engine{kernel{rule}} {}
+
+  auto get(std::int64_t x, std::int64_t y) const -> bool {
+    return _engine.get(x, y);
+  }
+  void set(std::int64_t x, std::int64_t y, bool alive = true);
+  void advance(std::uint64_t generations) { _engine.advance(generations); }
+
+  auto rule() const noexcept -> const ltl_rule & {
+    return _engine.kernel().rule();
+  }
+  auto generation() const noexcept { return _engine.generation(); }
+  auto level() const noexcept { return _engine.level(); }
+  auto base_level() const noexcept { return _engine.kernel().base_level(); }
+  auto population() const -> std::uint64_t { return _engine.population(); }
+  auto statistics() const -> std::vector<layer_statistics> {
+    return _engine.statistics();
+  }
+
+private:
+  /**
+   * Advances nodes of the base level by simulating them on a dense grid.
+   */
+  class kernel {
+  public:
+    using leaf_type = cells;
+
+    explicit kernel(ltl_rule rule);
+
+    auto rule() const noexcept -> const ltl_rule & { return _rule; }
+    auto base_level() const noexcept -> std::size_t { return _base; }
+    auto base_reach() const noexcept -> std::uint64_t {
+      return _base_reach;
+    }
+    auto range() const noexcept -> std::uint64_t { return _rule.range(); }
+    auto advance(hashlife_engine<kernel> &engine, pointer node,
+                 std::uint64_t generations) const -> pointer;
+
+  private:
+    void unpack(const hashlife_engine<kernel> &engine, std::size_t level,
+                pointer node, std::vector<std::uint8_t> &grid,
+                std::size_t side, std::size_t x, std::size_t y) const;
+    auto pack(hashlife_engine<kernel> &engine, std::size_t level,
+              const std::vector<std::uint8_t> &grid, std::size_t side,
+              std::size_t x, std::size_t y) const -> pointer;
+
+    ltl_rule _rule;
+    std::size_t _base = 1;         // Lowest level that can be advanced
+    std::uint64_t _base_reach = 1; // Generations its next() results advance
+  };
+
+  hashlife_engine<kernel> _engine;
+};
+} // namespace life
@@ -29,6 +29,7 @@
 #include <unordered_set>
 
 #include "hash.hpp"
+#include "static_vector.hpp"
 
 namespace life {
 /**
@@ -36,15 +37,28 @@ namespace life {
  * For now, just an index, but in the future might exploit the hash set
  * structure or macrocell regularities in other ways.
  * A nullptr is indicated by a std::uint32_t::max value.
+ * The highest bit marks pointers into the nursery of a layer, as opposed to
+ * its tenured table; index() is relative to whichever table is pointed into.
+ * The second-highest bit marks nodes that have been spilled to disk, in which
+ * case index() is the number of their record in the spill file.
  */
 class pointer {
 public:
   static constexpr auto null_value = std::numeric_limits<std::uint32_t>::max();
+  static constexpr auto nursery_flag = std::uint32_t{1} << 31;
+  static constexpr auto spilled_flag = std::uint32_t{1} << 30;
 
   constexpr pointer(std::nullptr_t = nullptr) noexcept : offset{null_value} {}
   constexpr pointer(std::size_t offset) noexcept
       : offset{(std::uint32_t)offset} {}
 
+  static constexpr auto young(std::size_t index) noexcept -> pointer {
+    return pointer{index | nursery_flag};
+  }
+  static constexpr auto spilled(std::size_t record) noexcept -> pointer {
+    return pointer{record | spilled_flag};
+  }
+
   constexpr operator bool() const noexcept { return offset != null_value; }
   constexpr bool operator==(const pointer &other) const noexcept {
     return offset == other.offset;
@@ -55,7 +69,13 @@ public:
   constexpr auto hash() const noexcept { return offset; }
 
   constexpr auto index() const noexcept -> std::size_t {
-    return static_cast<std::size_t>(offset);
+    return static_cast<std::size_t>(offset & ~(nursery_flag | spilled_flag));
+  }
+  constexpr auto nursery() const noexcept -> bool {
+    return *this && (offset & nursery_flag);
+  }
+  constexpr auto spilled() const noexcept -> bool {
+    return *this && (offset & spilled_flag);
   }
 
 private:
@@ -68,11 +88,16 @@ private:
  */
 class macrocell {
 public:
+  macrocell() noexcept = default;
   macrocell(pointer nw, pointer ne, pointer sw, pointer se) noexcept
       : future{nullptr, nullptr}, children{nw, ne, sw, se} {}
 
+  /**
+   * Equality disregards the memoized futures, so that hash-consing finds a
+   * macrocell regardless of which of its results have been computed so far.
+   */
   auto operator==(const macrocell &other) const noexcept {
-    return future == other.future && children == other.children;
+    return children == other.children;
   }
   auto operator!=(const macrocell &other) const noexcept {
     return !(*this == other);
@@ -87,22 +112,56 @@ public:
   auto ne() const noexcept -> pointer { return children[1]; }
   auto sw() const noexcept -> pointer { return children[2]; }
   auto se() const noexcept -> pointer { return children[3]; }
+  auto quadrants() const noexcept -> const std::array<pointer, 4> & {
+    return children;
+  }
+
+  void memoize_step(pointer result) noexcept { future[0] = result; }
+  void memoize_next(pointer result) noexcept { future[1] = result; }
+
+  /**
+   * Counterparts of next() and memoize_next() for macrocells in shared memory,
+   * whose next() result other processes may memoize at any time. These use the
+   * atomic builtins that std::atomic_ref wraps, which is not in C++17.
+   */
+  auto shared_next() const noexcept -> pointer {
+    auto result = pointer{};
+    __atomic_load(&future[1], &result, __ATOMIC_ACQUIRE);
+    return result;
+  }
+  void memoize_shared_next(pointer result) noexcept {
+    __atomic_store(&future[1], &result, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * Rewrites all children and futures through <remap>, a table from old to new
+   * indices of the layer one level down. Futures that no longer exist are
+   * forgotten, as they can always be recomputed. Spilled nodes do not live in
+   * the layer, so pointers to them are left as they are.
+   */
+  void relocate(const static_vector<pointer> &remap) noexcept {
+    translate([&remap](pointer node) {
+      return node.spilled() ? node : remap[node.index()];
+    });
+  }
+
+  /**
+   * As above, but with <function> mapping each old pointer onto its new one.
+   */
+  template <typename Function> void translate(Function &&function) {
+    for (auto &child : children)
+      child = function(child);
+    for (auto &result : future)
+      if (result)
+        result = function(result);
+  }
 
 private:
   std::array<pointer, 2>
-      future; // Stored as one step, then 2^{n-2} steps in the future
+      future; // Stored as 2^j steps for the current j, then 2^{n+1} steps
   std::array<pointer, 4> children; // Stored as nw, ne, sw, se
 };
 
-/**
- * A layer of macrocells allows adding and accessing of all its macrocells,
- * accessed by pointers.
- */
-class layer {
-public:
-private:
-};
-
 } // namespace life
 
 HASHLIFE_DEFINE_HASH(life::pointer);
@@ -0,0 +1,114 @@
+/**
+ * Hashlife
+ * Neighbourhoods of range one, each with its own bit-parallel adder network.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "bitwise.hpp"
+
+namespace life {
+/**
+ * Neighbourhood policies count, for all 64 cells of an 8x8 bitmap at once,
+ * how many cells of their neighbourhood are alive, the cell itself included.
+ * Counts are returned as four bitmaps, holding bits 1, 2, 4 and 8 of the
+ * count of each cell. Neighbours are brought into place by shifting the
+ * bitmap, so only the inner 6x6 counts are correct.
+ *
+ * Each policy also gives the cells of its neighbourhood as a mask over the
+ * 3x3 square around a cell, numbered as in rule_table.
+ */
+using counts = std::array<std::uint64_t, 4>;
+
+/**
+ * All eight surrounding cells. The row above and below are summed from the
+ * horizontal sums of three, as in cells::neighbours(), but without letting
+ * counts of 8 and 9 overflow.
+ */
+struct moore {
+  static constexpr auto neighbours = std::uint32_t{0b111'101'111};
+
+  static auto count(std::uint64_t bitmap) noexcept -> counts {
+    const auto [mid1, mid2] = full_add(bitmap << 1, bitmap, bitmap >> 1);
+    const auto [sum1, carry2] = full_add(mid1 << 8, mid1, mid1 >> 8);
+    const auto [partial2, carry4a] = full_add(mid2 << 8, mid2, mid2 >> 8);
+    const auto [sum2, carry4b] = half_add(carry2, partial2);
+    const auto [sum4, sum8] = half_add(carry4a, carry4b);
+    return {sum1, sum2, sum4, sum8};
+  }
+};
+
+/**
+ * Only the four orthogonally adjacent cells.
+ */
+struct von_neumann {
+  static constexpr auto neighbours = std::uint32_t{0b010'101'010};
+
+  static auto count(std::uint64_t bitmap) noexcept -> counts {
+    const auto [row1, row2] = full_add(bitmap << 1, bitmap, bitmap >> 1);
+    const auto [sum1, column2] = full_add(bitmap << 8, bitmap >> 8, row1);
+    const auto [sum2, sum4] = half_add(row2, column2);
+    return {sum1, sum2, sum4, 0};
+  }
+};
+
+/**
+ * Hexagonal grids are emulated on the square grid by skewing them, so that
+ * the six neighbours of a cell are its Moore neighbours apart from the
+ * north-east and south-west corners.
+ */
+struct hexagonal {
+  static constexpr auto neighbours = std::uint32_t{0b110'101'011};
+
+  static auto count(std::uint64_t bitmap) noexcept -> counts {
+    const auto [above1, above2] = half_add(bitmap << 9, bitmap << 8);
+    const auto [mid1, mid2] = full_add(bitmap << 1, bitmap, bitmap >> 1);
+    const auto [below1, below2] = half_add(bitmap >> 8, bitmap >> 9);
+    const auto [sum1, carry2] = full_add(above1, mid1, below1);
+    const auto [partial2, carry4a] = full_add(above2, mid2, below2);
+    const auto [sum2, carry4b] = half_add(carry2, partial2);
+    return {sum1, sum2, carry4a ^ carry4b, 0};
+  }
+};
+
+/**
+ * Advances the inner 6x6 cells of <bitmap> by one generation under the
+ * outer-totalistic rule whose bit n of <birth> and <survival> tells whether
+ * a cell with n living neighbours is born or survives.
+ */
+template <typename Neighbourhood>
+auto totalistic_step(std::uint64_t bitmap, std::uint16_t birth,
+                     std::uint16_t survival) noexcept -> std::uint64_t {
+  const auto [sum1, sum2, sum4, sum8] = Neighbourhood::count(bitmap);
+  auto matches = [&](std::uint32_t totals) {
+    auto mask = std::uint64_t{0};
+    for (auto total = 0u; total <= 9; ++total)
+      if ((totals >> total) & 1u)
+        mask |= (total & 1u ? sum1 : ~sum1) & (total & 2u ? sum2 : ~sum2) &
+                (total & 4u ? sum4 : ~sum4) & (total & 8u ? sum8 : ~sum8);
+    return mask;
+  };
+  const auto born = ~bitmap & matches(birth);
+  const auto survives = bitmap & matches(std::uint32_t{survival} << 1);
+  constexpr auto inner = 0x007e7e7e7e7e7e00ull; // Edge cells are unknown.
+  return (born | survives) & inner;
+}
+} // namespace life
@@ -0,0 +1,65 @@
+/**
+ * Hashlife
+ * Contents of nodes by digest, for rebuilding them in any universe.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+
+#include "cells.hpp"
+#include "digest.hpp"
+
+namespace life {
+/**
+ * Contents of nodes that are known only by their digests: leaves as bitmaps,
+ * and macrocells as the digests of their quadrants. Together, the records of
+ * a subtree suffice to rebuild it in any universe.
+ */
+class node_records {
+public:
+  auto contains(digest node) const -> bool {
+    return _leaves.count(node) != 0 || _nodes.count(node) != 0;
+  }
+
+  /**
+   * Stores the contents of a node, returning whether they were new.
+   */
+  auto store(digest node, cells leaf) -> bool {
+    return _leaves.emplace(node, leaf).second;
+  }
+  auto store(digest node, const std::array<digest, 4> &quadrants) -> bool {
+    return _nodes.emplace(node, quadrants).second;
+  }
+
+  auto leaf(digest node) const -> cells { return _leaves.at(node); }
+  auto quadrants(digest node) const -> const std::array<digest, 4> & {
+    return _nodes.at(node);
+  }
+
+  auto size() const noexcept -> std::size_t {
+    return _leaves.size() + _nodes.size();
+  }
+
+private:
+  std::unordered_map<digest, cells> _leaves;
+  std::unordered_map<digest, std::array<digest, 4>> _nodes;
+};
+} // namespace life
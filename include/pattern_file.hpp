@@ -0,0 +1,68 @@
+/**
+ * Hashlife
+ * Pattern files, mapped into memory and parsed in place.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace life {
+class universe;
+
+enum class pattern_format {
+  rle,       // Run-length encoded, with an "x = ..., y = ..." header
+  plaintext, // Rows of '.' and 'O', with comment lines starting with '!'
+  life_106,  // "#Life 1.06", followed by the coordinates of living cells
+  macrocell  // "[M2]", followed by the nodes of a quadtree, bottom-up
+};
+
+/**
+ * Pattern file, mapped read-only into memory and parsed right where it lies,
+ * so that reading it involves neither stream buffers nor copies of its text.
+ * The kernel is told that the file will be read sequentially, so that it
+ * reads ahead aggressively and drops the pages that have been parsed.
+ *
+ * The format is recognised from the contents rather than from the name of
+ * the file. Patterns are placed with their top-left cell at the origin,
+ * except for Life 1.06 patterns, whose cells have coordinates of their own,
+ * and macrocells, which are centered as the root of a universe.
+ */
+class pattern_file {
+public:
+  explicit pattern_file(std::string path);
+  pattern_file(const pattern_file &) = delete;
+  auto operator=(const pattern_file &) -> pattern_file & = delete;
+  ~pattern_file();
+
+  auto path() const noexcept -> const std::string & { return _path; }
+  auto text() const noexcept -> std::string_view { return {_data, _size}; }
+  auto format() const noexcept { return _format; }
+  void load_into(universe &target, std::size_t threads = 1) const;
+
+  static auto detect(std::string_view text) -> pattern_format;
+
+private:
+  std::string _path;
+  const char *_data = nullptr;
+  std::size_t _size = 0;
+  pattern_format _format;
+};
+} // namespace life
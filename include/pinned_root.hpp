@@ -0,0 +1,118 @@
+/**
+ * Hashlife
+ * Read-only handle to the root of a universe, for readers on other threads.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cells.hpp"
+#include "epochs.hpp"
+#include "macrocell.hpp"
+
+namespace life {
+/**
+ * A pinned root is the root of a universe as it was when pinned, which other
+ * threads may traverse while the universe keeps advancing. Nodes are never
+ * changed once created, apart from their memoized futures, which readers do
+ * not look at, so traversals take no locks at all.
+ *
+ * While the handle exists, the universe treats its root as one of its own,
+ * so that its nodes are not freed, and tables that are rebuilt are retired
+ * rather than freed, as the handle pins an epoch of the universe. Readers
+ * keep reading the tables as they were when pinned.
+ *
+ * Handles may be moved to, and destroyed on, any thread, but the universe
+ * must outlive them.
+ */
+class pinned_root {
+public:
+  pinned_root(const pinned_root &) = delete;
+  pinned_root(pinned_root &&other) noexcept;
+  auto operator=(const pinned_root &) -> pinned_root & = delete;
+  auto operator=(pinned_root &&other) noexcept -> pinned_root &;
+  ~pinned_root();
+
+  auto level() const noexcept { return _level; }
+  auto generation() const noexcept { return _generation; }
+  auto get(std::int64_t x, std::int64_t y) const noexcept -> bool;
+  auto block(std::int64_t x, std::int64_t y) const noexcept -> cells;
+  auto population() const -> std::uint64_t;
+  template <typename Function> void for_each_block(Function &&function) const;
+
+private:
+  friend class universe;
+
+  pinned_root(std::shared_ptr<epochs> readers, std::uint64_t ticket,
+              std::vector<const macrocell *> nodes, const cells *leaves,
+              std::vector<pointer> empty, pointer root, std::size_t level,
+              std::uint64_t generation) noexcept;
+
+  auto node(std::size_t level, pointer node) const noexcept
+      -> const macrocell & {
+    return _nodes[level - 1][node.index()];
+  }
+  auto leaf(pointer leaf) const noexcept -> cells {
+    return _leaves[leaf.index()];
+  }
+  template <typename Function>
+  void for_each_block(std::size_t level, pointer node, std::int64_t x,
+                      std::int64_t y, Function &function) const;
+
+  std::shared_ptr<epochs> _readers;
+  std::uint64_t _ticket = 0;
+  std::vector<const macrocell *> _nodes; // Tables as pinned, by level - 1
+  const cells *_leaves = nullptr;
+  std::vector<pointer> _empty; // Empty node of each level
+  pointer _root;
+  std::size_t _level = 0;
+  std::uint64_t _generation = 0;
+};
+
+/**
+ * Calls <function> with the coordinates of the top-left cell of every 8x8
+ * block that has living cells, and the block itself. Empty parts of the tree
+ * are skipped as a whole.
+ */
+template <typename Function>
+void pinned_root::for_each_block(Function &&function) const {
+  const auto half = (std::int64_t{cells::columns} << _level) / 2;
+  for_each_block(_level, _root, -half, -half, function);
+}
+
+template <typename Function>
+void pinned_root::for_each_block(std::size_t level, pointer node,
+                                 std::int64_t x, std::int64_t y,
+                                 Function &function) const {
+  if (node == _empty[level])
+    return;
+  if (level == 0) {
+    function(x, y, leaf(node));
+    return;
+  }
+  const auto half = (std::int64_t{cells::columns} << level) / 2;
+  const auto &cell = this->node(level, node);
+  for_each_block(level - 1, cell.nw(), x, y, function);
+  for_each_block(level - 1, cell.ne(), x + half, y, function);
+  for_each_block(level - 1, cell.sw(), x, y + half, function);
+  for_each_block(level - 1, cell.se(), x + half, y + half, function);
+}
+} // namespace life
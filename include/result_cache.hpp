@@ -0,0 +1,89 @@
+/**
+ * Hashlife
+ * Persistent cache of computed results, keyed by the contents of the nodes
+ * they were computed from.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "cells.hpp"
+#include "digest.hpp"
+#include "hash.hpp"
+#include "node_records.hpp"
+
+namespace life {
+/**
+ * Maps the digest of a node and a step exponent onto the digest of the
+ * center of that node, 2^exponent generations later. Since a digest only
+ * identifies a node, the contents of every result are stored as well, as
+ * leaf bitmaps and quadrant digests, so that results can be rebuilt in any
+ * universe. Shared subtrees are stored only once.
+ *
+ * The cache is kept in an append-only file that is read back when the cache
+ * is opened again, so that later runs can reuse the results of earlier ones.
+ * A record that was cut short is discarded, together with anything after it.
+ */
+class result_cache {
+public:
+  explicit result_cache(std::string path);
+
+  auto find(digest node, std::size_t exponent) const -> digest;
+  void insert(digest node, std::size_t exponent, digest result);
+
+  auto contains(digest node) const -> bool;
+  void store(digest node, cells leaf);
+  void store(digest node, const std::array<digest, 4> &quadrants);
+  auto leaf(digest node) const -> cells;
+  auto quadrants(digest node) const -> const std::array<digest, 4> &;
+
+  auto records() const noexcept -> const node_records & { return _records; }
+  auto path() const noexcept -> const std::string & { return _path; }
+  auto size() const noexcept { return _results.size(); }
+
+private:
+  struct key {
+    digest node;
+    std::uint32_t exponent;
+
+    bool operator==(const key &other) const noexcept {
+      return node == other.node && exponent == other.exponent;
+    }
+    auto hash() const noexcept -> std::size_t {
+      return variadic_hash(node, exponent);
+    }
+  };
+  struct key_hash {
+    auto operator()(const key &k) const noexcept -> std::size_t {
+      return k.hash();
+    }
+  };
+
+  template <typename... Words> void write(char tag, const Words &... words);
+
+  std::string _path;
+  std::unordered_map<key, digest, key_hash> _results;
+  node_records _records;
+  std::ofstream _file;
+};
+} // namespace life
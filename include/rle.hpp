@@ -0,0 +1,74 @@
+/**
+ * Hashlife
+ * Patterns in the run-length encoded format, decoded in parallel chunks.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "universe.hpp"
+
+namespace life {
+class thread_pool;
+
+/**
+ * Pattern read from the run-length encoded format: optional comment lines
+ * starting with '#', a header line such as "x = 3, y = 3, rule = B3/S23",
+ * and a body of runs, each an optional count followed by 'b' or '.' for dead
+ * cells, any other letter for living ones, or '$' for the end of a row. The
+ * body ends at '!', and whitespace between runs is ignored.
+ *
+ * Large bodies are decoded in parallel. The body is cut into chunks just
+ * after a '$', so that every chunk consists of whole runs; the rows each
+ * chunk advances are counted first, from which every chunk learns the row
+ * it starts at, after which all chunks are decoded independently into bands
+ * of leaves. Only the bands in which adjacent chunks meet need merging.
+ *
+ * The pattern is kept as its non-empty blocks, in row-major order, with the
+ * top-left cell of the pattern at the origin, ready to be set in a universe
+ * in one go.
+ */
+class rle_pattern {
+public:
+  static auto parse(std::string_view text, std::size_t threads = 1)
+      -> rle_pattern;
+  static auto parse(std::string_view text, thread_pool &pool) -> rle_pattern;
+
+  auto width() const noexcept { return _width; }
+  auto height() const noexcept { return _height; }
+  auto rule() const noexcept -> const std::string & { return _rule; }
+  auto blocks() const noexcept -> const std::vector<placed_block> & {
+    return _blocks;
+  }
+  auto population() const noexcept -> std::uint64_t;
+
+private:
+  template <typename Run>
+  static auto parse(std::string_view text, std::size_t chunks, Run &&run)
+      -> rle_pattern;
+
+  std::int64_t _width = 0, _height = 0; // As given by the header
+  std::string _rule = "B3/S23";
+  std::vector<placed_block> _blocks;
+};
+} // namespace life
@@ -0,0 +1,80 @@
+/**
+ * Hashlife
+ * Rules given as the outcome of every possible 3x3 neighbourhood, including
+ * the isotropic non-totalistic rules.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "cells.hpp"
+
+namespace life {
+/**
+ * The neighbour count of cells::step() throws away where the neighbours are,
+ * which isotropic non-totalistic rules depend on. A rule table instead stores
+ * the next state of a cell for each of the 512 possible neighbourhoods, which
+ * are numbered by reading the 3x3 square around the cell row by row, with the
+ * top-left cell as lowest bit and the cell itself as bit 4.
+ *
+ * Tables are compiled from rule strings in Hensel notation, such as
+ * "B2-a/S12": each neighbour count may be followed by the letters of the
+ * configurations it is restricted to, or by a minus and the letters of the
+ * configurations it excludes. Counts without letters are totalistic, so that
+ * ordinary rules such as "B3/S23" are accepted as well.
+ *
+ * A trailing "V" or "H" restricts the neighbourhood to the four orthogonal
+ * neighbours (von Neumann) or to the six neighbours of a hexagonal grid
+ * emulated on the square one; letters are only defined for the full Moore
+ * neighbourhood.
+ *
+ * Rules in which empty space comes alive (B0) cannot be represented by a
+ * quadtree of finite patterns, and are therefore rejected.
+ *
+ * Lookups are only the fallback for advancing squares: tables that turn out
+ * to be outer-totalistic over one of the neighbourhood policies are advanced
+ * by the adder network of that neighbourhood instead.
+ */
+class rule_table {
+public:
+  rule_table() noexcept = default;
+  static auto parse(std::string_view rule) -> rule_table;
+  static auto conway() -> rule_table { return parse("B3/S23"); }
+
+  auto operator==(const rule_table &other) const noexcept -> bool;
+  auto operator!=(const rule_table &other) const noexcept -> bool;
+  auto operator()(std::uint32_t neighbourhood) const noexcept -> bool;
+  void set(std::uint32_t neighbourhood, bool alive) noexcept;
+
+  auto step(cells square) const noexcept -> cells;
+  auto next(cells square) const noexcept -> cells;
+
+private:
+  enum class kernel { lookup, moore, von_neumann, hexagonal };
+
+  template <typename Neighbourhood> auto totalistic() noexcept -> bool;
+  void compile() noexcept;
+
+  std::array<std::uint64_t, 8> _table = {}; // Bit n: outcome of neighbourhood n
+  kernel _kernel = kernel::lookup;
+  std::uint16_t _birth = 0, _survival = 0; // By neighbour count, if totalistic
+};
+} // namespace life
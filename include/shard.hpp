@@ -0,0 +1,139 @@
+/**
+ * Hashlife
+ * Batches of work exchanged between a universe and the shards it spans.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cells.hpp"
+#include "digest.hpp"
+#include "node_records.hpp"
+#include "transport.hpp"
+
+namespace life {
+/**
+ * Batch of work exchanged between a universe and one of its shards. Requests
+ * name the nodes to advance, and replies their results, both by digest, as
+ * pointers mean nothing to another process. Records of the nodes that the
+ * receiver has not seen yet precede the entries referring to them, children
+ * before parents, so that every node crosses each connection at most once,
+ * until the client has both ends forget what crossed it so far.
+ */
+class shard_message {
+public:
+  /**
+   * Request or reply, where requests have the unknown digest as result.
+   */
+  struct entry {
+    std::size_t level;
+    digest node;
+    digest result;
+  };
+
+  shard_message() = default;
+  explicit shard_message(std::vector<std::uint64_t> words) noexcept
+      : _words{std::move(words)} {}
+
+  void record(digest node, cells leaf);
+  void record(digest node, const std::array<digest, 4> &quadrants);
+  void request(std::size_t level, digest node);
+  void reply(std::size_t level, digest node, digest result);
+  void forget();
+  auto forgets() const noexcept -> bool {
+    return !_words.empty() && _words.front() == forget_tag;
+  }
+  auto read(node_records &records, std::unordered_set<digest> &known) const
+      -> std::vector<entry>;
+
+  auto empty() const noexcept { return _words.empty(); }
+  auto words() const noexcept -> const std::vector<std::uint64_t> & {
+    return _words;
+  }
+
+private:
+  enum tag : std::uint64_t {
+    leaf_tag = 1,
+    node_tag,
+    request_tag,
+    reply_tag,
+    forget_tag
+  };
+
+  void put(digest node);
+
+  std::vector<std::uint64_t> _words;
+};
+
+/**
+ * The side of a universe that hands work to its shards. Digests are divided
+ * into as many equal ranges as there are shards: the first range is owned by
+ * the universe itself, and the others by the processes at the other ends of
+ * its transports. For each shard, the client tracks which nodes it has sent
+ * there, so that none is sent twice, and results are kept by digest, so that
+ * they need not be asked for again once the universe has let go of them.
+ *
+ * Once more than <capacity> records are kept, trim() drops all of them,
+ * along with the known nodes and results, and the next batch to each shard
+ * has it do the same. Nodes are then sent again as needed, so the memory of
+ * both ends stays bounded however long the universe runs.
+ *
+ * Sharding spreads the computation, not the tree: the universe still holds
+ * every node of its pattern, including those whose results other shards
+ * own, since it builds their subnodes and results itself. A pattern must
+ * therefore fit in the memory of the client's host; sharding only divides
+ * the work of advancing it between hosts.
+ */
+class shard_client {
+public:
+  explicit shard_client(std::vector<std::unique_ptr<transport>> links,
+                        std::size_t capacity = std::size_t{1} << 20);
+
+  auto shards() const noexcept { return _links.size() + 1; }
+  auto owner(digest node) const noexcept -> std::size_t;
+  auto known(std::size_t shard) -> std::unordered_set<digest> & {
+    return _known[shard];
+  }
+  auto future(digest node) const -> digest;
+  auto records() const noexcept -> const node_records & { return _records; }
+  auto batches() const -> std::vector<shard_message>;
+  void exchange(const std::vector<shard_message> &batches);
+  void trim();
+
+  auto requested() const noexcept { return _requested; }
+  auto exchanges() const noexcept { return _exchanges; }
+
+private:
+  std::vector<std::unique_ptr<transport>> _links; // Of shard 1 onwards
+  std::vector<std::unordered_set<digest>> _known; // Sent to or by each shard
+  node_records _records;                          // Sent to or by any shard
+  std::unordered_map<digest, digest> _futures;    // Node to next() result
+  std::vector<bool> _forgetting; // Shards yet to be told to forget
+  std::size_t _capacity;         // Records kept before all are dropped
+  std::size_t _requested = 0;
+  std::size_t _exchanges = 0;
+};
+} // namespace life
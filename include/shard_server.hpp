@@ -0,0 +1,67 @@
+/**
+ * Hashlife
+ * Process advancing the nodes that a distributed universe hands it.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "digest.hpp"
+#include "node_records.hpp"
+#include "rule_table.hpp"
+#include "transport.hpp"
+#include "universe.hpp"
+
+namespace life {
+/**
+ * The side of a shard that does the work: it rebuilds the nodes a universe
+ * hands it in a universe of its own, advances them there, and replies with
+ * their results. Its universe keeps all nodes and results it has computed,
+ * so the memory of a run is spread over its shards along with the work, and
+ * a node asked for twice is computed only once. What crossed the connection
+ * is dropped whenever the client says so.
+ *
+ * A server answers a single universe, over a single transport, one batch at
+ * a time. Shards do not hand work to one another.
+ */
+class shard_server {
+public:
+  explicit shard_server(std::unique_ptr<transport> link,
+                        const rule_table &rule = rule_table::conway());
+
+  auto serve_one() -> bool;
+  void serve();
+
+  auto evaluated() const noexcept { return _evaluated; }
+  auto requested() const noexcept { return _requested; }
+  auto records() const noexcept -> const node_records & { return _records; }
+
+private:
+  std::unique_ptr<transport> _link;
+  universe _universe;
+  node_records _records;                       // Sent to or by the client
+  std::unordered_set<digest> _known;           // Sent to or by the client
+  std::unordered_map<digest, digest> _futures; // Node to next() result
+  std::size_t _evaluated = 0;
+  std::size_t _requested = 0;
+};
+} // namespace life
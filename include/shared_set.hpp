@@ -0,0 +1,428 @@
+/**
+ * Hashlife
+ * Hash set of fixed capacity in shared memory, into which several processes
+ * may insert concurrently.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace life {
+/**
+ * Open-addressing hash set that lives in a named POSIX shared memory object,
+ * so that every process opening the same name sees the same elements at the
+ * same indices. Elements are addressed by index only, never by address, as
+ * each process maps the object wherever it likes.
+ *
+ * Elements are never erased, so a slot only ever goes from empty, through
+ * claimed, to filled. An insertion claims an empty slot with a single
+ * compare-and-swap, writes the element, and then publishes it with another,
+ * which fails only if the claim was taken over meanwhile. A process that
+ * probes past a claimed slot waits for it to be published, which only takes
+ * the few instructions needed to copy the element. Two processes inserting
+ * the same element therefore always end up agreeing on a single index.
+ *
+ * Claims record the process id of the claimant, along with its start time,
+ * so that a process that reuses the id of a dead claimant is not mistaken for
+ * it. Should a process die in between claiming and publishing, its slot would
+ * stay claimed forever, so a process that has waited for a while checks
+ * whether the claimant still exists, and empties the slot again if it does
+ * not. Process ids are only meaningful within a single PID namespace, so all
+ * processes using a set must share one; start times are read from /proc, and
+ * without it only the process id is checked.
+ *
+ * Elements may still be modified in place once published, but only by
+ * writing values that every writer agrees on, such as memoized results.
+ *
+ * The capacity is fixed when the object is created: shared tables cannot be
+ * rehashed, since other processes hold indices into them.
+ */
+template <typename Key, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class shared_set {
+  static_assert(std::is_trivially_copyable_v<Key>,
+                "shared_set: elements must be trivially copyable");
+
+public:
+  using key_type = Key;
+  using value_type = Key;
+  using size_type = std::size_t;
+
+  shared_set(std::string name, size_type capacity, size_type probe_limit = 32);
+  shared_set(const shared_set &) = delete;
+  shared_set(shared_set &&other) noexcept;
+  ~shared_set();
+
+  auto operator=(const shared_set &) -> shared_set & = delete;
+  auto operator=(shared_set &&other) noexcept -> shared_set &;
+
+  auto name() const noexcept -> const std::string & { return _name; }
+  auto size() const noexcept -> size_type {
+    return _header->size.load(std::memory_order_relaxed);
+  }
+  auto capacity() const noexcept -> size_type { return _header->capacity; }
+  auto probe_limit() const noexcept { return _probe_limit; }
+
+  auto emplace(const Key &key) -> std::pair<size_type, bool>;
+  auto find(const Key &key) const noexcept -> size_type;
+  auto filled(size_type index) const noexcept -> bool;
+  auto operator[](size_type index) noexcept -> Key &;
+  auto operator[](size_type index) const noexcept -> const Key &;
+
+  static void remove(const std::string &name) noexcept;
+
+private:
+  static constexpr auto magic = std::uint32_t{0x53534c48}; // "HLSS"
+  static constexpr auto empty = std::uint64_t{0};
+  static constexpr auto claimed_flag = std::uint64_t{1};
+  static constexpr auto filled_flag = std::uint64_t{2};
+  static constexpr auto patience = 1024u; // Waits before checking a claimant
+
+  struct header {
+    std::atomic<std::uint32_t> ready;
+    std::uint32_t magic;
+    std::uint64_t capacity;
+    std::uint64_t element_size;
+    std::atomic<std::uint64_t> size;
+  };
+
+  struct slot {
+    std::atomic<std::uint64_t> state; // Empty, claimant, or a tag
+    Key key;
+  };
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "shared_set: slot states must be lock-free across processes");
+
+  static auto tag(std::size_t hash) noexcept -> std::uint64_t {
+    return static_cast<std::uint64_t>(hash) << 2 | filled_flag;
+  }
+  static auto claim() noexcept -> std::uint64_t;
+  static auto started(pid_t process) noexcept -> std::uint32_t;
+  static auto abandoned(std::uint64_t state) noexcept -> bool;
+  auto slots() const noexcept -> slot * {
+    return reinterpret_cast<slot *>(_header + 1);
+  }
+  auto wait(size_type index) const noexcept -> std::uint64_t;
+  void unmap() noexcept;
+
+  std::string _name;
+  header *_header = nullptr;
+  std::size_t _bytes = 0;
+  size_type _probe_limit;
+};
+
+/**
+ * Opens the shared set called <name>, creating it with room for <capacity>
+ * elements if it does not exist yet. A new object is zero-filled by the
+ * system, which conveniently marks every slot as empty; only the header has
+ * to be written, after which the set is marked as ready for other processes.
+ * Throws std::domain_error if an existing set has a different layout.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+shared_set<Key, Hash, KeyEqual>::shared_set(std::string name,
+                                            size_type capacity,
+                                            size_type probe_limit)
+    : _name{std::move(name)},
+      _bytes{sizeof(header) + capacity * sizeof(slot)}, _probe_limit{
+                                                            probe_limit} {
+  static_assert(sizeof(header) % alignof(slot) == 0);
+  if (capacity == 0)
+    throw std::domain_error{"shared_set: capacity must be positive"};
+
+  auto created = true;
+  auto descriptor = ::shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (descriptor < 0 && errno == EEXIST) {
+    created = false;
+    descriptor = ::shm_open(_name.c_str(), O_RDWR, 0600);
+  }
+  if (descriptor < 0)
+    throw std::runtime_error{"shared_set: unable to open " + _name};
+
+  if (created && ::ftruncate(descriptor, static_cast<off_t>(_bytes)) != 0) {
+    ::close(descriptor);
+    ::shm_unlink(_name.c_str());
+    throw std::runtime_error{"shared_set: unable to size " + _name};
+  }
+  if (!created) { // Wait for the creator to size the object
+    struct stat status {};
+    while (::fstat(descriptor, &status) == 0 &&
+           static_cast<std::size_t>(status.st_size) < sizeof(header))
+      std::this_thread::yield();
+    _bytes = static_cast<std::size_t>(status.st_size);
+  }
+
+  auto address = ::mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        descriptor, 0);
+  ::close(descriptor);
+  if (address == MAP_FAILED)
+    throw std::runtime_error{"shared_set: unable to map " + _name};
+  _header = static_cast<header *>(address);
+
+  if (created) {
+    _header->magic = magic;
+    _header->capacity = capacity;
+    _header->element_size = sizeof(Key);
+    _header->ready.store(1, std::memory_order_release);
+    return;
+  }
+
+  while (_header->ready.load(std::memory_order_acquire) == 0)
+    std::this_thread::yield();
+  if (_header->magic != magic || _header->capacity != capacity ||
+      _header->element_size != sizeof(Key)) {
+    unmap();
+    throw std::domain_error{"shared_set: " + _name + " has another layout"};
+  }
+}
+
+template <typename Key, typename Hash, typename KeyEqual>
+shared_set<Key, Hash, KeyEqual>::shared_set(shared_set &&other) noexcept
+    : _name{std::move(other._name)},
+      _header{std::exchange(other._header, nullptr)},
+      _bytes{other._bytes}, _probe_limit{other._probe_limit} {}
+
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::operator=(shared_set &&other) noexcept
+    -> shared_set & {
+  if (this != &other) {
+    unmap();
+    _name = std::move(other._name);
+    _header = std::exchange(other._header, nullptr);
+    _bytes = other._bytes;
+    _probe_limit = other._probe_limit;
+  }
+  return *this;
+}
+
+/**
+ * Unmaps the set, which lives on for as long as other processes use it, or
+ * until it is removed.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+shared_set<Key, Hash, KeyEqual>::~shared_set() {
+  unmap();
+}
+
+template <typename Key, typename Hash, typename KeyEqual>
+void shared_set<Key, Hash, KeyEqual>::unmap() noexcept {
+  if (_header)
+    ::munmap(_header, _bytes);
+  _header = nullptr;
+}
+
+/**
+ * Removes the shared set called <name>. Processes that still have it mapped
+ * can keep on using it.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+void shared_set<Key, Hash, KeyEqual>::remove(const std::string &name) noexcept {
+  ::shm_unlink(name.c_str());
+}
+
+/**
+ * Returns the claim of this process: its id, shifted past the flags, and the
+ * low half of its start time above that. The claim is cached, but redone
+ * after a fork, as the child has an id and start time of its own.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::claim() noexcept -> std::uint64_t {
+  static auto cached = std::atomic<std::uint64_t>{empty};
+  auto id = static_cast<std::uint32_t>(::getpid());
+  auto result = cached.load(std::memory_order_relaxed);
+  if (static_cast<std::uint32_t>(result) >> 2 != id) {
+    result = std::uint64_t{started(::getpid())} << 32 |
+             std::uint64_t{id} << 2 | claimed_flag;
+    cached.store(result, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+/**
+ * Returns the low half of the start time of <process> in clock ticks since
+ * boot, the 22nd field of its stat file, or zero if that cannot be read.
+ * The command name in the second field may hold spaces and parentheses, so
+ * fields are counted from the last closing parenthesis.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::started(pid_t process) noexcept
+    -> std::uint32_t {
+  try {
+    auto file = std::ifstream{"/proc/" + std::to_string(process) + "/stat"};
+    auto line = std::string{};
+    if (!std::getline(file, line) || line.rfind(')') == std::string::npos)
+      return 0;
+    auto field = std::size_t{2};
+    auto position = line.rfind(')') + 1;
+    while (position != std::string::npos && ++field < 22)
+      position = line.find(' ', position + 1);
+    if (position == std::string::npos)
+      return 0;
+    return static_cast<std::uint32_t>(std::stoull(line.substr(position + 1)));
+  } catch (...) {
+    return 0;
+  }
+}
+
+/**
+ * Checks whether the claimant of <state> no longer exists, because there is
+ * no process with its id, or because the process with its id started at
+ * another time. Unknown start times are taken to match.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::abandoned(std::uint64_t state) noexcept
+    -> bool {
+  auto id = static_cast<pid_t>(static_cast<std::uint32_t>(state) >> 2);
+  if (::kill(id, 0) != 0 && errno == ESRCH)
+    return true;
+  auto start = started(id);
+  return start != 0 && start != static_cast<std::uint32_t>(state >> 32);
+}
+
+/**
+ * Returns the state of the slot at <index> once it is no longer claimed,
+ * which may be empty if its claimant died without publishing it.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::wait(size_type index) const noexcept
+    -> std::uint64_t {
+  auto &slot = slots()[index];
+  auto state = slot.state.load(std::memory_order_acquire);
+  for (auto waits = 1u; state & claimed_flag; ++waits) {
+    if (waits % patience == 0 && abandoned(state)) {
+      if (slot.state.compare_exchange_strong(state, empty,
+                                             std::memory_order_acquire))
+        state = empty;
+      continue;
+    }
+    std::this_thread::yield();
+    state = slot.state.load(std::memory_order_acquire);
+  }
+  return state;
+}
+
+/**
+ * Returns the index of <key>, inserting it if it did not exist yet, and
+ * whether an insertion took place. Returns the capacity as index if <key>
+ * is new but there is no empty slot within the probe limit.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::emplace(const Key &key)
+    -> std::pair<size_type, bool> {
+  auto hash = Hash{}(key);
+  auto expected = tag(hash);
+  auto index = hash % capacity();
+
+  const auto mine = claim();
+  for (auto probes = 0u; probes < _probe_limit && probes < capacity();
+       ++probes, index = (index + 1) % capacity()) {
+    auto &slot = slots()[index];
+    auto state = empty;
+    while (state == empty) {
+      while (!slot.state.compare_exchange_strong(state, mine,
+                                                 std::memory_order_acquire))
+        if ((state = wait(index)) != empty)
+          break;
+      if (state != empty)
+        break;
+
+      slot.key = key;
+      state = mine;
+      if (slot.state.compare_exchange_strong(state, expected,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        _header->size.fetch_add(1, std::memory_order_relaxed);
+        return {index, true};
+      }
+      state = wait(index); // Our claim was taken over, so look again
+    }
+    if (state == expected && KeyEqual{}(slot.key, key))
+      return {index, false};
+  }
+  return {capacity(), false};
+}
+
+/**
+ * Returns the index of <key>, or the capacity if it does not exist.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::find(const Key &key) const noexcept
+    -> size_type {
+  auto hash = Hash{}(key);
+  auto expected = tag(hash);
+  auto index = hash % capacity();
+
+  for (auto probes = 0u; probes < _probe_limit && probes < capacity();
+       ++probes, index = (index + 1) % capacity()) {
+    auto state = wait(index);
+    if (state == empty)
+      break;
+    if (state == expected && KeyEqual{}(slots()[index].key, key))
+      return index;
+  }
+  return capacity();
+}
+
+/**
+ * Checks whether the slot at <index> holds a published element.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::filled(size_type index) const noexcept
+    -> bool {
+  assert(index < capacity() && "shared_set: Index access out of bound");
+  return slots()[index].state.load(std::memory_order_acquire) & filled_flag;
+}
+
+/**
+ * Indexing is checked in debug mode to ensure that accessed elements actually
+ * exist. The state is read regardless, to synchronize with the process that
+ * published the element.
+ */
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::operator[](size_type index) noexcept
+    -> Key & {
+  [[maybe_unused]] auto published = filled(index);
+  assert(published && "shared_set: Trying to access non-existent element");
+  return slots()[index].key;
+}
+
+template <typename Key, typename Hash, typename KeyEqual>
+auto shared_set<Key, Hash, KeyEqual>::operator[](size_type index) const
+    noexcept -> const Key & {
+  [[maybe_unused]] auto published = filled(index);
+  assert(published && "shared_set: Trying to access non-existent element");
+  return slots()[index].key;
+}
+} // namespace life
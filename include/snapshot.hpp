@@ -0,0 +1,96 @@
+/**
+ * Hashlife
+ * Compacted, immutable copy of a universe, laid out for fast traversal.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cells.hpp"
+#include "macrocell.hpp"
+#include "universe.hpp"
+
+namespace life {
+/**
+ * In the layers of a universe, nodes are located wherever their hash places
+ * them, so any traversal of the tree jumps through memory at random.
+ * A snapshot stores only the nodes reachable from the root, numbered in
+ * depth-first order with quadrants visited in Z-order (nw, ne, sw, se), with
+ * all children and futures rewritten to the new numbering. The root is the
+ * first node of the top level, and parents always precede their children, so
+ * traversals become sequential streams through each level.
+ */
+class snapshot {
+public:
+  snapshot(std::vector<cells> leaves, std::vector<std::vector<macrocell>> nodes,
+           std::uint64_t generation = 0);
+
+  auto level() const noexcept -> std::size_t { return _nodes.size(); }
+  auto generation() const noexcept { return _generation; }
+  auto population() const noexcept -> std::uint64_t;
+  auto get(std::int64_t x, std::int64_t y) const noexcept -> bool;
+
+  auto leaves() const noexcept -> const std::vector<cells> & { return _leaves; }
+  auto nodes(std::size_t level) const noexcept
+      -> const std::vector<macrocell> & {
+    return _nodes[level - 1];
+  }
+
+  template <typename Function> void for_each_leaf(Function &&function) const;
+
+private:
+  template <typename Function>
+  void for_each_leaf(std::size_t level, pointer node, std::int64_t x,
+                     std::int64_t y, Function &function) const;
+
+  std::vector<cells> _leaves;
+  std::vector<std::vector<macrocell>> _nodes; // Level n is stored at n - 1
+  std::vector<std::vector<std::uint64_t>> _population; // Per level and node
+  std::uint64_t _generation;
+};
+
+/**
+ * Calls <function> with the coordinates of the top-left cell and the contents
+ * of every non-empty leaf, in Z-order. Empty subtrees are skipped entirely.
+ */
+template <typename Function>
+void snapshot::for_each_leaf(Function &&function) const {
+  auto half = universe::side(level()) / 2;
+  for_each_leaf(level(), pointer{std::size_t{0}}, -half, -half, function);
+}
+
+template <typename Function>
+void snapshot::for_each_leaf(std::size_t level, pointer node, std::int64_t x,
+                             std::int64_t y, Function &function) const {
+  if (_population[level][node.index()] == 0)
+    return;
+  if (level == 0) {
+    function(x, y, _leaves[node.index()]);
+    return;
+  }
+
+  auto half = universe::side(level) / 2;
+  const auto &cell = nodes(level)[node.index()];
+  for_each_leaf(level - 1, cell.nw(), x, y, function);
+  for_each_leaf(level - 1, cell.ne(), x + half, y, function);
+  for_each_leaf(level - 1, cell.sw(), x, y + half, function);
+  for_each_leaf(level - 1, cell.se(), x + half, y + half, function);
+}
+} // namespace life
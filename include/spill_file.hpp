@@ -0,0 +1,76 @@
+/**
+ * Hashlife
+ * Append-only file of nodes that were moved out of memory, from which they
+ * can be read back on demand.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "cells.hpp"
+#include "macrocell.hpp"
+
+namespace life {
+/**
+ * Nodes are stored as fixed-size records, numbered in order of appending, and
+ * are referred to by spilled pointers holding that number. Records are never
+ * modified, so a spilled subtree stays valid for as long as the file exists.
+ * Children of a spilled macrocell must have been spilled before it, with the
+ * exception of empty nodes: these are stored as the <empty> marker, so that
+ * they can be replaced by the empty node of the universe on their way back.
+ * Only the result of next() is kept, since that of step() depends on the step
+ * size at the time.
+ *
+ * Recently read records are cached, so that repeated visits to a paged-in
+ * subtree do not each go to disk.
+ */
+class spill_file {
+public:
+  static constexpr auto empty = pointer::spilled((std::size_t{1} << 30) - 1);
+
+  explicit spill_file(std::string path);
+  spill_file(const spill_file &) = delete;
+  auto operator=(const spill_file &) -> spill_file & = delete;
+  ~spill_file();
+
+  auto append(cells leaf) -> pointer;
+  auto append(const macrocell &node) -> pointer;
+  auto leaf(pointer node) const -> cells;
+  auto node(pointer node) const -> macrocell;
+
+  auto size() const noexcept { return _records; }
+  auto path() const noexcept -> const std::string & { return _path; }
+
+private:
+  using record = std::array<std::uint32_t, 6>;
+  static constexpr auto cache_limit = std::size_t{1} << 16;
+
+  auto append(const record &data) -> pointer;
+  auto read(pointer node) const -> const record &;
+
+  std::string _path;
+  mutable std::fstream _file;
+  std::size_t _records = 0;
+  mutable std::unordered_map<std::size_t, record> _cache;
+};
+} // namespace life
@@ -0,0 +1,47 @@
+/**
+ * Hashlife
+ * Dense grids of cells written as text, parsed eight characters at a time.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "universe.hpp"
+
+namespace life {
+/**
+ * Reading a dense grid character by character spends a branch on every
+ * cell. Instead, rows are read eight characters at a time as a single word,
+ * which is compared against the character of living cells with bitwise
+ * arithmetic on all eight bytes at once. The comparison leaves the high bit
+ * of every matching byte set, and a single multiplication gathers those
+ * eight bits into a byte, which is exactly one row of a leaf.
+ *
+ * Words containing any character other than those of dead and living cells
+ * are read one character at a time, so that whitespace and errors are dealt
+ * with as usual: a space in a plaintext grid is a dead cell, whereas the
+ * cell format skips whitespace altogether, as cells() does. Characters that
+ * are neither are rejected by both, rather than ignored as in cells().
+ * Grids are returned as their non-empty blocks, in row-major order, with the
+ * top-left cell at the origin.
+ */
+auto parse_rokicki(std::string_view text) -> std::vector<placed_block>;
+auto parse_plaintext(std::string_view text) -> std::vector<placed_block>;
+} // namespace life
@@ -0,0 +1,76 @@
+/**
+ * Hashlife
+ * Pool of worker threads, optionally pinned to CPUs, for fork-join jobs.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace life {
+/**
+ * Starting a thread per job costs more than many jobs take, and threads that
+ * the scheduler moves around lose their caches and, on hosts with several
+ * NUMA nodes, end up far from the memory they first touched: pages are placed
+ * on the node of the thread that first writes them. A thread pool therefore
+ * keeps a fixed set of workers around, which may each be pinned to a CPU.
+ *
+ * Jobs are fork-join: run() calls a function once on every worker, with the
+ * number of that worker, and returns once all of them are done. Work that is
+ * always handed to the same worker, such as a band of rows, thus stays on the
+ * same CPU, and on memory local to it if that worker placed it.
+ */
+class thread_pool {
+public:
+  explicit thread_pool(std::size_t threads, std::vector<unsigned> cpus = {});
+  thread_pool(const thread_pool &) = delete;
+  auto operator=(const thread_pool &) -> thread_pool & = delete;
+  ~thread_pool();
+
+  auto size() const noexcept { return _workers.size(); }
+  auto pinned() const noexcept { return !_cpus.empty(); }
+  auto cpu(std::size_t worker) const -> unsigned;
+  auto node(std::size_t worker) const -> std::size_t;
+  void run(const std::function<void(std::size_t)> &job);
+
+  static auto numa_nodes() -> std::vector<std::vector<unsigned>>;
+  static auto spread(std::size_t threads) -> std::vector<unsigned>;
+  static auto spread(std::vector<std::vector<unsigned>> nodes,
+                     std::size_t threads) -> std::vector<unsigned>;
+
+private:
+  void work(std::size_t worker);
+  void stop() noexcept;
+
+  std::vector<std::thread> _workers;
+  std::vector<unsigned> _cpus; // Of each worker, if pinned
+  std::mutex _mutex;
+  std::condition_variable _wake, _done;
+  const std::function<void(std::size_t)> *_job = nullptr;
+  std::uint64_t _round = 0; // Number of jobs started
+  std::size_t _pending = 0; // Workers yet to finish the current job
+  std::exception_ptr _error;
+  bool _stopping = false;
+};
+} // namespace life
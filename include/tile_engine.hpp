@@ -0,0 +1,96 @@
+/**
+ * Hashlife
+ * Direct simulation of a sparse set of 8x8 tiles, for patterns on which
+ * memoization does not pay off.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "cells.hpp"
+
+namespace life {
+/**
+ * Hashlife shines on patterns with a lot of repetition, in space or in time,
+ * but chaotic patterns such as random soups hardly repeat at all, and pay for
+ * the memoization without benefiting from it. The tile engine instead steps
+ * every 8x8 tile directly, one generation at a time, with the bit-parallel
+ * kernel of cells::step().
+ *
+ * Only tiles that contain living cells, or that have just died out, are
+ * stored. A tile is only recomputed if any tile of its 3x3 neighbourhood
+ * changed during the last generation, since otherwise its inputs, and
+ * therefore its next state, are the same as before. Stable regions therefore
+ * cost nothing, as in QuickLife.
+ *
+ * Tiles are addressed by cell coordinates that are multiples of 8, which must
+ * fit in 35 bits.
+ */
+class tile_engine {
+public:
+  auto get(std::int64_t x, std::int64_t y) const -> bool;
+  void set(std::int64_t x, std::int64_t y, bool alive = true);
+  auto block(std::int64_t x, std::int64_t y) const -> cells;
+  void set_block(std::int64_t x, std::int64_t y, cells block);
+  void clear() noexcept;
+
+  void step();
+  void advance(std::uint64_t generations);
+
+  auto generation() const noexcept { return _generation; }
+  void set_generation(std::uint64_t generation) noexcept {
+    _generation = generation;
+  }
+  auto population() const -> std::uint64_t;
+  auto size() const noexcept { return _tiles.size(); }
+  auto active() const noexcept { return _active; }
+
+  template <typename Function> void for_each_block(Function &&function) const;
+
+private:
+  struct tile {
+    cells state;
+    bool changed = true; // During the last generation
+  };
+
+  static auto key(std::int64_t column, std::int64_t row) noexcept
+      -> std::uint64_t;
+  static auto column(std::uint64_t key) noexcept -> std::int64_t;
+  static auto row(std::uint64_t key) noexcept -> std::int64_t;
+  auto state(std::int64_t column, std::int64_t row) const -> cells;
+  auto next(std::int64_t column, std::int64_t row) const -> cells;
+
+  std::unordered_map<std::uint64_t, tile> _tiles; // By tile column and row
+  std::size_t _active = 0; // Number of tiles changed in the last generation
+  std::uint64_t _generation = 0;
+};
+
+/**
+ * Calls <function> with the coordinates of the top-left cell and the contents
+ * of every non-empty tile, in no particular order.
+ */
+template <typename Function>
+void tile_engine::for_each_block(Function &&function) const {
+  for (const auto &[key, tile] : _tiles)
+    if (!tile.state.empty())
+      function(column(key) * cells::columns, row(key) * cells::rows,
+               tile.state);
+}
+} // namespace life
@@ -0,0 +1,73 @@
+/**
+ * Hashlife
+ * Pluggable channels over which processes exchange messages.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace life {
+/**
+ * A transport carries messages, each a sequence of 64-bit words, between two
+ * processes, in order and without loss. Messages are delivered whole: a
+ * receiver never sees part of one. Transports are pluggable, so that shards
+ * may be connected by whatever the hosts they run on have to offer.
+ */
+class transport {
+public:
+  virtual ~transport() = default;
+
+  virtual void send(const std::vector<std::uint64_t> &message) = 0;
+  virtual auto receive(std::vector<std::uint64_t> &message) -> bool = 0;
+};
+
+/**
+ * Transport over a connected Unix stream socket. Every message is preceded
+ * by its length in words. Words are sent in the byte order of the host, so
+ * both ends must share it, as they do on one host.
+ */
+class socket_transport : public transport {
+public:
+  explicit socket_transport(int socket) noexcept : _socket{socket} {}
+  socket_transport(const socket_transport &) = delete;
+  auto operator=(const socket_transport &) -> socket_transport & = delete;
+  ~socket_transport() override;
+
+  void send(const std::vector<std::uint64_t> &message) override;
+  auto receive(std::vector<std::uint64_t> &message) -> bool override;
+
+  static auto pair() -> std::pair<std::unique_ptr<socket_transport>,
+                                  std::unique_ptr<socket_transport>>;
+  static auto connect(const std::string &path)
+      -> std::unique_ptr<socket_transport>;
+  static auto accept(const std::string &path)
+      -> std::unique_ptr<socket_transport>;
+
+private:
+  void write(const void *data, std::size_t size);
+  auto read(void *data, std::size_t size) -> bool;
+
+  int _socket;
+};
+} // namespace life
@@ -0,0 +1,351 @@
+/**
+ * Hashlife
+ * A life universe of unbounded size, stored as a quadtree of hash-consed
+ * macrocells, with one table of nodes per level of the tree.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cells.hpp"
+#include "checkpoint_log.hpp"
+#include "digest.hpp"
+#include "hashlife_engine.hpp"
+#include "layer.hpp"
+#include "macrocell.hpp"
+#include "node_records.hpp"
+#include "pinned_root.hpp"
+#include "result_cache.hpp"
+#include "rule_table.hpp"
+#include "shard.hpp"
+#include "spill_file.hpp"
+#include "static_vector.hpp"
+#include "transport.hpp"
+
+namespace life {
+class shard_server;
+class snapshot;
+class thread_pool;
+class universe_pool;
+
+/**
+ * Progress of an asynchronous advance, shared between the caller and the
+ * thread doing the work. Cancellation is cooperative: it is noticed the next
+ * time a node is evaluated.
+ */
+class advance_progress {
+public:
+  void cancel() noexcept { _cancelled = true; }
+  auto cancelled() const noexcept -> bool { return _cancelled; }
+  auto evaluated() const noexcept -> std::uint64_t { return _evaluated; }
+  auto generation() const noexcept -> std::uint64_t { return _generation; }
+
+private:
+  friend class universe;
+
+  std::atomic<bool> _cancelled{false};
+  std::atomic<std::uint64_t> _evaluated{0};  // Nodes computed so far
+  std::atomic<std::uint64_t> _generation{0}; // Reached by completed jumps
+};
+
+/**
+ * Rectangle of cells, with its top-left cell given in the coordinates of a
+ * universe.
+ */
+struct rectangle {
+  std::int64_t left = 0, top = 0;
+  std::int64_t width = 0, height = 0;
+};
+
+/**
+ * Block of cells, with its top-left cell given in the coordinates of a
+ * universe.
+ */
+struct placed_block {
+  std::int64_t x = 0, y = 0;
+  cells contents;
+};
+
+/**
+ * The universe is a quadtree whose leaves (level 0) are 8x8 cell squares; a
+ * macrocell of level n covers a square of 2^{n+3} cells on a side.
+ * Cells are addressed with coordinates relative to the center of the root,
+ * positive down and to the right. The recursion itself is that of
+ * hashlife_tree; the universe adds how nodes are managed, and where they and
+ * their results may be kept besides their layers.
+ *
+ * Each level owns its own layer, sized and grown independently, so that the
+ * millions of nodes at the lowest levels do not affect the probe lengths of
+ * the few nodes at the top. Layers grow only in between computations: if a
+ * layer overflows during one, it is grown and the computation is retried,
+ * which is cheap since all results computed so far remain memoized.
+ *
+ * By default nodes are never freed. Alternatively, nodes may be reference
+ * counted, where a node is referenced by its parents (both as child and as
+ * memoized future) and by the root. Unreferenced nodes are reclaimed in
+ * batches of bounded size in between computations, so that memory can be
+ * recovered incrementally instead of by a single stop-the-world collection.
+ *
+ * Finally, nodes may be managed generationally: most nodes created by a
+ * computation are intermediate results that are garbage right away, so new
+ * nodes go into a nursery first. After each computation, only the nodes still
+ * reachable from the root, or from a memoized future, are promoted into the
+ * tenured tables, and the nurseries are reset as a whole.
+ *
+ * Unmanaged universes may additionally spill cold nodes to disk, so that runs
+ * larger than memory slow down rather than fail. Subtrees that have not been
+ * accessed for a number of computations are written to a spill file and
+ * removed from their layers, with their parents pointing to their records
+ * instead. Spilled nodes are read back whenever they are needed again, while
+ * the results computed for them are kept in memory, so that a subtree that
+ * becomes active again is not recomputed each time it is reached.
+ *
+ * Universes that are not generational may also be journaled to a checkpoint
+ * log, to which each checkpoint appends only the nodes and memoized results
+ * that are new since the previous one. A universe can be restored from the
+ * snapshot that replaying such a log results in.
+ *
+ * Such universes may also share their results across runs, through a result
+ * cache keyed by the digests of nodes. Results of sufficiently high levels are
+ * looked up in the cache before being computed, and added to it afterwards.
+ *
+ * Several processes may also share their nodes directly, by creating their
+ * universes on the same shared store: one shared set per level, of a fixed
+ * capacity. Nodes and their next() results are then computed once for all
+ * processes, while each process keeps its own root and step() results, as
+ * those depend on how far that process is jumping.
+ *
+ * Universes may also follow another rule than life, given as a rule table,
+ * such as an isotropic non-totalistic rule. Only the leaves depend on the
+ * rule, so everything above them works the same.
+ *
+ * The root may also be pinned for readers on other threads, which then
+ * traverse it while the universe keeps advancing. Pinned roots count as roots
+ * until their readers let go, and layers retire the tables they rebuild
+ * instead of freeing them, for as long as any reader might still see them.
+ *
+ * Finally, a universe may span several processes, each owning the nodes whose
+ * digests fall in its range. Nodes of sufficiently high levels that another
+ * process owns are handed to it to be advanced, in batches of the subnodes
+ * that one computation needs, and the results it sends back are kept.
+ */
+class universe : public hashlife_tree<universe, cells> {
+public:
+  explicit universe(lifetime mode = lifetime::unmanaged);
+  explicit universe(const rule_table &rule,
+                    lifetime mode = lifetime::unmanaged);
+  explicit universe(const life::snapshot &base,
+                    lifetime mode = lifetime::unmanaged);
+  universe(std::string shared_name, std::size_t capacity);
+
+  auto get(std::int64_t x, std::int64_t y) const -> bool;
+  void set(std::int64_t x, std::int64_t y, bool alive = true);
+  auto block(std::int64_t x, std::int64_t y) const -> cells;
+  void set_block(std::int64_t x, std::int64_t y, cells block);
+  void set_blocks(std::vector<placed_block> blocks);
+  void read_macrocell(std::string_view text);
+  void build_from_bitmap(const std::uint8_t *bitmap, std::size_t width,
+                         std::size_t height, std::size_t stride,
+                         std::size_t threads = 1);
+  void build_from_bitmap(const std::uint8_t *bitmap, std::size_t width,
+                         std::size_t height, std::size_t stride,
+                         thread_pool &pool);
+  void clear();
+  void advance(std::uint64_t generations);
+  auto advance_async(std::uint64_t generations,
+                     std::shared_ptr<advance_progress> progress = nullptr)
+      -> std::future<std::uint64_t>;
+  auto advance_for(std::uint64_t generations, std::chrono::microseconds budget)
+      -> std::uint64_t;
+  auto query_region(const rectangle &window, std::uint64_t generation)
+      -> std::vector<bool>;
+  auto reclaim(std::size_t budget = std::numeric_limits<std::size_t>::max())
+      -> std::size_t;
+  void spill_to(std::string path, std::uint32_t age = 2);
+  auto spill(std::uint32_t age) -> std::size_t;
+  void journal_to(std::string path);
+  auto checkpoint() -> std::size_t;
+  void cache_results_to(std::string path, std::size_t minimum_level = 4);
+  void distribute(std::vector<std::unique_ptr<transport>> shards,
+                  std::size_t minimum_level = 4,
+                  std::size_t capacity = std::size_t{1} << 20);
+
+  auto rule() const -> rule_table {
+    return _rule ? *_rule : rule_table::conway();
+  }
+  auto population() const -> std::uint64_t;
+  auto snapshot() const -> life::snapshot;
+  auto pin() -> pinned_root;
+
+  static void remove_shared(const std::string &shared_name) noexcept;
+
+private:
+  friend class hashlife_tree<universe, cells>;
+  friend class shard_server;
+  friend class universe_pool;
+
+  /**
+   * Root of a universe of a pool that is not being worked on. Parked roots
+   * are roots all the same: they keep their nodes alive, and move with them.
+   */
+  struct parked_root {
+    pointer root;
+    std::size_t level;
+    std::uint64_t generation;
+  };
+
+  /**
+   * Root pinned by a reader, kept alive until the reader unpins its ticket.
+   */
+  struct pin_entry {
+    std::uint64_t ticket;
+    pointer root;
+    std::size_t level;
+  };
+
+  /**
+   * Results memoized by a spilled node that its record cannot hold: records
+   * are immutable, and only refer to other records.
+   */
+  struct spilled_futures {
+    pointer step;
+    pointer next;
+  };
+
+  void opened(std::size_t level, layer<macrocell> &layer);
+  auto fetch(std::size_t level, pointer node) -> macrocell;
+  auto fetch(std::size_t level, pointer node) const -> macrocell;
+  auto fetch(pointer leaf) -> cells;
+  auto fetch(pointer leaf) const -> cells;
+  void swap_root(std::size_t parked) noexcept;
+  void reset_root();
+  void unpin_released();
+  template <typename Function> void for_each_root(Function &&function);
+  void relocated(std::size_t level, const static_vector<pointer> &remap);
+  auto aside(std::size_t level, pointer node) -> spilled_futures &;
+
+  auto get(std::size_t level, pointer node, std::uint64_t x,
+           std::uint64_t y) const -> bool;
+  auto set(std::size_t level, pointer node, std::uint64_t x, std::uint64_t y,
+           bool alive) -> pointer;
+  auto set_block(std::size_t level, pointer node, std::uint64_t x,
+                 std::uint64_t y, cells block) -> pointer;
+  template <typename Run>
+  void build_from_bitmap(const std::uint8_t *bitmap, std::size_t width,
+                         std::size_t height, std::size_t stride,
+                         std::size_t workers, Run &&run);
+  auto set_blocks(std::size_t level, pointer node, std::int64_t x,
+                  std::int64_t y,
+                  std::vector<placed_block>::const_iterator first,
+                  std::vector<placed_block>::const_iterator last) -> pointer;
+  auto population(std::size_t level, pointer node,
+                  std::vector<static_vector<std::uint64_t>> &cache,
+                  std::unordered_map<std::size_t, std::uint64_t> &spilled) const
+      -> std::uint64_t;
+  auto number(std::size_t level, pointer node,
+              std::vector<static_vector<pointer>> &order,
+              std::unordered_map<std::size_t, pointer> &spilled,
+              std::vector<std::vector<pointer>> &origin) const -> pointer;
+
+  auto base_level() const noexcept -> std::size_t { return 1; }
+  auto base_reach() const noexcept -> std::uint64_t { return 4; }
+  auto range() const noexcept -> std::uint64_t { return 1; }
+  auto advance_base(pointer node, std::uint64_t generations) -> pointer;
+  auto step_leaf(cells square) const noexcept -> cells;
+  auto next_leaf(cells square) const noexcept -> cells;
+  void evaluate();
+  using hashlife_tree::next;
+  auto next(std::size_t level, life::digest node, const node_records &records)
+      -> pointer;
+  auto step_within(std::size_t level, pointer node, std::int64_t x,
+                   std::int64_t y, std::size_t exponent,
+                   const rectangle &window) -> pointer;
+
+  void remember(std::size_t level, pointer node, pointer result);
+  void mark(std::size_t level, pointer node,
+            std::vector<std::vector<pointer>> &survivors,
+            std::vector<std::vector<bool>> &marked) const;
+  void collect(bool interrupted = false);
+  void interrupted();
+
+  auto logged(std::size_t level, pointer node) -> std::uint32_t;
+
+  void hash_contents();
+  auto digest(std::size_t level, pointer node) -> life::digest;
+  void store(std::size_t level, pointer node);
+  auto rebuild(std::size_t level, life::digest node,
+               const node_records &records,
+               std::unordered_map<life::digest, pointer> &built) -> pointer;
+  auto recall(std::size_t level, pointer node, std::size_t exponent)
+      -> pointer;
+  void record(std::size_t level, pointer node, std::size_t exponent,
+              pointer result);
+  void encode(std::size_t level, pointer node,
+              std::unordered_set<life::digest> &known, shard_message &message);
+  void dispatch(std::size_t level, std::initializer_list<pointer> nodes);
+  auto memoized_next(std::size_t level, pointer node) -> pointer;
+  auto memoize_next(std::size_t level, pointer node, pointer result)
+      -> pointer;
+  auto memoize_step(std::size_t level, pointer node, pointer result)
+      -> pointer;
+  auto memoized_step(std::size_t level, pointer node) -> pointer;
+  void forget_steps();
+
+  template <typename Function> void guarded(Function &&function);
+  void completed();
+  auto recover(std::size_t attempt) -> bool;
+  void tick() noexcept;
+
+  std::optional<rule_table> _rule; // Life if empty
+  std::vector<std::pair<std::size_t, pointer>> _remembered; // Level, node
+  std::vector<parked_root> _parked;
+  std::shared_ptr<epochs> _readers = std::make_shared<epochs>();
+  std::vector<pin_entry> _pins;
+  std::unique_ptr<spill_file> _spill;
+  std::uint32_t _spill_age = 0;
+  std::vector<std::unordered_map<pointer, spilled_futures>> _aside; // By level
+  std::unique_ptr<checkpoint_log> _journal;
+  std::unique_ptr<result_cache> _results;
+  std::size_t _cached_level = 0; // Lowest level whose results are cached
+  std::unique_ptr<shard_client> _shards;
+  std::size_t _distributed_level = 0; // Lowest level handed to other shards
+  bool _hashed = false;               // Whether digests of nodes are kept
+  std::string _shared;             // Name of the shared store, if any
+  std::size_t _shared_capacity = 0;
+  std::vector<static_vector<pointer>> _steps; // Own step() results if shared
+  std::shared_ptr<advance_progress> _progress; // Of the advance in progress
+  std::chrono::steady_clock::time_point _deadline =
+      std::chrono::steady_clock::time_point::max(); // Of advance_for(), if any
+  std::uint32_t _polls = 0; // Evaluations since the clock was last read
+};
+} // namespace life
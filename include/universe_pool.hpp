@@ -0,0 +1,108 @@
+/**
+ * Hashlife
+ * Many universes sharing a single store of nodes and memoized results.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "layer.hpp"
+#include "universe.hpp"
+
+namespace life {
+class snapshot;
+
+/**
+ * Batches of small universes, such as soups or component tests, mostly
+ * consist of the same few subpatterns. A pool runs all of them on the layers
+ * of one universe, so that each unique node is stored, and each result is
+ * computed, only once for the whole batch.
+ *
+ * Every universe of the pool is represented by a handle, which owns a root.
+ * While a handle is being worked on, its root is swapped in as the root of
+ * the underlying universe; all other roots stay parked, but are treated as
+ * roots all the same by reference counting, collection, spilling and growth.
+ * Destroying a handle releases its root, after which the nodes that only it
+ * used can be freed. Handles must not outlive their pool.
+ */
+class universe_pool {
+public:
+  class handle {
+  public:
+    handle(handle &&other) noexcept;
+    auto operator=(handle &&other) noexcept -> handle &;
+    ~handle();
+
+    auto get(std::int64_t x, std::int64_t y) const -> bool;
+    void set(std::int64_t x, std::int64_t y, bool alive = true);
+    void advance(std::uint64_t generations);
+
+    auto generation() const -> std::uint64_t;
+    auto level() const -> std::size_t;
+    auto population() const -> std::uint64_t;
+    auto snapshot() const -> life::snapshot;
+
+  private:
+    friend class universe_pool;
+    handle(universe_pool &pool, std::size_t slot) noexcept
+        : _pool{&pool}, _slot{slot} {}
+
+    universe_pool *_pool;
+    std::size_t _slot;
+  };
+
+  explicit universe_pool(lifetime mode = lifetime::unmanaged);
+
+  auto create() -> handle;
+  auto size() const noexcept { return _store._parked.size() - _free.size(); }
+  auto reclaim(std::size_t budget = std::numeric_limits<std::size_t>::max())
+      -> std::size_t;
+  auto statistics() const -> std::vector<layer_statistics>;
+
+private:
+  template <typename Function>
+  auto with(std::size_t slot, Function &&function) -> decltype(auto);
+  void release(std::size_t slot);
+
+  universe _store;
+  std::vector<std::size_t> _free; // Parked roots that are not in use
+};
+
+/**
+ * Calls <function> with the underlying universe, while the root of <slot> is
+ * swapped in. The root is parked again afterwards, even if <function> throws.
+ */
+template <typename Function>
+auto universe_pool::with(std::size_t slot, Function &&function)
+    -> decltype(auto) {
+  struct activation {
+    activation(universe &store, std::size_t slot) noexcept
+        : store{store}, slot{slot} {
+      store.swap_root(slot);
+    }
+    ~activation() { store.swap_root(slot); }
+
+    universe &store;
+    std::size_t slot;
+  } active{_store, slot};
+  return function(_store);
+}
+} // namespace life
@@ -0,0 +1,262 @@
+/**
+ * Hashlife
+ * Dense grid of cells of a fixed size, either wrapping around or surrounded
+ * by dead cells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bitboard.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bitwise.hpp"
+#include "cells.hpp"
+#include "thread_pool.hpp"
+#include "universe.hpp"
+
+using namespace life;
+
+namespace {
+constexpr auto word_bits = std::size_t{64};
+} // namespace
+
+bitboard::bitboard(std::size_t width, std::size_t height, boundary edges)
+    : _width{width}, _height{height}, _words{width / word_bits},
+      _edges{edges} {
+  if (width == 0 || width % word_bits != 0)
+    throw std::domain_error{"bitboard: width must be a multiple of 64"};
+  if (height == 0 || height % cells::rows != 0)
+    throw std::domain_error{"bitboard: height must be a multiple of 8"};
+  _cells = static_vector<std::uint64_t>{_words * _height, 0u};
+  _next = static_vector<std::uint64_t>{_words * _height, 0u};
+}
+
+/**
+ * Copies a region of a universe, whose top-left corner must be aligned to the
+ * leaves of the universe, onto a new board.
+ */
+auto bitboard::from(const universe &source, std::int64_t left,
+                    std::int64_t top, std::size_t width, std::size_t height,
+                    boundary edges) -> bitboard {
+  if (left % cells::columns != 0 || top % cells::rows != 0)
+    throw std::domain_error{"bitboard: regions must be aligned to leaves"};
+  auto board = bitboard{width, height, edges};
+  for (auto y = std::size_t{0}; y < height; y += cells::rows) {
+    for (auto x = std::size_t{0}; x < width; x += cells::columns) {
+      const auto leaf = source.block(left + static_cast<std::int64_t>(x),
+                                     top + static_cast<std::int64_t>(y));
+      for (auto r = 0; r < cells::rows; ++r)
+        board.row(y + r)[x / word_bits] |=
+            ((leaf.bits() >> (cells::columns * r)) & 0xffu)
+            << (x % word_bits);
+    }
+  }
+  board._generation = source.generation();
+  return board;
+}
+
+/**
+ * Copies the board onto a region of a universe, whose top-left corner must be
+ * aligned to the leaves of the universe. Cells already in that region are
+ * overwritten; cells outside of it are left alone.
+ */
+void bitboard::write_to(universe &target, std::int64_t left,
+                        std::int64_t top) const {
+  if (left % cells::columns != 0 || top % cells::rows != 0)
+    throw std::domain_error{"bitboard: regions must be aligned to leaves"};
+  for (auto y = std::size_t{0}; y < _height; y += cells::rows) {
+    for (auto x = std::size_t{0}; x < _width; x += cells::columns) {
+      auto bits = std::uint64_t{0};
+      for (auto r = 0; r < cells::rows; ++r)
+        bits |= ((row(y + r)[x / word_bits] >> (x % word_bits)) & 0xffu)
+                << (cells::columns * r);
+      const auto bx = left + static_cast<std::int64_t>(x);
+      const auto by = top + static_cast<std::int64_t>(y);
+      if (bits != 0 || !target.block(bx, by).empty())
+        target.set_block(bx, by, cells{bits});
+    }
+  }
+}
+
+auto bitboard::get(std::size_t x, std::size_t y) const -> bool {
+  if (x >= _width || y >= _height)
+    throw std::out_of_range{"bitboard: cell lies outside of the board"};
+  return bit(row(y)[x / word_bits], x % word_bits);
+}
+
+void bitboard::set(std::size_t x, std::size_t y, bool alive) {
+  if (x >= _width || y >= _height)
+    throw std::out_of_range{"bitboard: cell lies outside of the board"};
+  const auto mask = std::uint64_t{1} << (x % word_bits);
+  auto &word = row(y)[x / word_bits];
+  word = alive ? word | mask : word & ~mask;
+}
+
+auto bitboard::population() const noexcept -> std::uint64_t {
+  auto count = std::uint64_t{0};
+  for (auto word : _cells)
+    count += std::bitset<word_bits>(word).count();
+  return count;
+}
+
+/**
+ * Sums each cell of a row with its left and right neighbours, as the first
+ * stage of the adder network of cells::neighbours(). Neighbours across word
+ * boundaries are shifted in from the adjacent words; the first and last words
+ * are handled separately, so that the loop over the others has no branches.
+ */
+void bitboard::add_row(const std::uint64_t *cells, std::uint64_t *sum1,
+                       std::uint64_t *sum2) const noexcept {
+  const auto last = _words - 1;
+  const auto wraps = _edges == boundary::torus;
+  auto add = [&](std::size_t i, std::uint64_t west, std::uint64_t east) {
+    const auto left = (cells[i] << 1) | (west >> (word_bits - 1));
+    const auto right = (cells[i] >> 1) | (east << (word_bits - 1));
+    std::tie(sum1[i], sum2[i]) = full_add(left, cells[i], right);
+  };
+
+  if (_words == 1) {
+    add(0, wraps ? cells[0] : 0, wraps ? cells[0] : 0);
+    return;
+  }
+  add(0, wraps ? cells[last] : 0, cells[1]);
+  for (auto i = std::size_t{1}; i < last; ++i)
+    add(i, cells[i - 1], cells[i + 1]);
+  add(last, cells[last - 1], wraps ? cells[0] : 0);
+}
+
+/**
+ * Computes the next generation of rows [begin, end) into the back buffer.
+ * The horizontal sums of three consecutive rows are kept around, so that each
+ * row is summed only once per band.
+ */
+void bitboard::step_rows(std::size_t begin, std::size_t end) {
+  auto sums = std::vector<std::uint64_t>(6 * _words);
+  std::uint64_t *up[2] = {sums.data(), sums.data() + _words};
+  std::uint64_t *mid[2] = {sums.data() + 2 * _words, sums.data() + 3 * _words};
+  std::uint64_t *down[2] = {sums.data() + 4 * _words,
+                            sums.data() + 5 * _words};
+
+  auto sum_row = [&](std::size_t y, bool outside, std::uint64_t **target) {
+    if (outside && _edges == boundary::dead)
+      std::fill(target[0], target[0] + _words, 0),
+          std::fill(target[1], target[1] + _words, 0);
+    else
+      add_row(row(y), target[0], target[1]);
+  };
+
+  sum_row(begin == 0 ? _height - 1 : begin - 1, begin == 0, up);
+  sum_row(begin, false, mid);
+  for (auto y = begin; y < end; ++y) {
+    sum_row(y + 1 == _height ? 0 : y + 1, y + 1 == _height, down);
+
+    const auto *cells = row(y);
+    auto *next = _next.data() + y * _words;
+    for (auto i = std::size_t{0}; i < _words; ++i) {
+      const auto [sum1, sum2a] = full_add(up[0][i], mid[0][i], down[0][i]);
+      const auto [sum2b, sum4a] = full_add(up[1][i], mid[1][i], down[1][i]);
+      const auto [sum2, sum4b] = half_add(sum2a, sum2b);
+      const auto sum4 = sum4a ^ sum4b;
+      next[i] = (cells[i] & ~sum1 & ~sum2 & sum4) | (sum1 & sum2 & ~sum4);
+    }
+
+    std::swap(up, mid);
+    std::swap(mid, down);
+  }
+}
+
+/**
+ * Returns the rows [begin, end) computed by the given worker out of
+ * <workers>, in bands of roughly equal height.
+ */
+auto bitboard::band(std::size_t worker, std::size_t workers) const noexcept
+    -> std::pair<std::size_t, std::size_t> {
+  const auto height = (_height + workers - 1) / workers;
+  const auto begin = std::min(worker * height, _height);
+  return {begin, std::min(begin + height, _height)};
+}
+
+/**
+ * Advances the board by a single generation. The rows are divided into
+ * <threads> bands of roughly equal height, which are computed concurrently.
+ */
+void bitboard::step(std::size_t threads) {
+  threads = std::clamp<std::size_t>(threads, 1, _height);
+  if (threads == 1) {
+    step_rows(0, _height);
+    std::swap(_cells, _next);
+    ++_generation;
+  } else {
+    auto pool = thread_pool{threads};
+    step(pool);
+  }
+}
+
+/**
+ * As above, with worker i of the pool always computing band i.
+ */
+void bitboard::step(thread_pool &pool) {
+  pool.run([&](std::size_t worker) {
+    const auto [begin, end] = band(worker, pool.size());
+    if (begin != end)
+      step_rows(begin, end);
+  });
+  std::swap(_cells, _next);
+  ++_generation;
+}
+
+/**
+ * Advances the board by the given number of generations, starting the
+ * threads once rather than for every generation.
+ */
+void bitboard::advance(std::uint64_t generations, std::size_t threads) {
+  threads = std::clamp<std::size_t>(threads, 1, _height);
+  if (threads == 1) {
+    for (; generations != 0; --generations)
+      step(1);
+    return;
+  }
+  auto pool = thread_pool{threads};
+  advance(generations, pool);
+}
+
+void bitboard::advance(std::uint64_t generations, thread_pool &pool) {
+  for (; generations != 0; --generations)
+    step(pool);
+}
+
+/**
+ * Moves the board to memory that each worker of the pool touches first for
+ * its own band, so that on hosts with several NUMA nodes, the rows of a band
+ * are placed on the node of the worker that computes them. This only pays
+ * off for pools whose workers are pinned, and only lasts as long as the same
+ * pool, or one pinned alike, is used for stepping.
+ */
+void bitboard::place(thread_pool &pool) {
+  auto cells = static_vector<std::uint64_t>{_words * _height};
+  auto next = static_vector<std::uint64_t>{_words * _height};
+  pool.run([&](std::size_t worker) {
+    const auto [begin, end] = band(worker, pool.size());
+    std::copy(row(begin), row(end), cells.data() + begin * _words);
+    std::fill(next.data() + begin * _words, next.data() + end * _words, 0u);
+  });
+  _cells = std::move(cells);
+  _next = std::move(next);
+}
@@ -62,11 +62,18 @@ auto cells::operator!=(const cells &other) const noexcept -> bool {
 }
 
 /**
- * Uses std::hash instead of identity to allow for non-64-bit systems.
- * It is likely that this results in identity on 64-bit systems anyway.
+ * The bitmap is mixed with the MurmurHash3 finalizer before hashing, since
+ * std::hash is likely to be the identity: squares that only differ in their
+ * bottom rows would then all be assigned the same bucket.
  */
 auto cells::hash() const noexcept -> std::size_t {
-  return std::hash<std::uint64_t>()(bitmap);
+  auto mixed = bitmap;
+  mixed ^= mixed >> 33;
+  mixed *= 0xff51afd7ed558ccdull;
+  mixed ^= mixed >> 33;
+  mixed *= 0xc4ceb9fe1a85ec53ull;
+  mixed ^= mixed >> 33;
+  return std::hash<std::uint64_t>()(mixed);
 }
 
 /**
@@ -115,6 +122,11 @@ auto cells::population_count() const noexcept -> std::size_t {
   return std::bitset<64>(bitmap).count();
 }
 
+/**
+ * Determines whether all cells in this square are dead.
+ */
+auto cells::empty() const noexcept -> bool { return bitmap == 0; }
+
 /**
  * Shifts the bitmap in the specified direction.
  * Cells just wrap-around to the next line upon leaving the frame, no logic is
@@ -161,10 +173,10 @@ auto cells::west() const noexcept -> cells {
  * each of the given cells is.
  */
 auto cells::center(cells nw, cells ne, cells sw, cells se) noexcept -> cells {
-  auto upper_left = nw.north().west().shift(columns / 2, rows / 2).bitmap;
-  auto upper_right = ne.north().east().shift(-columns / 2, rows / 2).bitmap;
-  auto lower_left = sw.south().west().shift(columns / 2, -rows / 2).bitmap;
-  auto lower_right = se.south().east().shift(-columns / 2, -rows / 2).bitmap;
+  auto upper_left = nw.south().east().shift(-columns / 2, -rows / 2).bitmap;
+  auto upper_right = ne.south().west().shift(columns / 2, -rows / 2).bitmap;
+  auto lower_left = sw.north().east().shift(-columns / 2, rows / 2).bitmap;
+  auto lower_right = se.north().west().shift(columns / 2, rows / 2).bitmap;
   return cells{upper_left | upper_right | lower_left | lower_right};
 }
 
@@ -172,8 +184,8 @@ auto cells::center(cells nw, cells ne, cells sw, cells se) noexcept -> cells {
  * Creates a new cell center horizontally between two cells, of the same size.
  */
 auto cells::horizontal(cells west, cells east) noexcept -> cells {
-  auto left = west.west().shift(columns / 2, 0).bitmap;
-  auto right = east.east().shift(-columns / 2, 0).bitmap;
+  auto left = west.east().shift(-columns / 2, 0).bitmap;
+  auto right = east.west().shift(columns / 2, 0).bitmap;
   return cells{left | right};
 }
 
@@ -181,11 +193,25 @@ auto cells::horizontal(cells west, cells east) noexcept -> cells {
  * Creates a new cell center vertically between two cells, of the same size.
  */
 auto cells::vertical(cells north, cells south) noexcept -> cells {
-  auto up = north.north().shift(0, rows / 2).bitmap;
-  auto down = south.south().shift(0, -rows / 2).bitmap;
+  auto up = north.south().shift(0, -rows / 2).bitmap;
+  auto down = south.north().shift(0, rows / 2).bitmap;
   return cells{up | down};
 }
 
+/**
+ * Creates a new cell square out of the center 4x4 cells of each of the given
+ * squares, placed in their respective quadrant. This is the inverse of the
+ * centering done by next(), allowing four results to be joined into one.
+ */
+auto cells::combine(cells nw, cells ne, cells sw, cells se) noexcept -> cells {
+  constexpr auto mask = 0x00003c3c3c3c0000ull;
+  auto upper_left = cells{nw.bitmap & mask}.shift(-2, -2).bitmap;
+  auto upper_right = cells{ne.bitmap & mask}.shift(2, -2).bitmap;
+  auto lower_left = cells{sw.bitmap & mask}.shift(-2, 2).bitmap;
+  auto lower_right = cells{se.bitmap & mask}.shift(2, 2).bitmap;
+  return cells{upper_left | upper_right | lower_left | lower_right};
+}
+
 /**
  * Computes the number of neighbours a cell has, returning it as a 3-bit
  * value, encoded in three bitmaps. Each location in a bitmap represents that
@@ -0,0 +1,254 @@
+/**
+ * Hashlife
+ * Append-only log of the nodes created in between checkpoints, from which
+ * the tree can be recovered.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "checkpoint_log.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "macrocell.hpp"
+#include "snapshot.hpp"
+
+using namespace life;
+
+namespace {
+constexpr auto magic = std::uint32_t{0x4b434c48}; // "HLCK"
+constexpr auto leaf_tag = 'L', node_tag = 'N', link_tag = 'F', root_tag = 'R';
+
+template <typename Word> auto read(std::istream &file, Word &word) -> bool {
+  return bool(file.read(reinterpret_cast<char *>(&word), sizeof(word)));
+}
+
+/**
+ * Tree read back from a log, in which nodes are numbered in order of writing.
+ */
+struct recovered {
+  std::vector<cells> leaves;
+  std::vector<std::vector<macrocell>> nodes; // Level n is stored at n - 1
+
+  auto size(std::size_t level) const {
+    return level == 0 ? leaves.size() : nodes[level - 1].size();
+  }
+};
+
+/**
+ * Numbers all nodes reachable from <node> in pre-order depth-first Z-order,
+ * as expected by a snapshot. Memoized results are numbered after the
+ * quadrants, so that they survive the compaction.
+ */
+void number(const recovered &tree, std::size_t level, std::uint32_t node,
+            std::vector<std::vector<pointer>> &order,
+            std::vector<std::vector<std::uint32_t>> &origin) {
+  if (order[level][node])
+    return;
+  order[level][node] = pointer{origin[level].size()};
+  origin[level].push_back(node);
+  if (level == 0)
+    return;
+  const auto &cell = tree.nodes[level - 1][node];
+  for (auto quadrant : cell.quadrants())
+    number(tree, level - 1, quadrant.index(), order, origin);
+  if (cell.next())
+    number(tree, level - 1, cell.next().index(), order, origin);
+}
+} // namespace
+
+/**
+ * Starts a new log at <path>, replacing any existing file.
+ */
+checkpoint_log::checkpoint_log(std::string path)
+    : _path{std::move(path)},
+      _file{_path, std::ios::out | std::ios::binary | std::ios::trunc} {
+  if (!_file)
+    throw std::runtime_error{"checkpoint_log: unable to open " + _path};
+  _file.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+}
+
+/**
+ * Writes a leaf, returning its number.
+ */
+auto checkpoint_log::append(cells leaf) -> std::uint32_t {
+  if (_written.empty())
+    _written.push_back(0);
+  write(leaf_tag, leaf.bits());
+  return _written[0]++;
+}
+
+/**
+ * Writes a macrocell of the given level, which must be at least 1, whose
+ * children have been written under the given numbers, returning its own
+ * number.
+ */
+auto checkpoint_log::append(std::size_t level,
+                            const std::array<std::uint32_t, 4> &children)
+    -> std::uint32_t {
+  if (level == 0)
+    throw std::domain_error{"checkpoint_log: leaves have no children"};
+  if (_written.size() <= level)
+    _written.resize(level + 1, 0);
+  for (auto child : children)
+    if (child >= _written[level - 1])
+      throw std::domain_error{"checkpoint_log: children must come first"};
+
+  write(node_tag, static_cast<std::uint32_t>(level), children[0], children[1],
+        children[2], children[3]);
+  return _written[level]++;
+}
+
+/**
+ * Writes the memoized next() result of a node.
+ */
+void checkpoint_log::link(std::size_t level, std::uint32_t node,
+                          std::uint32_t next) {
+  write(link_tag, static_cast<std::uint32_t>(level), node, next);
+}
+
+/**
+ * Completes a checkpoint by writing its root, and flushes the log.
+ */
+void checkpoint_log::commit(std::size_t level, std::uint32_t root,
+                            std::uint64_t generation) {
+  write(root_tag, static_cast<std::uint32_t>(level), root, generation);
+  _file.flush();
+  if (!_file)
+    throw std::runtime_error{"checkpoint_log: unable to write to " + _path};
+  ++_checkpoints;
+}
+
+/**
+ * Returns the number of nodes written so far, over all levels.
+ */
+auto checkpoint_log::size() const noexcept -> std::size_t {
+  auto total = std::size_t{0};
+  for (auto written : _written)
+    total += written;
+  return total;
+}
+
+template <typename... Words>
+void checkpoint_log::write(char tag, Words... words) {
+  _file.put(tag);
+  (_file.write(reinterpret_cast<const char *>(&words), sizeof(words)), ...);
+}
+
+/**
+ * Reads back the log at <path> up to its last complete checkpoint, and
+ * compacts the tree of that checkpoint into a snapshot. Links are only
+ * applied once the checkpoint containing them turns out to be complete.
+ * Reading stops at the first record that is cut short or refers to nodes
+ * that have not been read, as does any record after it.
+ */
+auto checkpoint_log::replay(const std::string &path) -> snapshot {
+  auto file = std::ifstream{path, std::ios::binary};
+  auto header = std::uint32_t{0};
+  if (!file || !read(file, header) || header != magic)
+    throw std::domain_error{"checkpoint_log: " + path + " is not a log"};
+
+  auto tree = recovered{};
+  auto committed = std::vector<std::size_t>{};
+  auto links = std::vector<std::tuple<std::uint32_t, std::uint32_t,
+                                      std::uint32_t>>{};
+  auto root = std::tuple<std::uint32_t, std::uint32_t, std::uint64_t>{};
+  auto complete = false;
+
+  auto valid = [&](std::size_t level, std::uint32_t node) {
+    return level <= tree.nodes.size() && node < tree.size(level);
+  };
+
+  for (auto tag = char{}; file.get(tag);) {
+    if (tag == leaf_tag) {
+      auto bits = std::uint64_t{};
+      if (!read(file, bits))
+        break;
+      tree.leaves.emplace_back(bits);
+    } else if (tag == node_tag) {
+      auto level = std::uint32_t{};
+      auto children = std::array<std::uint32_t, 4>{};
+      if (!read(file, level) || !read(file, children) || level == 0 ||
+          level > tree.nodes.size() + 1)
+        break;
+      auto child = [&](auto number) { return valid(level - 1, number); };
+      if (!std::all_of(children.begin(), children.end(), child))
+        break;
+      if (tree.nodes.size() < level)
+        tree.nodes.emplace_back();
+      tree.nodes[level - 1].emplace_back(
+          pointer{std::size_t{children[0]}}, pointer{std::size_t{children[1]}},
+          pointer{std::size_t{children[2]}}, pointer{std::size_t{children[3]}});
+    } else if (tag == link_tag) {
+      auto level = std::uint32_t{}, node = std::uint32_t{},
+           next = std::uint32_t{};
+      if (!read(file, level) || !read(file, node) || !read(file, next))
+        break;
+      links.emplace_back(level, node, next);
+    } else if (tag == root_tag) {
+      auto level = std::uint32_t{}, node = std::uint32_t{};
+      auto generation = std::uint64_t{};
+      if (!read(file, level) || !read(file, node) || !read(file, generation) ||
+          level == 0 || !valid(level, node))
+        break;
+      for (auto [above, node, next] : links)
+        if (above > 0 && valid(above, node) && valid(above - 1, next))
+          tree.nodes[above - 1][node].memoize_next(pointer{std::size_t{next}});
+      links.clear();
+      root = {level, node, generation};
+      committed = {tree.leaves.size()};
+      for (const auto &level : tree.nodes)
+        committed.push_back(level.size());
+      complete = true;
+    } else {
+      break;
+    }
+  }
+
+  if (!complete)
+    throw std::domain_error{"checkpoint_log: " + path +
+                            " holds no complete checkpoint"};
+  tree.leaves.resize(committed[0]);
+  tree.nodes.resize(committed.size() - 1);
+  for (auto level = 1u; level < committed.size(); ++level)
+    tree.nodes[level - 1].resize(committed[level]);
+
+  auto [level, node, generation] = root;
+  auto order = std::vector<std::vector<pointer>>{};
+  auto origin = std::vector<std::vector<std::uint32_t>>(level + 1);
+  for (auto below = 0u; below <= level; ++below)
+    order.emplace_back(tree.size(below), pointer{nullptr});
+  number(tree, level, node, order, origin);
+
+  auto leaves = std::vector<cells>{};
+  leaves.reserve(origin[0].size());
+  for (auto leaf : origin[0])
+    leaves.push_back(tree.leaves[leaf]);
+  auto levels = std::vector<std::vector<macrocell>>{};
+  for (auto above = 1u; above <= level; ++above) {
+    auto &compacted = levels.emplace_back();
+    compacted.reserve(origin[above].size());
+    for (auto index : origin[above]) {
+      const auto &below = order[above - 1];
+      compacted.push_back(tree.nodes[above - 1][index]);
+      compacted.back().translate(
+          [&below](pointer child) { return below[child.index()]; });
+    }
+  }
+  return snapshot{std::move(leaves), std::move(levels), generation};
+}
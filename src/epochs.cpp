@@ -0,0 +1,89 @@
+/**
+ * Hashlife
+ * Epoch-based reclamation of memory that concurrent readers may still see.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "epochs.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace life;
+
+/**
+ * Registers a reader of the current epoch, returning the ticket with which
+ * it unpins later on.
+ */
+auto epochs::pin() -> std::uint64_t {
+  auto lock = std::lock_guard{_mutex};
+  _readers.emplace(_tickets, _epoch);
+  return _tickets++;
+}
+
+/**
+ * Unregisters a reader, freeing whatever it was the last one to hold on to.
+ */
+void epochs::unpin(std::uint64_t ticket) {
+  auto lock = std::lock_guard{_mutex};
+  _readers.erase(ticket);
+  reclaim();
+}
+
+auto epochs::pinned(std::uint64_t ticket) const -> bool {
+  auto lock = std::lock_guard{_mutex};
+  return _readers.count(ticket) != 0;
+}
+
+auto epochs::readers() const -> std::size_t {
+  auto lock = std::lock_guard{_mutex};
+  return _readers.size();
+}
+
+/**
+ * Hands memory that the writer no longer uses over to the readers that may
+ * still use it, and starts a new epoch. Freed right away if there are none.
+ */
+void epochs::retire(std::shared_ptr<void> garbage) {
+  auto lock = std::lock_guard{_mutex};
+  _retired.emplace_back(_epoch++, std::move(garbage));
+  reclaim();
+}
+
+auto epochs::retired() const -> std::size_t {
+  auto lock = std::lock_guard{_mutex};
+  return _retired.size();
+}
+
+auto epochs::epoch() const -> std::uint64_t {
+  auto lock = std::lock_guard{_mutex};
+  return _epoch;
+}
+
+/**
+ * Frees all memory retired before the oldest epoch still pinned. Expects the
+ * lock to be held.
+ */
+void epochs::reclaim() {
+  auto oldest = std::numeric_limits<std::uint64_t>::max();
+  for (auto [ticket, epoch] : _readers)
+    oldest = std::min(oldest, epoch);
+  _retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+                                [oldest](const auto &garbage) {
+                                  return garbage.first < oldest;
+                                }),
+                 _retired.end());
+}
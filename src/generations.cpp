@@ -0,0 +1,260 @@
+/**
+ * Hashlife
+ * Multi-state cell squares, following the rules of the Generations family.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "generations.hpp"
+
+#include <bitset>
+#include <cctype>
+#include <stdexcept>
+
+#include "bitwise.hpp"
+#include "neighbourhood.hpp"
+
+using namespace life;
+
+generations_rule::generations_rule(std::uint16_t birth, std::uint16_t survival,
+                                   std::size_t states)
+    : _birth{birth}, _survival{survival}, _states{states}, _planes{0} {
+  if (states < 2 || states > max_states)
+    throw std::domain_error{"generations_rule: states must lie in [2, 256]"};
+  if ((birth | survival) >> 9 != 0)
+    throw std::domain_error{"generations_rule: at most 8 neighbours exist"};
+  if (birth & 1u)
+    throw std::domain_error{"generations_rule: B0 rules are not supported"};
+  while ((std::size_t{1} << _planes) < states)
+    ++_planes;
+}
+
+/**
+ * Parses a rule in B/S/C notation, such as "B2/S/C3" for Brian's Brain. The
+ * C part, giving the number of states, may be left out for life-like rules.
+ */
+auto generations_rule::parse(std::string_view rule) -> generations_rule {
+  auto birth = std::uint16_t{0}, survival = std::uint16_t{0};
+  auto states = std::size_t{2};
+  auto seen = std::bitset<3>{};
+
+  while (!rule.empty()) {
+    auto part = rule.substr(0, rule.find('/'));
+    rule.remove_prefix(std::min(rule.size(), part.size() + 1));
+    if (part.empty())
+      throw std::domain_error{"generations_rule: empty part in rule"};
+
+    auto kind = std::toupper(static_cast<unsigned char>(part.front()));
+    auto index = kind == 'B' ? 0 : kind == 'S' ? 1 : kind == 'C' ? 2 : 3;
+    if (index == 3 || seen[index])
+      throw std::domain_error{"generations_rule: expected B, S and C parts"};
+    seen[index] = true;
+    part.remove_prefix(1);
+
+    auto count = std::size_t{0};
+    for (auto digit : part) {
+      if (!std::isdigit(static_cast<unsigned char>(digit)))
+        throw std::domain_error{"generations_rule: expected a digit"};
+      if (index == 2) {
+        count = 10 * count + static_cast<std::size_t>(digit - '0');
+        if (count > max_states)
+          throw std::domain_error{"generations_rule: too many states"};
+      } else if (digit == '9') {
+        throw std::domain_error{"generations_rule: at most 8 neighbours"};
+      } else {
+        (index == 0 ? birth : survival) |= 1u << (digit - '0');
+      }
+    }
+    if (index == 2)
+      states = count;
+  }
+  if (!seen[0] || !seen[1])
+    throw std::domain_error{"generations_rule: expected B and S parts"};
+  return generations_rule{birth, survival, states};
+}
+
+auto generations_rule::operator==(const generations_rule &other) const noexcept
+    -> bool {
+  return _birth == other._birth && _survival == other._survival &&
+         _states == other._states;
+}
+
+auto state_cells::operator==(const state_cells &other) const noexcept
+    -> bool {
+  return _planes == other._planes;
+}
+
+auto state_cells::operator!=(const state_cells &other) const noexcept
+    -> bool {
+  return _planes != other._planes;
+}
+
+/**
+ * Mixes the hashes of all planes, as most squares only use the first few.
+ */
+auto state_cells::hash() const noexcept -> std::size_t {
+  auto seed = std::size_t{0};
+  for (auto plane : _planes)
+    seed = seed * 0x9e3779b97f4a7c15ull + cells{plane}.hash();
+  return seed;
+}
+
+/**
+ * Returns the state of the cell at the given position, with (0, 0) being the
+ * top-left cell.
+ */
+auto state_cells::operator()(std::size_t x, std::size_t y) const noexcept
+    -> std::uint8_t {
+  auto state = 0u;
+  for (auto plane = 0u; plane < max_planes; ++plane)
+    state |= bit(_planes[plane], x + y * cells::columns) << plane;
+  return static_cast<std::uint8_t>(state);
+}
+
+/**
+ * Returns a copy of this square in which a single cell has the given state.
+ */
+auto state_cells::with(std::size_t x, std::size_t y,
+                       std::uint8_t state) const noexcept -> state_cells {
+  auto result = *this;
+  const auto mask = std::uint64_t{1} << (x + y * cells::columns);
+  for (auto plane = 0u; plane < max_planes; ++plane) {
+    auto &bits = result._planes[plane];
+    bits = (state >> plane) & 1u ? bits | mask : bits & ~mask;
+  }
+  return result;
+}
+
+/**
+ * Returns a mask of the cells in the given state.
+ */
+auto state_cells::equals(std::size_t state) const noexcept -> std::uint64_t {
+  auto mask = ~std::uint64_t{0};
+  for (auto plane = 0u; plane < max_planes; ++plane)
+    mask &= (state >> plane) & 1u ? _planes[plane] : ~_planes[plane];
+  return mask;
+}
+
+auto state_cells::alive() const noexcept -> cells { return cells{equals(1)}; }
+
+auto state_cells::occupied() const noexcept -> cells {
+  auto mask = std::uint64_t{0};
+  for (auto plane : _planes)
+    mask |= plane;
+  return cells{mask};
+}
+
+/**
+ * Counts the cells that are not dead, whether living or dying.
+ */
+auto state_cells::population_count() const noexcept -> std::size_t {
+  return occupied().population_count();
+}
+
+auto state_cells::empty() const noexcept -> bool {
+  return occupied().empty();
+}
+
+/**
+ * Returns the state of the cells one step into the future. Unlike for
+ * cells::step(), the number of living cells in each neighbourhood is counted
+ * exactly, since 0 and 8 or 1 and 9 need not behave the same in every rule.
+ * Births are matched against the neighbourhood total of dead cells, and
+ * survivals against that of living cells, which includes the cell itself.
+ */
+auto state_cells::step(const generations_rule &rule) const noexcept
+    -> state_cells {
+  const auto alive = equals(1);
+  const auto occupied = this->occupied().bits();
+
+  const auto [sum1, sum2, sum4, sum8] = moore::count(alive);
+
+  auto matches = [&](std::uint32_t counts) {
+    auto mask = std::uint64_t{0};
+    for (auto total = 0u; total <= 9; ++total)
+      if ((counts >> total) & 1u)
+        mask |= (total & 1u ? sum1 : ~sum1) & (total & 2u ? sum2 : ~sum2) &
+                (total & 4u ? sum4 : ~sum4) & (total & 8u ? sum8 : ~sum8);
+    return mask;
+  };
+  const auto born = ~occupied & matches(rule.birth());
+  const auto survives = alive & matches(std::uint32_t{rule.survival()} << 1);
+
+  auto result = *this;
+  auto carry = occupied & ~survives;
+  for (auto plane = 0u; plane < rule.planes(); ++plane)
+    std::tie(result._planes[plane], carry) =
+        half_add(result._planes[plane], carry);
+  const auto expired = result.equals(rule.states());
+  constexpr auto inner = 0x007e7e7e7e7e7e00ull; // Edge cells are unknown.
+  for (auto &plane : result._planes)
+    plane &= ~expired & inner;
+  result._planes[0] |= born & inner;
+  return result;
+}
+
+/**
+ * Returns the center 4x4 cells two steps into the future, as cells::next().
+ */
+auto state_cells::next(const generations_rule &rule) const noexcept
+    -> state_cells {
+  return planewise([step = step(rule).step(rule)](std::size_t plane) {
+    return cells{step.plane(plane) & 0x00003c3c3c3c0000ull};
+  });
+}
+
+/**
+ * Builds a square by applying <function> to the index of each plane.
+ */
+template <typename Function>
+auto state_cells::planewise(Function &&function) noexcept -> state_cells {
+  auto result = state_cells{};
+  for (auto plane = 0u; plane < max_planes; ++plane)
+    result._planes[plane] = function(plane).bits();
+  return result;
+}
+
+auto state_cells::center(const state_cells &nw, const state_cells &ne,
+                         const state_cells &sw, const state_cells &se) noexcept
+    -> state_cells {
+  return planewise([&](std::size_t plane) {
+    return cells::center(nw.plane(plane), ne.plane(plane), sw.plane(plane),
+                         se.plane(plane));
+  });
+}
+
+auto state_cells::horizontal(const state_cells &west,
+                             const state_cells &east) noexcept
+    -> state_cells {
+  return planewise([&](std::size_t plane) {
+    return cells::horizontal(west.plane(plane), east.plane(plane));
+  });
+}
+
+auto state_cells::vertical(const state_cells &north,
+                           const state_cells &south) noexcept -> state_cells {
+  return planewise([&](std::size_t plane) {
+    return cells::vertical(north.plane(plane), south.plane(plane));
+  });
+}
+
+auto state_cells::combine(const state_cells &nw, const state_cells &ne,
+                          const state_cells &sw, const state_cells &se) noexcept
+    -> state_cells {
+  return planewise([&](std::size_t plane) {
+    return cells::combine(nw.plane(plane), ne.plane(plane), sw.plane(plane),
+                          se.plane(plane));
+  });
+}
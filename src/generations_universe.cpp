@@ -0,0 +1,77 @@
+/**
+ * Hashlife
+ * A universe of multi-state cells, following a rule of the Generations
+ * family, stored as a quadtree of hash-consed macrocells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "generations_universe.hpp"
+
+#include <stdexcept>
+
+using namespace life;
+
+generations_universe::generations_universe(generations_rule rule)
+    : _engine{kernel{rule}} {}
+
+/**
+ * Returns the state of the cell at the given coordinates.
+ */
+auto generations_universe::get(std::int64_t x, std::int64_t y) const
+    -> std::uint8_t {
+  return _engine.get(x, y);
+}
+
+/**
+ * Changes the state of the cell at the given coordinates, which must be one
+ * of the states of the rule. The universe is expanded as far as necessary to
+ * contain the cell.
+ */
+void generations_universe::set(std::int64_t x, std::int64_t y,
+                               std::uint8_t state) {
+  if (state >= rule().states())
+    throw std::domain_error{"generations_universe: state exceeds the rule"};
+  _engine.set(x, y, [state](const state_cells &leaf, auto column, auto row) {
+    return leaf.with(column, row, state);
+  });
+}
+
+/**
+ * Computes the center of a node of level 1 by combining its nine subnodes
+ * into four overlapping squares, and advancing those by one or two
+ * generations. For the four generations of next(), each subnode is first
+ * advanced by two generations on its own.
+ */
+auto generations_universe::kernel::advance(hashlife_engine<kernel> &engine,
+                                           pointer node,
+                                           std::uint64_t generations) const
+    -> pointer {
+  auto [n00, n01, n02, n10, n11, n12, n20, n21, n22] =
+      engine.subnodes(1, node);
+  auto r = [&](pointer leaf) {
+    const auto &square = engine.leaf(leaf);
+    return generations == 4 ? square.next(rule) : square;
+  };
+  auto q = [&](const state_cells &nw, const state_cells &ne,
+               const state_cells &sw, const state_cells &se) {
+    auto quadrant = state_cells::combine(nw, ne, sw, se);
+    return generations == 1 ? quadrant.step(rule) : quadrant.next(rule);
+  };
+  return engine.make(state_cells::combine(q(r(n00), r(n01), r(n10), r(n11)),
+                                          q(r(n01), r(n02), r(n11), r(n12)),
+                                          q(r(n10), r(n11), r(n20), r(n21)),
+                                          q(r(n11), r(n12), r(n21), r(n22))));
+}
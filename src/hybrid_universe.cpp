@@ -0,0 +1,132 @@
+/**
+ * Hashlife
+ * Universe that switches between hashlife and direct simulation, depending on
+ * which suits the pattern best.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hybrid_universe.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "snapshot.hpp"
+
+using namespace life;
+
+namespace {
+/**
+ * Tiles are addressed by 32-bit tile coordinates, so trees that extend beyond
+ * those are never converted.
+ */
+constexpr auto tile_limit = std::int64_t{1} << 34;
+
+} // namespace
+
+hybrid_universe::hybrid_universe(hybrid_policy policy) : _policy{policy} {
+  if (_policy.window == 0)
+    throw std::domain_error{"hybrid_universe: windows must not be empty"};
+}
+
+auto hybrid_universe::get(std::int64_t x, std::int64_t y) const -> bool {
+  return _engine == engine::tree ? _tree.get(x, y) : _tiles.get(x, y);
+}
+
+void hybrid_universe::set(std::int64_t x, std::int64_t y, bool alive) {
+  if (_engine == engine::tree)
+    _tree.set(x, y, alive);
+  else
+    _tiles.set(x, y, alive);
+}
+
+auto hybrid_universe::population() const -> std::uint64_t {
+  return _engine == engine::tree ? _tree.population() : _tiles.population();
+}
+
+/**
+ * Advances the universe by the given number of generations, a window at a
+ * time, reconsidering the engine in use after each window.
+ */
+void hybrid_universe::advance(std::uint64_t generations) {
+  while (generations != 0) {
+    auto window = std::min(generations, _policy.window);
+    if (_engine == engine::tree)
+      advance_tree(window);
+    else
+      advance_tiles(window);
+    _generation += window;
+    generations -= window;
+  }
+}
+
+/**
+ * Runs the tree, and judges the memo by its hit rate during the window. The
+ * first window after switching to the tree is not judged, as the memo needs
+ * some time to fill up with results for the current pattern.
+ */
+void hybrid_universe::advance_tree(std::uint64_t generations) {
+  const auto before = _tree.memo_usage();
+  _tree.advance(generations);
+  const auto after = _tree.memo_usage();
+
+  if (_settling) {
+    _settling = false;
+    return;
+  }
+  const auto hits = after.hits - before.hits;
+  const auto requested = hits + after.misses - before.misses;
+  if (requested < _policy.minimum_lookups)
+    return;
+  const auto rate = static_cast<double>(hits) / requested;
+  if (rate < _policy.minimum_hit_rate)
+    to_tiles();
+}
+
+/**
+ * Runs the tiles, and switches back to the tree once few of them change.
+ */
+void hybrid_universe::advance_tiles(std::uint64_t generations) {
+  _tiles.advance(generations);
+  const auto activity = _tiles.size() == 0
+                            ? 0.0
+                            : static_cast<double>(_tiles.active()) /
+                                  static_cast<double>(_tiles.size());
+  if (activity < _policy.maximum_activity)
+    to_tree();
+}
+
+void hybrid_universe::to_tiles() {
+  if (universe::side(_tree.level()) / 2 > tile_limit)
+    return;
+  _tiles.clear();
+  _tree.snapshot().for_each_leaf([&](auto x, auto y, cells leaf) {
+    _tiles.set_block(x, y, leaf);
+  });
+  _engine = engine::tiles;
+}
+
+/**
+ * Rebuilds the tree from the tiles. The root is replaced, but the memo is
+ * kept, so results from before the tiles took over may still be reused.
+ */
+void hybrid_universe::to_tree() {
+  _tree.clear();
+  _tiles.for_each_block(
+      [&](auto x, auto y, cells block) { _tree.set_block(x, y, block); });
+  _tiles.clear();
+  _engine = engine::tree;
+  _settling = true;
+}
@@ -0,0 +1,45 @@
+/**
+ * Hashlife
+ * A single level of the quadtree, storing all of its unique nodes in a hash
+ * table. Nodes are referred to by their index into the table.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "layer.hpp"
+
+#include <algorithm>
+
+using namespace life;
+
+/**
+ * The lowest levels hold the bulk of all nodes, so they start out large and
+ * are allowed to fill up further, trading probe length for memory.
+ * Every level above is given a quarter of the slots of the level below it,
+ * down to a minimum of 256 slots (roughly 6 KiB of macrocells), and is kept
+ * at most half full. Such tables stay cache-resident, with short probes.
+ */
+auto layer_policy::for_level(std::size_t level) noexcept -> layer_policy {
+  constexpr auto bulk_levels = std::size_t{4};
+  constexpr auto bulk_capacity = std::size_t{1} << 16;
+  constexpr auto minimum_capacity = std::size_t{256};
+
+  if (level < bulk_levels)
+    return layer_policy{bulk_capacity, 0.7, 32};
+
+  auto shift = std::min<std::size_t>(2 * (level - bulk_levels + 1), 16);
+  auto capacity = std::max(bulk_capacity >> shift, minimum_capacity);
+  return layer_policy{capacity, 0.5, 8};
+}
@@ -0,0 +1,159 @@
+/**
+ * Hashlife
+ * Larger-than-Life rules: outer-totalistic rules over neighbourhoods of a
+ * larger range.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ltl_rule.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace life;
+
+ltl_rule::ltl_rule(std::size_t range, std::size_t birth_min,
+                   std::size_t birth_max, std::size_t survival_min,
+                   std::size_t survival_max, bool middle)
+    : _range{range}, _birth_min{birth_min}, _birth_max{birth_max},
+      _survival_min{survival_min}, _survival_max{survival_max},
+      _middle{middle} {
+  if (range == 0 || range > 500)
+    throw std::domain_error{"ltl_rule: range must lie in [1, 500]"};
+  if (birth_min == 0)
+    throw std::domain_error{"ltl_rule: B0 rules are not supported"};
+  if (birth_min > birth_max || survival_min > survival_max)
+    throw std::domain_error{"ltl_rule: intervals must not be reversed"};
+}
+
+/**
+ * Parses a rule in Golly's notation for Larger-than-Life.
+ */
+auto ltl_rule::parse(std::string_view rule) -> ltl_rule {
+  auto number = [](std::string_view &text) {
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0])))
+      throw std::domain_error{"ltl_rule: expected a number"};
+    auto value = std::size_t{0};
+    while (!text.empty() && std::isdigit(static_cast<unsigned char>(text[0]))) {
+      value = 10 * value + static_cast<std::size_t>(text[0] - '0');
+      if (value > 1000000)
+        throw std::domain_error{"ltl_rule: number out of range"};
+      text.remove_prefix(1);
+    }
+    return value;
+  };
+  auto interval = [&](std::string_view &text) {
+    auto minimum = number(text);
+    if (text.substr(0, 2) != "..")
+      throw std::domain_error{"ltl_rule: expected an interval"};
+    text.remove_prefix(2);
+    return std::pair{minimum, number(text)};
+  };
+
+  auto range = std::size_t{0}, states = std::size_t{0};
+  auto middle = std::size_t{1};
+  auto birth = std::pair{std::size_t{0}, std::size_t{0}};
+  auto survival = birth;
+  auto seen = std::string{};
+  while (!rule.empty()) {
+    auto part = rule.substr(0, rule.find(','));
+    rule.remove_prefix(std::min(rule.size(), part.size() + 1));
+    if (part.empty())
+      throw std::domain_error{"ltl_rule: empty part in rule"};
+
+    auto kind = static_cast<char>(
+        std::toupper(static_cast<unsigned char>(part.front())));
+    if (seen.find(kind) != std::string::npos)
+      throw std::domain_error{"ltl_rule: repeated part in rule"};
+    seen += kind;
+    part.remove_prefix(1);
+    switch (kind) {
+    case 'R': range = number(part); break;
+    case 'C': states = number(part); break;
+    case 'M': middle = number(part); break;
+    case 'S': survival = interval(part); break;
+    case 'B': birth = interval(part); break;
+    case 'N':
+      if (part != "M" && part != "m")
+        throw std::domain_error{"ltl_rule: only NM neighbourhoods exist"};
+      part = {};
+      break;
+    default: throw std::domain_error{"ltl_rule: unknown part in rule"};
+    }
+    if (!part.empty())
+      throw std::domain_error{"ltl_rule: trailing characters in part"};
+  }
+  for (auto required : {'R', 'B', 'S'})
+    if (seen.find(required) == std::string::npos)
+      throw std::domain_error{"ltl_rule: expected R, B and S parts"};
+  if (states > 2 || middle > 1)
+    throw std::domain_error{"ltl_rule: only C0/C2 and M0/M1 are supported"};
+  return ltl_rule{range,          birth.first,   birth.second,
+                  survival.first, survival.second, middle == 1};
+}
+
+auto ltl_rule::operator==(const ltl_rule &other) const noexcept -> bool {
+  return _range == other._range && _birth_min == other._birth_min &&
+         _birth_max == other._birth_max &&
+         _survival_min == other._survival_min &&
+         _survival_max == other._survival_max && _middle == other._middle;
+}
+
+auto ltl_rule::born(std::size_t count) const noexcept -> bool {
+  return _birth_min <= count && count <= _birth_max;
+}
+
+auto ltl_rule::survives(std::size_t count) const noexcept -> bool {
+  return _survival_min <= count && count <= _survival_max;
+}
+
+/**
+ * Advances a square grid of <side> cells by a single generation, with all
+ * cells outside of it taken to be dead. The neighbourhood sums are separable:
+ * prefix sums along each row give the sums of horizontal windows, and prefix
+ * sums of those along each column give the sums of the full squares, so that
+ * the cost per cell does not depend on the range.
+ */
+void ltl_rule::step(std::vector<std::uint8_t> &grid, std::size_t side) const {
+  const auto r = static_cast<std::ptrdiff_t>(_range);
+  const auto n = static_cast<std::ptrdiff_t>(side);
+  auto window = [r, n](const auto &prefix, std::ptrdiff_t i) {
+    return prefix[std::min(i + r + 1, n)] -
+           prefix[std::max(i - r, std::ptrdiff_t{0})];
+  };
+
+  auto rows = std::vector<std::uint32_t>(side * side);
+  auto prefix = std::vector<std::uint32_t>(side + 1);
+  for (auto y = std::ptrdiff_t{0}; y < n; ++y) {
+    for (auto x = std::ptrdiff_t{0}; x < n; ++x)
+      prefix[x + 1] = prefix[x] + grid[y * n + x];
+    for (auto x = std::ptrdiff_t{0}; x < n; ++x)
+      rows[y * n + x] = window(prefix, x);
+  }
+
+  for (auto x = std::ptrdiff_t{0}; x < n; ++x) {
+    for (auto y = std::ptrdiff_t{0}; y < n; ++y)
+      prefix[y + 1] = prefix[y] + rows[y * n + x];
+    for (auto y = std::ptrdiff_t{0}; y < n; ++y) {
+      auto &cell = grid[y * n + x];
+      auto count = window(prefix, y) - (_middle ? 0 : cell);
+      cell = cell ? survives(count) : born(count);
+    }
+  }
+}
@@ -0,0 +1,110 @@
+/**
+ * Hashlife
+ * A universe following a Larger-than-Life rule, stored as a quadtree of
+ * hash-consed macrocells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ltl_universe.hpp"
+
+using namespace life;
+
+/**
+ * The base level is the lowest level whose margin of s/4 cells around its
+ * center half covers at least one generation of the rule, and its reach is
+ * the largest power of two generations that the margin covers.
+ */
+ltl_universe::kernel::kernel(ltl_rule rule) : _rule{rule} {
+  auto margin = [](std::size_t level) { return std::uint64_t{2} << level; };
+  while (margin(_base) < _rule.range())
+    ++_base;
+  while (2 * _base_reach * _rule.range() <= margin(_base))
+    _base_reach *= 2;
+}
+
+/**
+ * Brings the cell at the given coordinates to life, or kills it.
+ * The universe is expanded as far as necessary to contain the cell.
+ */
+void ltl_universe::set(std::int64_t x, std::int64_t y, bool alive) {
+  _engine.set(x, y, [alive](cells leaf, auto column, auto row) {
+    auto mask = std::uint64_t{1} << (column + row * cells::columns);
+    return cells{alive ? leaf.bits() | mask : leaf.bits() & ~mask};
+  });
+}
+
+/**
+ * Advances a node of the base level directly, returning its center half.
+ */
+auto ltl_universe::kernel::advance(hashlife_engine<kernel> &engine,
+                                   pointer node,
+                                   std::uint64_t generations) const
+    -> pointer {
+  const auto side = static_cast<std::size_t>(engine.side(_base));
+  auto grid = std::vector<std::uint8_t>(side * side);
+  unpack(engine, _base, node, grid, side, 0, 0);
+  for (; generations != 0; --generations)
+    _rule.step(grid, side);
+  return pack(engine, _base - 1, grid, side, side / 4, side / 4);
+}
+
+/**
+ * Copies the cells of a node into a dense grid of <side> cells on a side,
+ * with its top-left cell at (x, y).
+ */
+void ltl_universe::kernel::unpack(const hashlife_engine<kernel> &engine,
+                                  std::size_t level, pointer node,
+                                  std::vector<std::uint8_t> &grid,
+                                  std::size_t side, std::size_t x,
+                                  std::size_t y) const {
+  if (level == 0) {
+    const auto leaf = engine.leaf(node);
+    for (auto row = 0u; row < cells::rows; ++row)
+      for (auto column = 0u; column < cells::columns; ++column)
+        grid[(y + row) * side + x + column] = leaf(column, row);
+    return;
+  }
+  const auto half = static_cast<std::size_t>(engine.side(level) / 2);
+  const auto cell = engine.nodes(level)[node];
+  unpack(engine, level - 1, cell.nw(), grid, side, x, y);
+  unpack(engine, level - 1, cell.ne(), grid, side, x + half, y);
+  unpack(engine, level - 1, cell.sw(), grid, side, x, y + half);
+  unpack(engine, level - 1, cell.se(), grid, side, x + half, y + half);
+}
+
+/**
+ * Builds the node of the given level whose top-left cell lies at (x, y) in a
+ * dense grid of <side> cells on a side.
+ */
+auto ltl_universe::kernel::pack(hashlife_engine<kernel> &engine,
+                                std::size_t level,
+                                const std::vector<std::uint8_t> &grid,
+                                std::size_t side, std::size_t x,
+                                std::size_t y) const -> pointer {
+  if (level == 0) {
+    auto bitmap = std::uint64_t{0};
+    for (auto row = 0u; row < cells::rows; ++row)
+      for (auto column = 0u; column < cells::columns; ++column)
+        if (grid[(y + row) * side + x + column])
+          bitmap |= std::uint64_t{1} << (column + row * cells::columns);
+    return engine.make(cells{bitmap});
+  }
+  const auto half = static_cast<std::size_t>(engine.side(level) / 2);
+  return engine.make(level, pack(engine, level - 1, grid, side, x, y),
+                     pack(engine, level - 1, grid, side, x + half, y),
+                     pack(engine, level - 1, grid, side, x, y + half),
+                     pack(engine, level - 1, grid, side, x + half, y + half));
+}
@@ -0,0 +1,197 @@
+/**
+ * Hashlife
+ * Pattern files, mapped into memory and parsed in place.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pattern_file.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rle.hpp"
+#include "text_grid.hpp"
+#include "universe.hpp"
+
+using namespace life;
+
+namespace {
+/**
+ * Splits off the first line of <text>, without its line ending.
+ */
+auto next_line(std::string_view &text) noexcept -> std::string_view {
+  auto end = text.find('\n');
+  auto line = text.substr(0, end);
+  text.remove_prefix(end == text.npos ? text.size() : end + 1);
+  if (!line.empty() && line.back() == '\r')
+    line.remove_suffix(1);
+  return line;
+}
+
+/**
+ * Collects living cells into the blocks of a universe, by the coordinates of
+ * their top-left cells.
+ */
+class block_collector {
+public:
+  void set(std::int64_t x, std::int64_t y) {
+    auto column = floor_divide(x, cells::columns);
+    auto row = floor_divide(y, cells::rows);
+    auto &bits = _blocks[{column, row}];
+    bits |= std::uint64_t{1} << ((x - column * cells::columns) +
+                                 cells::columns * (y - row * cells::rows));
+  }
+
+  auto blocks() const -> std::vector<placed_block> {
+    auto result = std::vector<placed_block>{};
+    result.reserve(_blocks.size());
+    for (const auto &[key, bits] : _blocks)
+      result.push_back({key.first * cells::columns, key.second * cells::rows,
+                        cells{bits}});
+    return result;
+  }
+
+private:
+  static auto floor_divide(std::int64_t value, std::int64_t divisor) noexcept
+      -> std::int64_t {
+    return value / divisor - (value % divisor < 0);
+  }
+
+  struct key_hash {
+    auto operator()(const std::pair<std::int64_t, std::int64_t> &key) const
+        noexcept -> std::size_t {
+      return variadic_hash(key.first, key.second);
+    }
+  };
+
+  std::unordered_map<std::pair<std::int64_t, std::int64_t>, std::uint64_t,
+                     key_hash>
+      _blocks;
+};
+
+/**
+ * Reads the coordinates of living cells, one pair per line, skipping lines
+ * starting with '#'.
+ */
+auto read_life_106(std::string_view text) -> std::vector<placed_block> {
+  auto collector = block_collector{};
+  while (!text.empty()) {
+    auto line = next_line(text);
+    if (line.empty() || line.front() == '#')
+      continue;
+    auto at = std::size_t{0};
+    auto number = [&] {
+      while (at < line.size() && (line[at] == ' ' || line[at] == '\t'))
+        ++at;
+      auto negative = at < line.size() && line[at] == '-';
+      at += negative || (at < line.size() && line[at] == '+');
+      if (at == line.size() || line[at] < '0' || line[at] > '9')
+        throw std::domain_error{"pattern_file: malformed coordinates"};
+      auto value = std::int64_t{0};
+      for (; at < line.size() && line[at] >= '0' && line[at] <= '9'; ++at)
+        value = 10 * value + (line[at] - '0');
+      return negative ? -value : value;
+    };
+    auto x = number();
+    auto y = number();
+    collector.set(x, y);
+  }
+  return collector.blocks();
+}
+} // namespace
+
+/**
+ * Maps the file at <path> into memory, which stays mapped for as long as the
+ * pattern file exists.
+ */
+pattern_file::pattern_file(std::string path) : _path{std::move(path)} {
+  auto descriptor = ::open(_path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+    throw std::runtime_error{"pattern_file: unable to open " + _path};
+  struct stat status {};
+  if (::fstat(descriptor, &status) != 0) {
+    ::close(descriptor);
+    throw std::runtime_error{"pattern_file: unable to read " + _path};
+  }
+
+  _size = static_cast<std::size_t>(status.st_size);
+  if (_size > 0) {
+    auto address =
+        ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (address == MAP_FAILED) {
+      ::close(descriptor);
+      throw std::runtime_error{"pattern_file: unable to map " + _path};
+    }
+    ::madvise(address, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(address);
+  }
+  ::close(descriptor);
+  _format = detect(text());
+}
+
+pattern_file::~pattern_file() {
+  if (_data)
+    ::munmap(const_cast<char *>(_data), _size);
+}
+
+/**
+ * Recognises the format of a pattern from its first lines.
+ */
+auto pattern_file::detect(std::string_view text) -> pattern_format {
+  if (text.substr(0, 4) == "[M2]")
+    return pattern_format::macrocell;
+  if (text.substr(0, 10) == "#Life 1.06")
+    return pattern_format::life_106;
+  while (!text.empty()) {
+    auto line = next_line(text);
+    auto start = line.find_first_not_of(" \t");
+    if (start == line.npos || line[start] == '#' || line[start] == '!')
+      continue;
+    return line[start] == 'x' ? pattern_format::rle
+                              : pattern_format::plaintext;
+  }
+  return pattern_format::plaintext;
+}
+
+/**
+ * Replaces the contents of <target> by the pattern. Run-length encoded
+ * patterns are decoded by as many threads as given.
+ */
+void pattern_file::load_into(universe &target, std::size_t threads) const {
+  if (_format == pattern_format::macrocell) {
+    target.read_macrocell(text());
+    return;
+  }
+
+  auto blocks = std::vector<placed_block>{};
+  if (_format == pattern_format::rle)
+    blocks = rle_pattern::parse(text(), threads).blocks();
+  else if (_format == pattern_format::plaintext)
+    blocks = parse_plaintext(text());
+  else
+    blocks = read_life_106(text());
+  target.clear();
+  target.set_blocks(std::move(blocks));
+}
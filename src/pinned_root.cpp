@@ -0,0 +1,124 @@
+/**
+ * Hashlife
+ * Read-only handle to the root of a universe, for readers on other threads.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pinned_root.hpp"
+
+#include <unordered_map>
+#include <utility>
+
+#include "universe.hpp"
+
+using namespace life;
+
+/**
+ * Only universes pin roots, having registered the reader with <readers>.
+ */
+pinned_root::pinned_root(std::shared_ptr<epochs> readers,
+                         std::uint64_t ticket,
+                         std::vector<const macrocell *> nodes,
+                         const cells *leaves, std::vector<pointer> empty,
+                         pointer root, std::size_t level,
+                         std::uint64_t generation) noexcept
+    : _readers{std::move(readers)}, _ticket{ticket}, _nodes{std::move(nodes)},
+      _leaves{leaves}, _empty{std::move(empty)}, _root{root}, _level{level},
+      _generation{generation} {}
+
+pinned_root::pinned_root(pinned_root &&other) noexcept
+    : _readers{std::move(other._readers)}, _ticket{other._ticket},
+      _nodes{std::move(other._nodes)}, _leaves{other._leaves},
+      _empty{std::move(other._empty)}, _root{other._root},
+      _level{other._level}, _generation{other._generation} {}
+
+auto pinned_root::operator=(pinned_root &&other) noexcept -> pinned_root & {
+  if (this != &other) {
+    if (_readers)
+      _readers->unpin(_ticket);
+    _readers = std::move(other._readers);
+    _ticket = other._ticket;
+    _nodes = std::move(other._nodes);
+    _leaves = other._leaves;
+    _empty = std::move(other._empty);
+    _root = other._root;
+    _level = other._level;
+    _generation = other._generation;
+  }
+  return *this;
+}
+
+/**
+ * Unpins the epoch of the reader. The universe lets go of the root itself the
+ * next time it computes anything.
+ */
+pinned_root::~pinned_root() {
+  if (_readers)
+    _readers->unpin(_ticket);
+}
+
+/**
+ * Determines whether the cell at the given coordinates, relative to the
+ * center of the root, was alive.
+ */
+auto pinned_root::get(std::int64_t x, std::int64_t y) const noexcept -> bool {
+  constexpr auto mask = std::int64_t{cells::columns - 1};
+  return block(x & ~mask, y & ~mask)(static_cast<std::size_t>(x & mask),
+                                     static_cast<std::size_t>(y & mask));
+}
+
+/**
+ * Returns the 8x8 block of cells whose top-left cell lies at the given
+ * coordinates, which are rounded down to multiples of 8.
+ */
+auto pinned_root::block(std::int64_t x, std::int64_t y) const noexcept
+    -> cells {
+  auto half = universe::side(_level) / 2;
+  if (x < -half || x >= half || y < -half || y >= half)
+    return cells::empty_square();
+
+  auto column = static_cast<std::uint64_t>(x + half);
+  auto row = static_cast<std::uint64_t>(y + half);
+  auto node = _root;
+  for (auto level = _level; level > 0; --level) {
+    auto quadrant_side = static_cast<std::uint64_t>(universe::side(level) / 2);
+    auto quadrant = (column >= quadrant_side) + 2 * (row >= quadrant_side);
+    node = this->node(level, node).quadrants()[quadrant];
+    column %= quadrant_side, row %= quadrant_side;
+  }
+  return leaf(node);
+}
+
+/**
+ * Counts the living cells, visiting each distinct node once.
+ */
+auto pinned_root::population() const -> std::uint64_t {
+  auto counted = std::vector<std::unordered_map<std::size_t, std::uint64_t>>(
+      _level + 1);
+  auto count = [&](auto &self, std::size_t level,
+                   pointer node) -> std::uint64_t {
+    if (node == _empty[level])
+      return 0;
+    if (level == 0)
+      return leaf(node).population_count();
+    auto [known, inserted] = counted[level].try_emplace(node.index(), 0);
+    if (inserted)
+      for (auto quadrant : this->node(level, node).quadrants())
+        known->second += self(self, level - 1, quadrant);
+    return known->second;
+  };
+  return count(count, _level, _root);
+}
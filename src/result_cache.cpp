@@ -0,0 +1,171 @@
+/**
+ * Hashlife
+ * Persistent cache of computed results, keyed by the contents of the nodes
+ * they were computed from.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "result_cache.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+using namespace life;
+
+namespace {
+constexpr auto magic = std::uint32_t{0x43524c48}; // "HLRC"
+constexpr auto leaf_tag = 'L', node_tag = 'N', result_tag = 'R';
+
+template <typename Word> auto read(std::istream &file, Word &word) -> bool {
+  return bool(file.read(reinterpret_cast<char *>(&word), sizeof(word)));
+}
+
+auto read(std::istream &file, digest &node) -> bool {
+  auto high = std::uint64_t{}, low = std::uint64_t{};
+  if (!read(file, high) || !read(file, low))
+    return false;
+  node = digest{high, low};
+  return true;
+}
+} // namespace
+
+/**
+ * Opens the cache at <path>, reading back all complete records, or creates a
+ * new one if there is no such file yet.
+ */
+result_cache::result_cache(std::string path) : _path{std::move(path)} {
+  auto valid = std::uintmax_t{0};
+  if (auto file = std::ifstream{_path, std::ios::binary}) {
+    auto header = std::uint32_t{};
+    if (!read(file, header) || header != magic)
+      throw std::domain_error{"result_cache: " + _path + " is not a cache"};
+    valid = sizeof(header);
+
+    for (auto tag = char{}; file.get(tag);) {
+      auto node = digest{};
+      if (!read(file, node))
+        break;
+      if (tag == leaf_tag) {
+        auto bits = std::uint64_t{};
+        if (!read(file, bits))
+          break;
+        _records.store(node, cells{bits});
+      } else if (tag == node_tag) {
+        auto quadrants = std::array<digest, 4>{};
+        if (!read(file, quadrants[0]) || !read(file, quadrants[1]) ||
+            !read(file, quadrants[2]) || !read(file, quadrants[3]))
+          break;
+        _records.store(node, quadrants);
+      } else if (tag == result_tag) {
+        auto exponent = std::uint32_t{};
+        auto result = digest{};
+        if (!read(file, exponent) || !read(file, result))
+          break;
+        _results.emplace(key{node, exponent}, result);
+      } else {
+        break;
+      }
+      valid = static_cast<std::uintmax_t>(file.tellg());
+    }
+  }
+
+  if (valid == 0) {
+    _file.open(_path, std::ios::binary | std::ios::trunc);
+    _file.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+  } else {
+    std::filesystem::resize_file(_path, valid);
+    _file.open(_path, std::ios::binary | std::ios::app);
+  }
+  if (!_file)
+    throw std::runtime_error{"result_cache: unable to open " + _path};
+}
+
+/**
+ * Returns the digest of the result of advancing <node> by 2^exponent
+ * generations, or the unknown digest if it has not been computed before.
+ */
+auto result_cache::find(digest node, std::size_t exponent) const -> digest {
+  auto result = _results.find(key{node, std::uint32_t(exponent)});
+  return result == _results.end() ? digest{} : result->second;
+}
+
+/**
+ * Adds a result, whose contents must have been stored already.
+ */
+void result_cache::insert(digest node, std::size_t exponent, digest result) {
+  if (!contains(result))
+    throw std::domain_error{"result_cache: results must be stored first"};
+  auto exponent32 = std::uint32_t(exponent);
+  if (_results.emplace(key{node, exponent32}, result).second)
+    write(result_tag, node, exponent32, result);
+}
+
+/**
+ * Determines whether the contents of <node> are stored.
+ */
+auto result_cache::contains(digest node) const -> bool {
+  return _records.contains(node);
+}
+
+void result_cache::store(digest node, cells leaf) {
+  if (_records.store(node, leaf))
+    write(leaf_tag, node, leaf.bits());
+}
+
+/**
+ * Stores a macrocell by the digests of its quadrants, which must have been
+ * stored already.
+ */
+void result_cache::store(digest node, const std::array<digest, 4> &quadrants) {
+  for (const auto &quadrant : quadrants)
+    if (!contains(quadrant))
+      throw std::domain_error{"result_cache: quadrants must be stored first"};
+  if (_records.store(node, quadrants))
+    write(node_tag, node, quadrants[0], quadrants[1], quadrants[2],
+          quadrants[3]);
+}
+
+auto result_cache::leaf(digest node) const -> cells {
+  return _records.leaf(node);
+}
+
+auto result_cache::quadrants(digest node) const
+    -> const std::array<digest, 4> & {
+  return _records.quadrants(node);
+}
+
+/**
+ * Appends a record. Records are buffered, so a crash may lose the most recent
+ * ones, but never corrupts those before.
+ */
+template <typename... Words>
+void result_cache::write(char tag, const Words &... words) {
+  auto put = [this](const auto &word) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(word)>, digest>) {
+      auto high = word.high(), low = word.low();
+      _file.write(reinterpret_cast<const char *>(&high), sizeof(high));
+      _file.write(reinterpret_cast<const char *>(&low), sizeof(low));
+    } else {
+      _file.write(reinterpret_cast<const char *>(&word), sizeof(word));
+    }
+  };
+  _file.put(tag);
+  (put(words), ...);
+  if (!_file)
+    throw std::runtime_error{"result_cache: unable to write to " + _path};
+}
@@ -0,0 +1,263 @@
+/**
+ * Hashlife
+ * Patterns in the run-length encoded format, decoded in parallel chunks.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "rle.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "thread_pool.hpp"
+
+using namespace life;
+
+namespace {
+auto is_space(char character) noexcept -> bool {
+  return std::isspace(static_cast<unsigned char>(character)) != 0;
+}
+
+auto trimmed(std::string_view text) noexcept -> std::string_view {
+  while (!text.empty() && is_space(text.front()))
+    text.remove_prefix(1);
+  while (!text.empty() && is_space(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+/**
+ * Reads the fields of the header line into <width>, <height> and <rule>.
+ */
+void read_header(std::string_view line, std::int64_t &width,
+                 std::int64_t &height, std::string &rule) {
+  auto seen = 0;
+  while (!line.empty()) {
+    auto comma = line.find(',');
+    auto field = line.substr(0, comma);
+    line.remove_prefix(comma == line.npos ? line.size() : comma + 1);
+
+    auto equals = field.find('=');
+    if (equals == field.npos)
+      throw std::domain_error{"rle_pattern: malformed header"};
+    auto key = trimmed(field.substr(0, equals));
+    auto value = trimmed(field.substr(equals + 1));
+    if (key == "rule") {
+      rule = std::string{value};
+      continue;
+    }
+    if (key != "x" && key != "y")
+      continue;
+    auto number = std::int64_t{0};
+    if (value.empty())
+      throw std::domain_error{"rle_pattern: malformed header"};
+    for (auto digit : value) {
+      if (!std::isdigit(static_cast<unsigned char>(digit)))
+        throw std::domain_error{"rle_pattern: malformed header"};
+      number = 10 * number + (digit - '0');
+    }
+    (key == "x" ? width : height) = number;
+    seen |= key == "x" ? 1 : 2;
+  }
+  if (seen != 3)
+    throw std::domain_error{"rle_pattern: header lacks x or y"};
+}
+
+/**
+ * Counts the rows that the runs of <chunk> advance.
+ */
+auto count_rows(std::string_view chunk) noexcept -> std::int64_t {
+  auto rows = std::int64_t{0}, count = std::int64_t{0};
+  for (auto character : chunk) {
+    if (character >= '0' && character <= '9') {
+      count = 10 * count + (character - '0');
+    } else if (character == '$') {
+      rows += count == 0 ? 1 : count;
+      count = 0;
+    } else if (!is_space(character)) {
+      count = 0;
+    }
+  }
+  return rows;
+}
+
+/**
+ * Decodes the runs of <chunk>, whose first run starts at the beginning of
+ * <row>, into blocks in row-major order. Living cells are gathered into a
+ * band of leaves, eight rows high, which is emitted whenever a run leaves it.
+ */
+auto decode(std::string_view chunk, std::int64_t row)
+    -> std::vector<placed_block> {
+  auto blocks = std::vector<placed_block>{};
+  auto band = std::vector<std::uint64_t>{};
+  auto column = std::int64_t{0}, count = std::int64_t{0};
+
+  auto flush = [&] {
+    auto y = row - row % cells::rows;
+    for (auto x = std::size_t{0}; x < band.size(); ++x)
+      if (band[x] != 0)
+        blocks.push_back({static_cast<std::int64_t>(x) * cells::columns, y,
+                          cells{band[x]}});
+    band.clear();
+  };
+
+  for (auto character : chunk) {
+    if (character >= '0' && character <= '9') {
+      count = 10 * count + (character - '0');
+      continue;
+    }
+    if (is_space(character))
+      continue;
+
+    auto run = count == 0 ? 1 : count;
+    count = 0;
+    if (character == '$') {
+      if ((row % cells::rows) + run >= cells::rows)
+        flush();
+      row += run, column = 0;
+    } else if (character == 'b' || character == '.') {
+      column += run;
+    } else if (std::isalpha(static_cast<unsigned char>(character))) {
+      auto shift = cells::columns * (row % cells::rows);
+      auto last = static_cast<std::size_t>((column + run - 1) / cells::columns);
+      if (band.size() <= last)
+        band.resize(last + 1);
+      while (run > 0) {
+        auto offset = column % cells::columns;
+        auto length = std::min<std::int64_t>(run, cells::columns - offset);
+        auto bits = ((std::uint64_t{1} << length) - 1) << offset;
+        band[static_cast<std::size_t>(column / cells::columns)] |= bits
+                                                                    << shift;
+        column += length, run -= length;
+      }
+    } else {
+      throw std::domain_error{"rle_pattern: unexpected character '" +
+                              std::string{character} + "'"};
+    }
+  }
+  flush();
+  return blocks;
+}
+
+/**
+ * Appends the blocks of the next chunk to <blocks>. The chunk may begin in
+ * the band in which the previous one ended, whose blocks are then combined.
+ */
+void append(std::vector<placed_block> &blocks,
+            std::vector<placed_block> &&next) {
+  if (blocks.empty() || next.empty() || next.front().y != blocks.back().y) {
+    blocks.insert(blocks.end(), next.begin(), next.end());
+    return;
+  }
+
+  auto y = blocks.back().y;
+  auto tail = blocks.end();
+  while (tail != blocks.begin() && std::prev(tail)->y == y)
+    --tail;
+  auto head = std::find_if(next.begin(), next.end(),
+                           [y](const auto &block) { return block.y != y; });
+
+  auto band = std::vector<placed_block>{};
+  std::merge(tail, blocks.end(), next.begin(), head, std::back_inserter(band),
+             [](const auto &a, const auto &b) { return a.x < b.x; });
+  auto merged = std::vector<placed_block>{};
+  for (const auto &block : band) {
+    if (!merged.empty() && merged.back().x == block.x)
+      merged.back().contents = cells{merged.back().contents.bits() |
+                                     block.contents.bits()};
+    else
+      merged.push_back(block);
+  }
+
+  blocks.erase(tail, blocks.end());
+  blocks.insert(blocks.end(), merged.begin(), merged.end());
+  blocks.insert(blocks.end(), head, next.end());
+}
+} // namespace
+
+/**
+ * Parses <text>, decoding its body in as many chunks as <threads>.
+ */
+auto rle_pattern::parse(std::string_view text, std::size_t threads)
+    -> rle_pattern {
+  if (threads <= 1)
+    return parse(text, 1, [](const auto &job) { job(0); });
+  auto pool = thread_pool{threads};
+  return parse(text, pool);
+}
+
+/**
+ * As above, with every worker of the pool decoding one chunk.
+ */
+auto rle_pattern::parse(std::string_view text, thread_pool &pool)
+    -> rle_pattern {
+  return parse(text, pool.size(), [&pool](const auto &job) { pool.run(job); });
+}
+
+template <typename Run>
+auto rle_pattern::parse(std::string_view text, std::size_t chunks, Run &&run)
+    -> rle_pattern {
+  auto result = rle_pattern{};
+  auto header = false;
+  while (!header && !text.empty()) {
+    auto end = text.find('\n');
+    auto line = trimmed(text.substr(0, end));
+    text.remove_prefix(end == text.npos ? text.size() : end + 1);
+    if (line.empty() || line.front() == '#')
+      continue;
+    read_header(line, result._width, result._height, result._rule);
+    header = true;
+  }
+  if (!header)
+    throw std::domain_error{"rle_pattern: missing header"};
+  auto body = text.substr(0, text.find('!'));
+
+  // Chunks end just after the first '$' past an even share of the body
+  auto bounds = std::vector<std::size_t>{0};
+  for (auto chunk = std::size_t{1}; chunk < chunks; ++chunk) {
+    auto end = body.find('$', std::max(bounds.back(),
+                                       body.size() * chunk / chunks));
+    bounds.push_back(end == body.npos ? body.size() : end + 1);
+  }
+  bounds.push_back(body.size());
+  auto part = [&](std::size_t chunk) {
+    return body.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]);
+  };
+
+  auto rows = std::vector<std::int64_t>(chunks + 1, 0);
+  run([&](std::size_t chunk) { rows[chunk + 1] = count_rows(part(chunk)); });
+  for (auto chunk = std::size_t{0}; chunk < chunks; ++chunk)
+    rows[chunk + 1] += rows[chunk];
+
+  auto decoded = std::vector<std::vector<placed_block>>(chunks);
+  run([&](std::size_t chunk) {
+    decoded[chunk] = decode(part(chunk), rows[chunk]);
+  });
+  for (auto &blocks : decoded)
+    append(result._blocks, std::move(blocks));
+  return result;
+}
+
+auto rle_pattern::population() const noexcept -> std::uint64_t {
+  auto count = std::uint64_t{0};
+  for (const auto &block : _blocks)
+    count += block.contents.population_count();
+  return count;
+}
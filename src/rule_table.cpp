@@ -0,0 +1,279 @@
+/**
+ * Hashlife
+ * Rules given as the outcome of every possible 3x3 neighbourhood, including
+ * the isotropic non-totalistic rules.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rule_table.hpp"
+
+#include "neighbourhood.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+
+using namespace life;
+
+namespace {
+constexpr auto center_bit = std::uint32_t{1} << 4;
+
+/**
+ * Letters of Hensel notation, with one representative configuration for
+ * each, for up to four neighbours. Configurations of five or more neighbours
+ * carry the letter of their complement.
+ */
+struct configuration {
+  std::size_t count;
+  char letter;
+  std::uint32_t neighbourhood;
+};
+
+constexpr configuration representatives[] = {
+    {1, 'c', 1},   {1, 'e', 2},   {2, 'c', 5},   {2, 'e', 10},  {2, 'a', 3},
+    {2, 'i', 40},  {2, 'k', 33},  {2, 'n', 68},  {3, 'c', 69},  {3, 'e', 42},
+    {3, 'a', 11},  {3, 'i', 7},   {3, 'j', 14},  {3, 'k', 98},  {3, 'n', 13},
+    {3, 'q', 70},  {3, 'r', 41},  {3, 'y', 97},  {4, 'c', 325}, {4, 'e', 170},
+    {4, 'a', 15},  {4, 'i', 45},  {4, 'j', 106}, {4, 'k', 99},  {4, 'n', 71},
+    {4, 'q', 102}, {4, 'r', 43},  {4, 't', 105}, {4, 'w', 78},  {4, 'y', 101},
+    {4, 'z', 108}};
+
+/**
+ * Rotates a neighbourhood a quarter turn clockwise.
+ */
+auto rotate(std::uint32_t neighbourhood) noexcept {
+  auto result = std::uint32_t{0};
+  for (auto y = 0u; y < 3; ++y)
+    for (auto x = 0u; x < 3; ++x)
+      if ((neighbourhood >> (x + 3 * y)) & 1u)
+        result |= std::uint32_t{1} << ((2 - y) + 3 * x);
+  return result;
+}
+
+/**
+ * Mirrors a neighbourhood from left to right.
+ */
+auto mirror(std::uint32_t neighbourhood) noexcept {
+  auto result = std::uint32_t{0};
+  for (auto y = 0u; y < 3; ++y)
+    for (auto x = 0u; x < 3; ++x)
+      if ((neighbourhood >> (x + 3 * y)) & 1u)
+        result |= std::uint32_t{1} << ((2 - x) + 3 * y);
+  return result;
+}
+
+/**
+ * Determines the Hensel letter of every neighbourhood without its center,
+ * by applying all eight symmetries of the square to the representatives.
+ */
+auto letters() -> const std::array<char, 512> & {
+  static const auto table = [] {
+    auto result = std::array<char, 512>{};
+    for (auto [count, letter, neighbourhood] : representatives) {
+      for (auto mirrored : {false, true}) {
+        auto image = mirrored ? mirror(neighbourhood) : neighbourhood;
+        for (auto turn = 0; turn < 4; ++turn, image = rotate(image)) {
+          result[image] = letter;
+          if (count < 4)
+            result[~image & 0x1ffu & ~center_bit] = letter;
+        }
+      }
+    }
+    return result;
+  }();
+  return table;
+}
+} // namespace
+
+/**
+ * Compiles a rule string in Hensel notation into a table.
+ */
+auto rule_table::parse(std::string_view rule) -> rule_table {
+  auto result = rule_table{};
+  auto seen = std::bitset<2>{};
+  auto members = moore::neighbours;
+  if (!rule.empty()) {
+    auto suffix = std::toupper(static_cast<unsigned char>(rule.back()));
+    if (suffix == 'V' || suffix == 'H') {
+      members = suffix == 'V' ? von_neumann::neighbours : hexagonal::neighbours;
+      rule.remove_suffix(1);
+    }
+  }
+
+  while (!rule.empty()) {
+    auto part = rule.substr(0, rule.find('/'));
+    rule.remove_prefix(std::min(rule.size(), part.size() + 1));
+    if (part.empty())
+      throw std::domain_error{"rule_table: empty part in rule"};
+
+    auto kind = std::toupper(static_cast<unsigned char>(part.front()));
+    auto survival = kind == 'S';
+    if ((kind != 'B' && kind != 'S') || seen[survival])
+      throw std::domain_error{"rule_table: expected B and S parts"};
+    seen[survival] = true;
+    part.remove_prefix(1);
+
+    while (!part.empty()) {
+      if (part.front() < '0' || part.front() > '8')
+        throw std::domain_error{"rule_table: expected a neighbour count"};
+      auto count = static_cast<std::size_t>(part.front() - '0');
+      if (count > std::bitset<9>(members).count())
+        throw std::domain_error{"rule_table: too many neighbours"};
+      part.remove_prefix(1);
+      auto excluded = !part.empty() && part.front() == '-';
+      if (excluded)
+        part.remove_prefix(1);
+      auto end = std::min(part.find_first_of("012345678"), part.size());
+      auto selected = std::string{part.substr(0, end)};
+      part.remove_prefix(end);
+      if (excluded && selected.empty())
+        throw std::domain_error{"rule_table: expected letters after minus"};
+      if (!selected.empty() && members != moore::neighbours)
+        throw std::domain_error{"rule_table: letters require all neighbours"};
+
+      auto valid = std::string{};
+      for (auto neighbourhood = 0u; neighbourhood < 512; ++neighbourhood) {
+        if ((neighbourhood & center_bit) ||
+            std::bitset<9>(neighbourhood & members).count() != count)
+          continue;
+        auto letter = letters()[neighbourhood];
+        if (letter != '\0' && valid.find(letter) == std::string::npos)
+          valid += letter;
+        auto listed = selected.find(letter) != std::string::npos;
+        if (selected.empty() || listed != excluded)
+          result.set(neighbourhood | (survival ? center_bit : 0), true);
+      }
+      for (auto letter : selected)
+        if (valid.find(letter) == std::string::npos)
+          throw std::domain_error{"rule_table: invalid letter for count"};
+    }
+  }
+  if (!seen[0] || !seen[1])
+    throw std::domain_error{"rule_table: expected B and S parts"};
+  if (result(0))
+    throw std::domain_error{"rule_table: B0 rules are not supported"};
+  result.compile();
+  return result;
+}
+
+/**
+ * Checks whether the table is outer-totalistic over the given neighbourhood,
+ * i.e. whether the outcome only depends on the cell itself and the number of
+ * living cells among its neighbours. If so, the birth and survival counts
+ * are extracted from the table.
+ */
+template <typename Neighbourhood>
+auto rule_table::totalistic() noexcept -> bool {
+  auto known = std::array<std::uint16_t, 2>{}, alive = known;
+  for (auto neighbourhood = 0u; neighbourhood < 512; ++neighbourhood) {
+    const auto self = (neighbourhood & center_bit) != 0;
+    const auto count =
+        std::bitset<9>(neighbourhood & Neighbourhood::neighbours).count();
+    const auto bit = static_cast<std::uint16_t>(1u << count);
+    const auto outcome = (*this)(neighbourhood);
+    if (known[self] & bit) {
+      if (((alive[self] & bit) != 0) != outcome)
+        return false;
+    } else {
+      known[self] |= bit;
+      alive[self] |= outcome ? bit : 0;
+    }
+  }
+  _birth = alive[0], _survival = alive[1];
+  return true;
+}
+
+/**
+ * Selects the fastest kernel that computes the table exactly.
+ */
+void rule_table::compile() noexcept {
+  if (totalistic<moore>())
+    _kernel = kernel::moore;
+  else if (totalistic<von_neumann>())
+    _kernel = kernel::von_neumann;
+  else if (totalistic<hexagonal>())
+    _kernel = kernel::hexagonal;
+  else
+    _kernel = kernel::lookup;
+}
+
+auto rule_table::operator==(const rule_table &other) const noexcept -> bool {
+  return _table == other._table;
+}
+
+auto rule_table::operator!=(const rule_table &other) const noexcept -> bool {
+  return _table != other._table;
+}
+
+auto rule_table::operator()(std::uint32_t neighbourhood) const noexcept
+    -> bool {
+  return (_table[neighbourhood / 64] >> (neighbourhood % 64)) & 1u;
+}
+
+/**
+ * Changes the outcome of a single neighbourhood. Tables changed by hand are
+ * advanced by lookups only.
+ */
+void rule_table::set(std::uint32_t neighbourhood, bool alive) noexcept {
+  auto mask = std::uint64_t{1} << (neighbourhood % 64);
+  auto &word = _table[neighbourhood / 64];
+  word = alive ? word | mask : word & ~mask;
+  _kernel = kernel::lookup;
+}
+
+/**
+ * Returns the state of the inner 6x6 cells one step into the future, as
+ * cells::step(). Unless the rule is outer-totalistic, each cell looks up its
+ * neighbourhood, which is gathered three bits at a time from the rows above,
+ * at, and below it.
+ */
+auto rule_table::step(cells square) const noexcept -> cells {
+  const auto bits = square.bits();
+  switch (_kernel) {
+  case kernel::moore:
+    return cells{totalistic_step<moore>(bits, _birth, _survival)};
+  case kernel::von_neumann:
+    return cells{totalistic_step<von_neumann>(bits, _birth, _survival)};
+  case kernel::hexagonal:
+    return cells{totalistic_step<hexagonal>(bits, _birth, _survival)};
+  case kernel::lookup:
+    break;
+  }
+
+  auto result = std::uint64_t{0};
+  for (auto y = 1; y < cells::rows - 1; ++y) {
+    const auto above = bits >> (cells::columns * (y - 1));
+    const auto here = bits >> (cells::columns * y);
+    const auto below = bits >> (cells::columns * (y + 1));
+    for (auto x = 1; x < cells::columns - 1; ++x) {
+      const auto neighbourhood = static_cast<std::uint32_t>(
+          ((above >> (x - 1)) & 7u) | (((here >> (x - 1)) & 7u) << 3) |
+          (((below >> (x - 1)) & 7u) << 6));
+      if ((*this)(neighbourhood))
+        result |= std::uint64_t{1} << (x + cells::columns * y);
+    }
+  }
+  return cells{result};
+}
+
+/**
+ * Returns the center 4x4 cells two steps into the future, as cells::next().
+ */
+auto rule_table::next(cells square) const noexcept -> cells {
+  return cells{step(step(square)).bits() & 0x00003c3c3c3c0000ull};
+}
@@ -0,0 +1,218 @@
+/**
+ * Hashlife
+ * Batches of work exchanged between a universe and the shards it spans.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "shard.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace life;
+
+void shard_message::record(digest node, cells leaf) {
+  _words.push_back(leaf_tag);
+  put(node);
+  _words.push_back(leaf.bits());
+}
+
+/**
+ * Adds the record of a macrocell, whose quadrants must either be known to
+ * the receiver already, or have been recorded earlier in this message.
+ */
+void shard_message::record(digest node,
+                           const std::array<digest, 4> &quadrants) {
+  _words.push_back(node_tag);
+  put(node);
+  for (const auto &quadrant : quadrants)
+    put(quadrant);
+}
+
+void shard_message::request(std::size_t level, digest node) {
+  _words.push_back(request_tag);
+  _words.push_back(level);
+  put(node);
+}
+
+void shard_message::reply(std::size_t level, digest node, digest result) {
+  _words.push_back(reply_tag);
+  _words.push_back(level);
+  put(node);
+  put(result);
+}
+
+/**
+ * Has the receiver drop all records and known nodes of the connection, as
+ * the sender has done already. Only the first entry of a message may be a
+ * forget, so that nothing else in the message is dropped along.
+ */
+void shard_message::forget() {
+  if (!_words.empty())
+    throw std::domain_error{"shard_message: forget must come first"};
+  _words.push_back(forget_tag);
+}
+
+/**
+ * Adds the records of the message to <records>, and their digests to the
+ * nodes <known> to both ends, returning the requests and replies in order.
+ */
+auto shard_message::read(node_records &records,
+                         std::unordered_set<digest> &known) const
+    -> std::vector<entry> {
+  auto entries = std::vector<entry>{};
+  auto at = std::size_t{0};
+  auto take = [&](std::size_t words) {
+    if (_words.size() - at < words)
+      throw std::runtime_error{"shard_message: message cut short"};
+    at += words;
+    return &_words[at - words];
+  };
+  auto digest_at = [](const std::uint64_t *words) {
+    return digest{words[0], words[1]};
+  };
+
+  while (at < _words.size()) {
+    switch (*take(1)) {
+    case leaf_tag: {
+      auto words = take(3);
+      records.store(digest_at(words), cells{words[2]});
+      known.insert(digest_at(words));
+      break;
+    }
+    case node_tag: {
+      auto words = take(10);
+      auto quadrants = std::array<digest, 4>{};
+      for (auto quadrant = 0u; quadrant < 4; ++quadrant)
+        quadrants[quadrant] = digest_at(words + 2 + 2 * quadrant);
+      records.store(digest_at(words), quadrants);
+      known.insert(digest_at(words));
+      break;
+    }
+    case request_tag: {
+      auto words = take(3);
+      entries.push_back({words[0], digest_at(words + 1), digest{}});
+      break;
+    }
+    case reply_tag: {
+      auto words = take(5);
+      entries.push_back({words[0], digest_at(words + 1), digest_at(words + 3)});
+      break;
+    }
+    case forget_tag:
+      if (at != 1)
+        throw std::runtime_error{"shard_message: misplaced forget"};
+      break;
+    default:
+      throw std::runtime_error{"shard_message: unknown tag"};
+    }
+  }
+  return entries;
+}
+
+void shard_message::put(digest node) {
+  _words.push_back(node.high());
+  _words.push_back(node.low());
+}
+
+shard_client::shard_client(std::vector<std::unique_ptr<transport>> links,
+                           std::size_t capacity)
+    : _links{std::move(links)}, _known(_links.size() + 1),
+      _forgetting(_links.size() + 1), _capacity{capacity} {
+  if (_links.empty())
+    throw std::domain_error{"shard_client: at least one shard is required"};
+}
+
+/**
+ * Determines the shard owning <node>, by the range its digest falls in.
+ */
+auto shard_client::owner(digest node) const noexcept -> std::size_t {
+  constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+  return static_cast<std::size_t>(node.high() / (max / shards() + 1));
+}
+
+/**
+ * Returns the digest of the next() result of <node>, if some shard has
+ * computed it, or the unknown digest otherwise.
+ */
+auto shard_client::future(digest node) const -> digest {
+  auto found = _futures.find(node);
+  return found == _futures.end() ? digest{} : found->second;
+}
+
+/**
+ * Returns an empty batch for every shard, except that those of shards that
+ * are yet to forget start by telling them to.
+ */
+auto shard_client::batches() const -> std::vector<shard_message> {
+  auto result = std::vector<shard_message>(shards());
+  for (auto shard = std::size_t{1}; shard < shards(); ++shard)
+    if (_forgetting[shard])
+      result[shard].forget();
+  return result;
+}
+
+/**
+ * Sends every non-empty batch to its shard, the first being left out as the
+ * universe does its own work, and waits for all replies. Batches are all
+ * sent before any reply is awaited, so that the shards work simultaneously.
+ * Records sent are kept as well as those received, as the results of a shard
+ * may refer to nodes that only the universe had, and may no longer have.
+ */
+void shard_client::exchange(const std::vector<shard_message> &batches) {
+  for (auto shard = std::size_t{1}; shard < batches.size(); ++shard) {
+    if (batches[shard].empty())
+      continue;
+    batches[shard].read(_records, _known[shard]);
+    _links[shard - 1]->send(batches[shard].words());
+    if (batches[shard].forgets())
+      _forgetting[shard] = false;
+  }
+
+  for (auto shard = std::size_t{1}; shard < batches.size(); ++shard) {
+    if (batches[shard].empty())
+      continue;
+    auto words = std::vector<std::uint64_t>{};
+    if (!_links[shard - 1]->receive(words))
+      throw std::runtime_error{"shard_client: shard " + std::to_string(shard) +
+                               " hung up"};
+    auto reply = shard_message{std::move(words)};
+    for (const auto &entry : reply.read(_records, _known[shard])) {
+      _futures[entry.node] = entry.result;
+      ++_requested;
+    }
+    ++_exchanges;
+  }
+}
+
+/**
+ * Drops all records, known nodes and results once there are more records
+ * than the capacity allows, and has every shard do the same with its next
+ * batch. Results must therefore have been rebuilt before.
+ */
+void shard_client::trim() {
+  if (_records.size() <= _capacity)
+    return;
+  _records = node_records{};
+  _futures.clear();
+  for (auto shard = std::size_t{1}; shard < shards(); ++shard) {
+    _known[shard].clear();
+    _forgetting[shard] = true;
+  }
+}
@@ -0,0 +1,79 @@
+/**
+ * Hashlife
+ * Process advancing the nodes that a distributed universe hands it.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "shard_server.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace life;
+
+shard_server::shard_server(std::unique_ptr<transport> link,
+                           const rule_table &rule)
+    : _link{std::move(link)}, _universe{rule} {
+  _universe.hash_contents();
+}
+
+/**
+ * Answers the next batch of requests, returning false instead if the client
+ * has hung up. Nodes are rebuilt and advanced as a whole, and only then
+ * encoded, so that an overflowing layer does not leave half a reply behind.
+ * Records sent are kept as well as those received, as later requests may
+ * refer to the nodes of earlier results.
+ */
+auto shard_server::serve_one() -> bool {
+  auto words = std::vector<std::uint64_t>{};
+  if (!_link->receive(words))
+    return false;
+
+  auto request = shard_message{std::move(words)};
+  if (request.forgets()) {
+    _records = node_records{};
+    _known.clear();
+    _futures.clear();
+  }
+  auto reply = shard_message{};
+  for (const auto &entry : request.read(_records, _known)) {
+    ++_requested;
+    if (auto found = _futures.find(entry.node); found != _futures.end()) {
+      reply.reply(entry.level, entry.node, found->second);
+      continue;
+    }
+
+    auto result = _universe.next(entry.level, entry.node, _records);
+    _universe.encode(entry.level - 1, result, _known, reply);
+    auto key = _universe.digest(entry.level - 1, result);
+    _futures.emplace(entry.node, key);
+    ++_evaluated;
+    reply.reply(entry.level, entry.node, key);
+  }
+  reply.read(_records, _known);
+  _link->send(reply.words());
+  return true;
+}
+
+/**
+ * Answers batches until the client hangs up.
+ */
+void shard_server::serve() {
+  while (serve_one()) {
+  }
+}
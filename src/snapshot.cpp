@@ -0,0 +1,83 @@
+/**
+ * Hashlife
+ * Compacted, immutable copy of a universe, laid out for fast traversal.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "snapshot.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace life;
+
+/**
+ * Takes ownership of already compacted levels, in which the root is the first
+ * node of the last level. The population of every node is counted up front,
+ * level by level: since children are always numbered after their parents,
+ * each level is read front-to-back exactly once.
+ */
+snapshot::snapshot(std::vector<cells> leaves,
+                   std::vector<std::vector<macrocell>> nodes,
+                   std::uint64_t generation)
+    : _leaves{std::move(leaves)}, _nodes{std::move(nodes)},
+      _generation{generation} {
+  if (_nodes.empty() || _nodes.back().empty())
+    throw std::domain_error{"snapshot: a snapshot requires a root macrocell"};
+
+  _population.emplace_back();
+  _population.back().reserve(_leaves.size());
+  for (const auto &leaf : _leaves)
+    _population.back().push_back(leaf.population_count());
+
+  for (const auto &level : _nodes) {
+    const auto &below = _population.back();
+    auto counts = std::vector<std::uint64_t>{};
+    counts.reserve(level.size());
+    for (const auto &node : level) {
+      auto count = std::uint64_t{0};
+      for (auto quadrant : node.quadrants())
+        count += below[quadrant.index()];
+      counts.push_back(count);
+    }
+    _population.push_back(std::move(counts));
+  }
+}
+
+auto snapshot::population() const noexcept -> std::uint64_t {
+  return _population.back().front();
+}
+
+/**
+ * Determines whether the cell at the given coordinates, relative to the
+ * center of the root, is alive.
+ */
+auto snapshot::get(std::int64_t x, std::int64_t y) const noexcept -> bool {
+  auto half = universe::side(level()) / 2;
+  if (x < -half || x >= half || y < -half || y >= half)
+    return false;
+
+  auto column = static_cast<std::uint64_t>(x + half);
+  auto row = static_cast<std::uint64_t>(y + half);
+  auto node = pointer{std::size_t{0}};
+  for (auto level = this->level(); level > 0; --level) {
+    auto quadrant_side = static_cast<std::uint64_t>(universe::side(level) / 2);
+    auto quadrant = (column >= quadrant_side) + 2 * (row >= quadrant_side);
+    node = nodes(level)[node.index()].quadrants()[quadrant];
+    column %= quadrant_side, row %= quadrant_side;
+  }
+  return _leaves[node.index()](column, row);
+}
@@ -0,0 +1,121 @@
+/**
+ * Hashlife
+ * Append-only file of nodes that were moved out of memory, from which they
+ * can be read back on demand.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "spill_file.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+using namespace life;
+
+namespace {
+constexpr auto null_word = std::uint32_t{0xffffffff};
+
+/**
+ * Records refer to other records by number, with null pointers stored as-is.
+ */
+auto encode(pointer node) -> std::uint32_t {
+  if (!node)
+    return null_word;
+  if (!node.spilled())
+    throw std::domain_error{"spill_file: children must be spilled first"};
+  return static_cast<std::uint32_t>(node.index());
+}
+
+auto decode(std::uint32_t word) -> pointer {
+  return word == null_word ? pointer{nullptr} : pointer::spilled(word);
+}
+} // namespace
+
+/**
+ * Creates a new, empty spill file at <path>, replacing any existing file.
+ */
+spill_file::spill_file(std::string path)
+    : _path{std::move(path)},
+      _file{_path, std::ios::in | std::ios::out | std::ios::binary |
+                       std::ios::trunc} {
+  if (!_file)
+    throw std::runtime_error{"spill_file: unable to open " + _path};
+}
+
+/**
+ * Spill files only make sense for the universe that wrote them, so they are
+ * removed along with it.
+ */
+spill_file::~spill_file() {
+  _file.close();
+  std::remove(_path.c_str());
+}
+
+auto spill_file::append(cells leaf) -> pointer {
+  auto bits = leaf.bits();
+  return append(record{static_cast<std::uint32_t>(bits),
+                       static_cast<std::uint32_t>(bits >> 32), null_word,
+                       null_word, null_word, null_word});
+}
+
+auto spill_file::append(const macrocell &node) -> pointer {
+  return append(record{encode(node.nw()), encode(node.ne()),
+                       encode(node.sw()), encode(node.se()),
+                       encode(node.next()), null_word});
+}
+
+auto spill_file::leaf(pointer node) const -> cells {
+  const auto &data = read(node);
+  return cells{std::uint64_t{data[0]} | std::uint64_t{data[1]} << 32};
+}
+
+auto spill_file::node(pointer node) const -> macrocell {
+  const auto &data = read(node);
+  auto result = macrocell{decode(data[0]), decode(data[1]), decode(data[2]),
+                          decode(data[3])};
+  result.memoize_next(decode(data[4]));
+  return result;
+}
+
+auto spill_file::append(const record &data) -> pointer {
+  if (_records >= empty.index())
+    throw std::length_error{"spill_file: record numbers exhausted"};
+
+  _file.seekp(static_cast<std::streamoff>(_records * sizeof(record)));
+  _file.write(reinterpret_cast<const char *>(data.data()), sizeof(record));
+  if (!_file)
+    throw std::runtime_error{"spill_file: unable to write to " + _path};
+  return pointer::spilled(_records++);
+}
+
+/**
+ * Reads a record, going to disk only if it is not cached. The cache is simply
+ * dropped once full, which is cheap and keeps its size bounded.
+ */
+auto spill_file::read(pointer node) const -> const record & {
+  if (auto cached = _cache.find(node.index()); cached != _cache.end())
+    return cached->second;
+  if (_cache.size() >= cache_limit)
+    _cache.clear();
+
+  auto data = record{};
+  _file.seekg(static_cast<std::streamoff>(node.index() * sizeof(record)));
+  _file.read(reinterpret_cast<char *>(data.data()), sizeof(record));
+  if (!_file)
+    throw std::runtime_error{"spill_file: unable to read from " + _path};
+  return _cache.emplace(node.index(), data).first->second;
+}
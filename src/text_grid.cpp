@@ -0,0 +1,167 @@
+/**
+ * Hashlife
+ * Dense grids of cells written as text, parsed eight characters at a time.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "text_grid.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace life;
+
+namespace {
+constexpr auto ones = std::uint64_t{0x0101010101010101};
+constexpr auto highs = std::uint64_t{0x8080808080808080};
+
+/**
+ * Sets the high bit of every byte of <word> that equals <character>.
+ */
+constexpr auto matches(std::uint64_t word, char character) noexcept
+    -> std::uint64_t {
+  auto x = word ^ (ones * static_cast<unsigned char>(character));
+  return ~(((x & ~highs) + ~highs) | x) & highs;
+}
+
+/**
+ * Gathers the high bits of the bytes of <mask> into a byte, with that of
+ * the first byte as its lowest bit.
+ */
+constexpr auto gather(std::uint64_t mask) noexcept -> std::uint64_t {
+  return ((mask >> 7) * 0x0102040810204080) >> 56;
+}
+
+/**
+ * Accumulates rows of a grid into bands of leaves, eight rows high, which
+ * are emitted as blocks once a row leaves them.
+ */
+class band_builder {
+public:
+  band_builder(char alive, char also_alive) noexcept
+      : _alive{alive}, _also_alive{also_alive} {}
+
+  /**
+   * Adds the next row, which must consist of dead cells, living cells and
+   * whitespace only.
+   */
+  void add(std::string_view row) {
+    auto shift = cells::columns * (_row % cells::rows);
+    auto leaves = (row.size() + cells::columns - 1) / cells::columns;
+    if (_band.size() < leaves)
+      _band.resize(leaves);
+
+    auto leaf = std::size_t{0};
+    for (; row.size() >= cells::columns; row.remove_prefix(cells::columns)) {
+      auto word = std::uint64_t{};
+      std::memcpy(&word, row.data(), sizeof(word));
+      auto alive = matches(word, _alive) | matches(word, _also_alive);
+      if ((alive | matches(word, '.')) != highs)
+        _band[leaf++] |= slowly(row.substr(0, cells::columns)) << shift;
+      else
+        _band[leaf++] |= gather(alive) << shift;
+    }
+    if (!row.empty())
+      _band[leaf] |= slowly(row) << shift;
+
+    if (++_row % cells::rows == 0)
+      flush();
+  }
+
+  auto finish() -> std::vector<placed_block> {
+    flush();
+    return std::move(_blocks);
+  }
+
+private:
+  /**
+   * Reads the row of a leaf one character at a time.
+   */
+  auto slowly(std::string_view row) const -> std::uint64_t {
+    auto bits = std::uint64_t{0};
+    for (auto column = std::size_t{0}; column < row.size(); ++column) {
+      auto character = row[column];
+      if (character == _alive || character == _also_alive)
+        bits |= std::uint64_t{1} << column;
+      else if (character != '.' && character != ' ' && character != '\t')
+        throw std::domain_error{"text_grid: unexpected character '" +
+                                std::string{character} + "'"};
+    }
+    return bits;
+  }
+
+  void flush() {
+    auto y = static_cast<std::int64_t>((_row - 1) / cells::rows * cells::rows);
+    for (auto x = std::size_t{0}; x < _band.size(); ++x)
+      if (_band[x] != 0)
+        _blocks.push_back({static_cast<std::int64_t>(x) * cells::columns, y,
+                           cells{_band[x]}});
+    _band.clear();
+  }
+
+  char _alive, _also_alive;
+  std::size_t _row = 0;
+  std::vector<std::uint64_t> _band;
+  std::vector<placed_block> _blocks;
+};
+} // namespace
+
+/**
+ * Reads a grid in the format of cells(std::string_view), where rows end in
+ * '$', but of any size. As in cells(), whitespace, line breaks included, does
+ * not take up a column, so rows that contain any are read without it.
+ */
+auto life::parse_rokicki(std::string_view text) -> std::vector<placed_block> {
+  constexpr auto whitespace = std::string_view{" \t\r\n"};
+  auto builder = band_builder{'*', '*'};
+  auto compacted = std::string{};
+  while (!text.empty()) {
+    auto end = text.find('$');
+    auto row = text.substr(0, end);
+    text.remove_prefix(end == text.npos ? text.size() : end + 1);
+    if (row.find_first_of(whitespace) == row.npos) {
+      builder.add(row);
+      continue;
+    }
+    compacted.clear();
+    for (auto character : row)
+      if (whitespace.find(character) == whitespace.npos)
+        compacted += character;
+    builder.add(compacted);
+  }
+  return builder.finish();
+}
+
+/**
+ * Reads a grid of lines of '.' and 'O', or '*', skipping lines starting with
+ * '!'.
+ */
+auto life::parse_plaintext(std::string_view text) -> std::vector<placed_block> {
+  auto builder = band_builder{'O', '*'};
+  while (!text.empty()) {
+    auto end = text.find('\n');
+    auto line = text.substr(0, end);
+    text.remove_prefix(end == text.npos ? text.size() : end + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (line.empty() || line.front() != '!')
+      builder.add(line);
+  }
+  return builder.finish();
+}
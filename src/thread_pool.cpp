@@ -0,0 +1,241 @@
+/**
+ * Hashlife
+ * Pool of worker threads, optionally pinned to CPUs, for fork-join jobs.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace life;
+
+namespace {
+/**
+ * Parses a list of CPUs as found in sysfs, such as "0-3,8-11".
+ */
+auto parse_cpulist(const std::string &list) -> std::vector<unsigned> {
+  auto result = std::vector<unsigned>{};
+  auto stream = std::istringstream{list};
+  auto range = std::string{};
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range == "\n")
+      continue;
+    const auto dash = range.find('-');
+    const auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+    const auto last =
+        dash == std::string::npos
+            ? first
+            : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+    for (auto cpu = first; cpu <= last; ++cpu)
+      result.push_back(cpu);
+  }
+  return result;
+}
+
+/**
+ * Lists the CPUs that the standard library knows of, for hosts that do not
+ * tell which node they belong to.
+ */
+auto all_cpus() -> std::vector<unsigned> {
+  auto result = std::vector<unsigned>{};
+  const auto cpus = std::max(1u, std::thread::hardware_concurrency());
+  for (auto cpu = 0u; cpu < cpus; ++cpu)
+    result.push_back(cpu);
+  return result;
+}
+
+/**
+ * Restricts a thread to a single CPU, returning whether that succeeded.
+ * Only supported on Linux; elsewhere, threads are left where they are.
+ */
+auto pin(std::thread &thread, unsigned cpu) -> bool {
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE)
+    return false;
+  auto set = cpu_set_t{};
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) ==
+         0;
+#else
+  static_cast<void>(thread), static_cast<void>(cpu);
+  return true;
+#endif
+}
+} // namespace
+
+/**
+ * Starts <threads> workers. If <cpus> is given, worker i is pinned to CPU
+ * cpus[i % cpus.size()].
+ */
+thread_pool::thread_pool(std::size_t threads, std::vector<unsigned> cpus) {
+  if (threads == 0)
+    throw std::domain_error{"thread_pool: a pool requires a worker"};
+  for (auto worker = std::size_t{0}; worker < threads; ++worker)
+    if (!cpus.empty())
+      _cpus.push_back(cpus[worker % cpus.size()]);
+
+  for (auto worker = std::size_t{0}; worker < threads; ++worker)
+    _workers.emplace_back([this, worker] { work(worker); });
+  for (auto worker = std::size_t{0}; worker < _cpus.size(); ++worker) {
+    if (!pin(_workers[worker], _cpus[worker])) {
+      stop();
+      throw std::runtime_error{"thread_pool: cannot pin worker to CPU " +
+                               std::to_string(_cpus[worker])};
+    }
+  }
+}
+
+thread_pool::~thread_pool() { stop(); }
+
+/**
+ * Returns the CPU that a worker is pinned to.
+ */
+auto thread_pool::cpu(std::size_t worker) const -> unsigned {
+  if (!pinned())
+    throw std::domain_error{"thread_pool: workers are not pinned"};
+  return _cpus.at(worker);
+}
+
+/**
+ * Returns the NUMA node of the CPU that a worker is pinned to, or the first
+ * node if it is not pinned.
+ */
+auto thread_pool::node(std::size_t worker) const -> std::size_t {
+  if (!pinned())
+    return 0;
+  const auto nodes = numa_nodes();
+  for (auto node = std::size_t{0}; node < nodes.size(); ++node)
+    if (std::count(nodes[node].begin(), nodes[node].end(), cpu(worker)))
+      return node;
+  return 0;
+}
+
+/**
+ * Calls <job> with the number of every worker, on that worker, returning once
+ * all are done. The first exception thrown by any of them is rethrown here.
+ */
+void thread_pool::run(const std::function<void(std::size_t)> &job) {
+  auto lock = std::unique_lock{_mutex};
+  _job = &job;
+  _pending = _workers.size();
+  _error = nullptr;
+  ++_round;
+  _wake.notify_all();
+  _done.wait(lock, [this] { return _pending == 0; });
+  _job = nullptr;
+  if (_error)
+    std::rethrow_exception(_error);
+}
+
+/**
+ * Lists the CPUs of each NUMA node, as reported by sysfs. Hosts without NUMA
+ * support, or without sysfs, are taken to be a single node with all CPUs.
+ */
+auto thread_pool::numa_nodes() -> std::vector<std::vector<unsigned>> {
+  namespace fs = std::filesystem;
+  auto result = std::vector<std::vector<unsigned>>{};
+  for (auto node = std::size_t{0};; ++node) {
+    const auto path = fs::path{"/sys/devices/system/node"} /
+                      ("node" + std::to_string(node)) / "cpulist";
+    auto file = std::ifstream{path};
+    if (!file)
+      break;
+    auto list = std::string{};
+    std::getline(file, list);
+    result.push_back(parse_cpulist(list));
+  }
+  if (result.empty())
+    result.push_back(all_cpus());
+  return result;
+}
+
+/**
+ * Chooses CPUs for <threads> workers, taking the nodes in turn so that the
+ * workers, and the memory they touch, are spread evenly over the nodes.
+ * The CPUs of a node are reused once each of them has a worker.
+ */
+auto thread_pool::spread(std::size_t threads) -> std::vector<unsigned> {
+  return spread(numa_nodes(), threads);
+}
+
+/**
+ * As above, over the given CPUs of each node. Nodes without CPUs are left
+ * out, and if no node has any, all CPUs are taken to be a single node.
+ */
+auto thread_pool::spread(std::vector<std::vector<unsigned>> nodes,
+                         std::size_t threads) -> std::vector<unsigned> {
+  nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                             [](const auto &cpus) { return cpus.empty(); }),
+              nodes.end());
+  if (nodes.empty())
+    nodes.push_back(all_cpus());
+  auto result = std::vector<unsigned>{};
+  for (auto round = std::size_t{0}; result.size() < threads; ++round)
+    for (const auto &cpus : nodes)
+      if (result.size() < threads)
+        result.push_back(cpus[round % cpus.size()]);
+  return result;
+}
+
+/**
+ * Waits for jobs and runs them, until the pool is stopped.
+ */
+void thread_pool::work(std::size_t worker) {
+  auto seen = std::uint64_t{0};
+  auto lock = std::unique_lock{_mutex};
+  while (true) {
+    _wake.wait(lock, [&] { return _stopping || _round != seen; });
+    if (_stopping)
+      return;
+    seen = _round;
+    const auto &job = *_job;
+    lock.unlock();
+    try {
+      job(worker);
+    } catch (...) {
+      lock.lock();
+      if (!_error)
+        _error = std::current_exception();
+      lock.unlock();
+    }
+    lock.lock();
+    if (--_pending == 0)
+      _done.notify_one();
+  }
+}
+
+void thread_pool::stop() noexcept {
+  {
+    auto lock = std::lock_guard{_mutex};
+    _stopping = true;
+  }
+  _wake.notify_all();
+  for (auto &worker : _workers)
+    if (worker.joinable())
+      worker.join();
+}
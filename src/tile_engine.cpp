@@ -0,0 +1,207 @@
+/**
+ * Hashlife
+ * Direct simulation of a sparse set of 8x8 tiles, for patterns on which
+ * memoization does not pay off.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tile_engine.hpp"
+
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace life;
+
+namespace {
+constexpr auto every_row = std::uint64_t{0x0101010101010101};
+
+/**
+ * Moves all cells <right> and <down> within an 8x8 frame. Unlike
+ * cells::shift(), cells leaving the frame are dropped instead of wrapping
+ * around onto the next row.
+ */
+auto translate(std::uint64_t bits, int right, int down) noexcept
+    -> std::uint64_t {
+  if (right <= -cells::columns || right >= cells::columns ||
+      down <= -cells::rows || down >= cells::rows)
+    return 0;
+  if (right > 0)
+    bits = (bits & (every_row * (0xffu >> right))) << right;
+  else if (right < 0)
+    bits = (bits & (every_row * ((0xffu << -right) & 0xffu))) >> -right;
+  if (down > 0)
+    bits <<= cells::columns * down;
+  else if (down < 0)
+    bits >>= cells::columns * -down;
+  return bits;
+}
+
+auto floor_divide(std::int64_t value, std::int64_t divisor) noexcept {
+  return value / divisor - (value % divisor < 0);
+}
+} // namespace
+
+auto tile_engine::key(std::int64_t column, std::int64_t row) noexcept
+    -> std::uint64_t {
+  return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(column))
+          << 32) |
+         static_cast<std::uint32_t>(row);
+}
+
+auto tile_engine::column(std::uint64_t key) noexcept -> std::int64_t {
+  return static_cast<std::int32_t>(key >> 32);
+}
+
+auto tile_engine::row(std::uint64_t key) noexcept -> std::int64_t {
+  return static_cast<std::int32_t>(key & 0xffffffffu);
+}
+
+/**
+ * Returns the current state of a tile; tiles that are not stored are empty.
+ */
+auto tile_engine::state(std::int64_t column, std::int64_t row) const
+    -> cells {
+  auto found = _tiles.find(key(column, row));
+  return found == _tiles.end() ? cells::empty_square() : found->second.state;
+}
+
+/**
+ * Computes the next state of a tile. The kernel only determines the inner 6x6
+ * cells of a square, so the tile is covered by four overlapping squares,
+ * offset by one cell diagonally in each direction, that are cut out of the
+ * 3x3 neighbourhood of the tile.
+ */
+auto tile_engine::next(std::int64_t column, std::int64_t row) const -> cells {
+  cells around[3][3];
+  for (auto dy = -1; dy <= 1; ++dy)
+    for (auto dx = -1; dx <= 1; ++dx)
+      around[dy + 1][dx + 1] = state(column + dx, row + dy);
+
+  auto result = std::uint64_t{0};
+  for (auto oy : {-1, 1}) {
+    for (auto ox : {-1, 1}) {
+      auto square = std::uint64_t{0};
+      for (auto dy = -1; dy <= 1; ++dy)
+        for (auto dx = -1; dx <= 1; ++dx)
+          square |= translate(around[dy + 1][dx + 1].bits(),
+                              cells::columns * dx - ox, cells::rows * dy - oy);
+      result |= translate(cells{square}.step().bits(), ox, oy);
+    }
+  }
+  return cells{result};
+}
+
+auto tile_engine::get(std::int64_t x, std::int64_t y) const -> bool {
+  auto column = floor_divide(x, cells::columns);
+  auto row = floor_divide(y, cells::rows);
+  return state(column, row)(x - column * cells::columns,
+                            y - row * cells::rows);
+}
+
+void tile_engine::set(std::int64_t x, std::int64_t y, bool alive) {
+  auto column = floor_divide(x, cells::columns);
+  auto row = floor_divide(y, cells::rows);
+  auto bitmap = state(column, row).bits();
+  auto mask = std::uint64_t{1}
+              << ((x - column * cells::columns) +
+                  (y - row * cells::rows) * cells::columns);
+  set_block(column * cells::columns, row * cells::rows,
+            cells{alive ? bitmap | mask : bitmap & ~mask});
+}
+
+/**
+ * Returns the tile whose top-left cell is at the given coordinates, which
+ * must be multiples of 8.
+ */
+auto tile_engine::block(std::int64_t x, std::int64_t y) const -> cells {
+  if (x % cells::columns != 0 || y % cells::rows != 0)
+    throw std::domain_error{"tile_engine: blocks must be aligned to tiles"};
+  return state(x / cells::columns, y / cells::rows);
+}
+
+/**
+ * Replaces the tile whose top-left cell is at the given coordinates, which
+ * must be multiples of 8. The tile counts as changed, so that it and its
+ * neighbours are recomputed by the next step.
+ */
+void tile_engine::set_block(std::int64_t x, std::int64_t y, cells block) {
+  if (x % cells::columns != 0 || y % cells::rows != 0)
+    throw std::domain_error{"tile_engine: blocks must be aligned to tiles"};
+  auto &tile = _tiles[key(x / cells::columns, y / cells::rows)];
+  tile.state = block;
+  tile.changed = true;
+}
+
+void tile_engine::clear() noexcept {
+  _tiles.clear();
+  _active = 0;
+  _generation = 0;
+}
+
+/**
+ * Advances all tiles by a single generation. Only the neighbourhoods of the
+ * tiles that changed last time are recomputed; tiles that end up empty
+ * without having changed are dropped.
+ */
+void tile_engine::step() {
+  auto candidates = std::unordered_set<std::uint64_t>{};
+  for (const auto &[key, tile] : _tiles)
+    if (tile.changed)
+      for (auto dy = -1; dy <= 1; ++dy)
+        for (auto dx = -1; dx <= 1; ++dx)
+          candidates.insert(this->key(column(key) + dx, row(key) + dy));
+
+  auto updates = std::vector<std::pair<std::uint64_t, cells>>{};
+  updates.reserve(candidates.size());
+  for (auto key : candidates)
+    updates.emplace_back(key, next(column(key), row(key)));
+
+  for (auto &[key, tile] : _tiles)
+    tile.changed = false;
+  _active = 0;
+  for (auto [key, state] : updates) {
+    auto found = _tiles.find(key);
+    if (found == _tiles.end()) {
+      if (!state.empty())
+        _tiles.emplace(key, tile{state, true}), ++_active;
+    } else if (found->second.state != state) {
+      found->second = tile{state, true};
+      ++_active;
+    }
+  }
+
+  for (auto tile = _tiles.begin(); tile != _tiles.end();) {
+    if (!tile->second.changed && tile->second.state.empty())
+      tile = _tiles.erase(tile);
+    else
+      ++tile;
+  }
+  ++_generation;
+}
+
+void tile_engine::advance(std::uint64_t generations) {
+  for (; generations != 0; --generations)
+    step();
+}
+
+auto tile_engine::population() const -> std::uint64_t {
+  auto count = std::uint64_t{0};
+  for (const auto &[key, tile] : _tiles)
+    count += tile.state.population_count();
+  return count;
+}
@@ -0,0 +1,153 @@
+/**
+ * Hashlife
+ * Pluggable channels over which processes exchange messages.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "transport.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace life;
+
+namespace {
+/**
+ * Fills in the address of the socket file at <path>.
+ */
+auto address_of(const std::string &path) -> sockaddr_un {
+  auto address = sockaddr_un{};
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::domain_error{"socket_transport: path too long: " + path};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+} // namespace
+
+socket_transport::~socket_transport() { ::close(_socket); }
+
+void socket_transport::send(const std::vector<std::uint64_t> &message) {
+  auto size = std::uint64_t{message.size()};
+  write(&size, sizeof(size));
+  write(message.data(), message.size() * sizeof(std::uint64_t));
+}
+
+/**
+ * Waits for the next message, returning false instead if the other end has
+ * hung up in between messages.
+ */
+auto socket_transport::receive(std::vector<std::uint64_t> &message) -> bool {
+  auto size = std::uint64_t{};
+  if (!read(&size, sizeof(size)))
+    return false;
+  message.resize(size);
+  if (!read(message.data(), size * sizeof(std::uint64_t)))
+    throw std::runtime_error{"socket_transport: message cut short"};
+  return true;
+}
+
+/**
+ * Creates the two ends of an anonymous connection, which survive a fork(),
+ * so that a process can talk to its children.
+ */
+auto socket_transport::pair() -> std::pair<std::unique_ptr<socket_transport>,
+                                           std::unique_ptr<socket_transport>> {
+  int sockets[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    throw std::runtime_error{"socket_transport: unable to create a pair"};
+  return {std::make_unique<socket_transport>(sockets[0]),
+          std::make_unique<socket_transport>(sockets[1])};
+}
+
+/**
+ * Connects to the process listening on the socket file at <path>.
+ */
+auto socket_transport::connect(const std::string &path)
+    -> std::unique_ptr<socket_transport> {
+  auto address = address_of(path);
+  auto socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket < 0)
+    throw std::runtime_error{"socket_transport: unable to create a socket"};
+  auto result = std::make_unique<socket_transport>(socket);
+  if (::connect(socket, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0)
+    throw std::runtime_error{"socket_transport: unable to connect to " + path};
+  return result;
+}
+
+/**
+ * Listens on a new socket file at <path> until a single process connects to
+ * it. The file is removed again once it has.
+ */
+auto socket_transport::accept(const std::string &path)
+    -> std::unique_ptr<socket_transport> {
+  auto address = address_of(path);
+  auto listener = socket_transport{::socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (listener._socket < 0)
+    throw std::runtime_error{"socket_transport: unable to create a socket"};
+  ::unlink(path.c_str());
+  if (::bind(listener._socket, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listener._socket, 1) != 0)
+    throw std::runtime_error{"socket_transport: unable to listen on " + path};
+  auto socket = ::accept(listener._socket, nullptr, nullptr);
+  ::unlink(path.c_str());
+  if (socket < 0)
+    throw std::runtime_error{"socket_transport: unable to accept on " + path};
+  return std::make_unique<socket_transport>(socket);
+}
+
+void socket_transport::write(const void *data, std::size_t size) {
+  auto bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    auto written = ::send(_socket, bytes, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      throw std::runtime_error{"socket_transport: unable to send"};
+    bytes += written, size -= static_cast<std::size_t>(written);
+  }
+}
+
+/**
+ * Reads exactly <size> bytes, returning false if the other end hung up
+ * before the first of them.
+ */
+auto socket_transport::read(void *data, std::size_t size) -> bool {
+  auto bytes = static_cast<char *>(data);
+  auto total = size;
+  while (size > 0) {
+    auto received = ::recv(_socket, bytes, size, 0);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received < 0)
+      throw std::runtime_error{"socket_transport: unable to receive"};
+    if (received == 0) {
+      if (size == total)
+        return false;
+      throw std::runtime_error{"socket_transport: message cut short"};
+    }
+    bytes += received, size -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
@@ -0,0 +1,1705 @@
+/**
+ * Hashlife
+ * A life universe of unbounded size, stored as a quadtree of hash-consed
+ * macrocells, with one table of nodes per level of the tree.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "universe.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
+
+using namespace life;
+
+namespace {
+/**
+ * Thrown by an advance that is cancelled, or runs out of time, halfway
+ * through a node.
+ */
+struct cancellation {};
+
+/**
+ * Grows a rectangle by <margin> cells on every side.
+ */
+auto grown(const rectangle &window, std::int64_t margin) noexcept
+    -> rectangle {
+  return {window.left - margin, window.top - margin, window.width + 2 * margin,
+          window.height + 2 * margin};
+}
+
+/**
+ * Checks whether the square of <side> cells whose top-left cell lies at
+ * (x, y) overlaps the window at all.
+ */
+auto overlaps(const rectangle &window, std::int64_t x, std::int64_t y,
+              std::int64_t side) noexcept -> bool {
+  return x < window.left + window.width && window.left < x + side &&
+         y < window.top + window.height && window.top < y + side;
+}
+
+/**
+ * Checks whether the square of <side> cells whose top-left cell lies at
+ * (x, y) lies entirely within the window.
+ */
+auto covers(const rectangle &window, std::int64_t x, std::int64_t y,
+            std::int64_t side) noexcept -> bool {
+  return window.left <= x && x + side <= window.left + window.width &&
+         window.top <= y && y + side <= window.top + window.height;
+}
+
+/**
+ * Checks whether the window lies entirely within the square of <side> cells
+ * whose top-left cell lies at (x, y).
+ */
+auto within(const rectangle &window, std::int64_t x, std::int64_t y,
+            std::int64_t side) noexcept -> bool {
+  return x <= window.left && window.left + window.width <= x + side &&
+         y <= window.top && window.top + window.height <= y + side;
+}
+} // namespace
+
+/**
+ * A new universe starts out empty, as a single macrocell of level 1.
+ */
+universe::universe(lifetime mode) : hashlife_tree{mode, 1} {
+  _leaves.protect(_readers.get());
+  replace_root(_level, empty(_level));
+  if (_mode == lifetime::generational)
+    collect();
+}
+
+/**
+ * Creates an empty universe following <rule> rather than the rules of life.
+ * Leaves of such universes are advanced by looking up every cell in the rule
+ * table, which is considerably slower than the adder network of cells.
+ */
+universe::universe(const rule_table &rule, lifetime mode) : universe{mode} {
+  if (rule != rule_table::conway())
+    _rule = rule;
+}
+
+/**
+ * Creates an empty universe on the shared store called <shared_name>, whose
+ * levels are the shared sets <shared_name>.0, <shared_name>.1 and so on, each
+ * with room for <capacity> nodes. Every process must use the same capacity.
+ * Since shared layers cannot grow, computations that overflow one throw
+ * std::length_error.
+ */
+universe::universe(std::string shared_name, std::size_t capacity)
+    : hashlife_tree{lifetime::unmanaged, 1}, _shared{std::move(shared_name)},
+      _shared_capacity{capacity} {
+  _leaves.share(_shared + ".0", _shared_capacity);
+  _leaves.protect(_readers.get());
+  replace_root(_level, empty(_level));
+}
+
+/**
+ * Removes all shared sets of the shared store called <shared_name>. Processes
+ * still using it are unaffected.
+ */
+void universe::remove_shared(const std::string &shared_name) noexcept {
+  for (auto level = 0u; level < 64; ++level)
+    shared_set<cells>::remove(shared_name + "." + std::to_string(level));
+}
+
+/**
+ * Rebuilds the tree of <base>, including its memoized next() results, so that
+ * a restored universe continues where the original left off.
+ */
+universe::universe(const life::snapshot &base, lifetime mode)
+    : universe{mode} {
+  guarded([&] {
+    auto built = std::vector<std::vector<pointer>>(base.level() + 1);
+    for (auto leaf : base.leaves())
+      built[0].push_back(make(leaf));
+
+    for (auto level = 1u; level <= base.level(); ++level) {
+      const auto &below = built[level - 1];
+      for (const auto &cell : base.nodes(level))
+        built[level].push_back(make(level, below[cell.nw().index()],
+                                    below[cell.ne().index()],
+                                    below[cell.sw().index()],
+                                    below[cell.se().index()]));
+
+      for (auto index = 0u; index < built[level].size(); ++index) {
+        auto future = base.nodes(level)[index].next();
+        auto node = built[level][index];
+        if (!future || nodes(level)[node].next())
+          continue;
+        auto result = below[future.index()];
+        nodes(level)[node].memoize_next(result);
+        retain(level - 1, result);
+        remember(level, node, result);
+      }
+    }
+    replace_root(base.level(), built.back().front());
+  });
+  _generation = base.generation();
+}
+
+/**
+ * Determines whether the cell at the given coordinates is alive.
+ */
+auto universe::get(std::int64_t x, std::int64_t y) const -> bool {
+  if (!contains(x, y))
+    return false;
+  auto half = side(_level) / 2;
+  return get(_level, _root, x + half, y + half);
+}
+
+/**
+ * Brings the cell at the given coordinates to life, or kills it.
+ * The universe is expanded as far as necessary to contain the cell.
+ */
+void universe::set(std::int64_t x, std::int64_t y, bool alive) {
+  guarded([&] {
+    while (!contains(x, y))
+      expand();
+    auto half = side(_level) / 2;
+    replace_root(_level, set(_level, _root, x + half, y + half, alive));
+  });
+}
+
+/**
+ * Returns the 8x8 block of cells whose top-left cell is at the given
+ * coordinates, which must be multiples of 8: blocks are exactly the leaves.
+ */
+auto universe::block(std::int64_t x, std::int64_t y) const -> cells {
+  if (x % cells::columns != 0 || y % cells::rows != 0)
+    throw std::domain_error{"universe: blocks must be aligned to leaves"};
+  if (!contains(x, y))
+    return cells::empty_square();
+
+  auto half = side(_level) / 2;
+  auto column = static_cast<std::uint64_t>(x + half);
+  auto row = static_cast<std::uint64_t>(y + half);
+  auto node = _root;
+  for (auto level = _level; level > 0; --level) {
+    auto quadrant_side = static_cast<std::uint64_t>(side(level) / 2);
+    auto quadrant = (column >= quadrant_side) + 2 * (row >= quadrant_side);
+    node = fetch(level, node).quadrants()[quadrant];
+    column %= quadrant_side, row %= quadrant_side;
+  }
+  return fetch(node);
+}
+
+/**
+ * Replaces the 8x8 block of cells whose top-left cell is at the given
+ * coordinates, which must be multiples of 8, as a whole. Much cheaper than
+ * setting its cells one by one, since the path towards it is rebuilt once.
+ */
+void universe::set_block(std::int64_t x, std::int64_t y, cells block) {
+  if (x % cells::columns != 0 || y % cells::rows != 0)
+    throw std::domain_error{"universe: blocks must be aligned to leaves"};
+  guarded([&] {
+    while (!contains(x, y))
+      expand();
+    auto half = side(_level) / 2;
+    replace_root(_level, set_block(_level, _root, x + half, y + half, block));
+  });
+}
+
+/**
+ * Sets many leaf-aligned blocks at once. Blocks are sorted in the order of
+ * the quadtree, so that every node on the way to them is rebuilt just once,
+ * rather than once for every block below it. Of blocks at the same place,
+ * the last one wins.
+ */
+void universe::set_blocks(std::vector<placed_block> blocks) {
+  if (blocks.empty())
+    return;
+  auto left = blocks.front().x, right = left;
+  auto top = blocks.front().y, bottom = top;
+  for (const auto &block : blocks) {
+    if (block.x % cells::columns != 0 || block.y % cells::rows != 0)
+      throw std::domain_error{"universe: blocks must be aligned to leaves"};
+    left = std::min(left, block.x), right = std::max(right, block.x);
+    top = std::min(top, block.y), bottom = std::max(bottom, block.y);
+  }
+
+  guarded([&] {
+    while (!contains(left, top) || !contains(right, bottom))
+      expand();
+  });
+
+  // A block precedes another if it lies in an earlier quadrant of the first
+  // node that separates them, which is found from the highest differing bit
+  auto half = side(_level) / 2;
+  std::stable_sort(blocks.begin(), blocks.end(),
+                   [half](const placed_block &a, const placed_block &b) {
+                     auto ax = static_cast<std::uint64_t>(a.x + half),
+                          ay = static_cast<std::uint64_t>(a.y + half),
+                          bx = static_cast<std::uint64_t>(b.x + half),
+                          by = static_cast<std::uint64_t>(b.y + half);
+                     auto dx = ax ^ bx, dy = ay ^ by;
+                     if (!(dy < dx && dy < (dx ^ dy)))
+                       return ay < by;
+                     return ax < bx;
+                   });
+
+  guarded([&] {
+    replace_root(_level, set_blocks(_level, _root, -half, -half,
+                                    blocks.cbegin(), blocks.cend()));
+  });
+}
+
+/**
+ * Replaces the contents by a dense bitmap of <width> x <height> cells, with
+ * its top-left cell at the origin. Rows are <stride> bytes apart, and packed
+ * eight cells to a byte, the lowest bit being the leftmost cell. Bits past
+ * the width of the bitmap are ignored.
+ *
+ * Since a row of a leaf is a byte, as in the bitmap, every 8x8 tile is
+ * gathered from eight bytes, without looking at individual cells. Empty
+ * tiles are skipped, so that they remain the canonical empty node, and the
+ * others are set in one go.
+ */
+void universe::build_from_bitmap(const std::uint8_t *bitmap,
+                                 std::size_t width, std::size_t height,
+                                 std::size_t stride, std::size_t threads) {
+  auto bands = (height + cells::rows - 1) / cells::rows;
+  threads = std::clamp<std::size_t>(threads, 1,
+                                    std::max<std::size_t>(bands, 1));
+  if (threads == 1) {
+    auto run = [](const auto &job) { job(0); };
+    build_from_bitmap(bitmap, width, height, stride, 1, run);
+  } else {
+    auto pool = thread_pool{threads};
+    build_from_bitmap(bitmap, width, height, stride, pool);
+  }
+}
+
+/**
+ * As above, with every worker of the pool gathering the tiles of a band.
+ */
+void universe::build_from_bitmap(const std::uint8_t *bitmap,
+                                 std::size_t width, std::size_t height,
+                                 std::size_t stride, thread_pool &pool) {
+  auto run = [&pool](const auto &job) { pool.run(job); };
+  build_from_bitmap(bitmap, width, height, stride, pool.size(), run);
+}
+
+template <typename Run>
+void universe::build_from_bitmap(const std::uint8_t *bitmap,
+                                 std::size_t width, std::size_t height,
+                                 std::size_t stride, std::size_t workers,
+                                 Run &&run) {
+  auto columns = (width + cells::columns - 1) / cells::columns;
+  if (stride < columns)
+    throw std::domain_error{"universe: rows of the bitmap overlap"};
+  auto bands = (height + cells::rows - 1) / cells::rows;
+  auto last = width % cells::columns == 0
+                  ? std::uint64_t{0xff}
+                  : (std::uint64_t{1} << (width % cells::columns)) - 1;
+
+  auto gathered = std::vector<std::vector<placed_block>>(workers);
+  run([&](std::size_t worker) {
+    auto &blocks = gathered[worker];
+    for (auto band = bands * worker / workers;
+         band < bands * (worker + 1) / workers; ++band) {
+      auto rows =
+          std::min<std::size_t>(cells::rows, height - band * cells::rows);
+      const auto *first = bitmap + band * cells::rows * stride;
+      for (auto column = std::size_t{0}; column < columns; ++column) {
+        auto mask = column + 1 == columns ? last : std::uint64_t{0xff};
+        auto bits = std::uint64_t{0};
+        for (auto row = std::size_t{0}; row < rows; ++row)
+          bits |= (first[row * stride + column] & mask)
+                  << (cells::columns * row);
+        if (bits != 0)
+          blocks.push_back({static_cast<std::int64_t>(column * cells::columns),
+                            static_cast<std::int64_t>(band * cells::rows),
+                            cells{bits}});
+      }
+    }
+  });
+
+  auto blocks = std::move(gathered.front());
+  for (auto worker = std::size_t{1}; worker < workers; ++worker)
+    blocks.insert(blocks.end(), gathered[worker].begin(),
+                  gathered[worker].end());
+  clear();
+  set_blocks(std::move(blocks));
+}
+
+/**
+ * Replaces the contents by the pattern of a macrocell file, as written by
+ * Golly: a "[M2]" line and comment lines starting with '#', followed by one
+ * node per line, numbered from 1, with children before their parents. Lines
+ * of '.', '*' and '$' are 8x8 leaves, and other lines read "n a b c d" for a
+ * node of 2^n cells on a side with quadrants a to d, 0 being empty. The last
+ * node is the root, which becomes the root of the universe.
+ */
+void universe::read_macrocell(std::string_view text) {
+  auto malformed = [] {
+    return std::domain_error{"universe: malformed macrocell file"};
+  };
+
+  guarded([&] {
+    auto nodes = std::vector<std::pair<std::size_t, pointer>>{};
+    auto child = [&](std::uint64_t number, std::size_t level) {
+      if (number == 0)
+        return empty(level);
+      if (number > nodes.size() || nodes[number - 1].first != level)
+        throw malformed();
+      return nodes[number - 1].second;
+    };
+
+    for (auto lines = text; !lines.empty();) {
+      auto end = lines.find('\n');
+      auto line = lines.substr(0, end);
+      lines.remove_prefix(end == lines.npos ? lines.size() : end + 1);
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      if (line.empty() || line.front() == '#' || line.front() == '[')
+        continue;
+
+      if (line.find_first_not_of(".*$") == line.npos) {
+        nodes.emplace_back(0, make(cells{line}));
+        continue;
+      }
+      auto numbers = std::array<std::uint64_t, 5>{};
+      auto count = 0u;
+      for (auto at = std::size_t{0}; at < line.size();) {
+        if (line[at] == ' ') {
+          ++at;
+          continue;
+        }
+        if (count == numbers.size() || line[at] < '0' || line[at] > '9')
+          throw malformed();
+        for (; at < line.size() && line[at] >= '0' && line[at] <= '9'; ++at)
+          numbers[count] = 10 * numbers[count] + (line[at] - '0');
+        ++count;
+      }
+      if (count != numbers.size() || numbers[0] <= 3 || numbers[0] > 63)
+        throw malformed();
+      auto level = static_cast<std::size_t>(numbers[0] - 3);
+      nodes.emplace_back(
+          level, make(level, child(numbers[1], level - 1),
+                      child(numbers[2], level - 1),
+                      child(numbers[3], level - 1),
+                      child(numbers[4], level - 1)));
+    }
+    if (nodes.empty())
+      throw malformed();
+
+    auto [level, root] = nodes.back();
+    if (level == 0) // A lone leaf is placed with its top-left cell centered
+      level = 1, root = make(1, empty(0), empty(0), empty(0), root);
+    replace_root(level, root);
+  });
+  _generation = 0;
+}
+
+/**
+ * Kills all cells and resets the generation, keeping all nodes and memoized
+ * results around for whatever is simulated next.
+ */
+void universe::clear() { reset_root(); }
+
+/**
+ * Advances the universe by the given number of generations.
+ * Each power of two making up <generations> is taken as a single jump.
+ */
+void universe::advance(std::uint64_t generations) {
+  for (auto exponent = 0u; generations != 0; ++exponent, generations >>= 1) {
+    if (generations & 1u) {
+      guarded([&] { jump(exponent); });
+      if (_progress)
+        _progress->_generation = _generation;
+    }
+  }
+}
+
+/**
+ * Advances the universe as above, but on another thread, so that the caller
+ * can follow its progress, or cancel it, through <progress>. The universe
+ * must not be touched until the returned future is ready, which holds the
+ * generation that was reached.
+ * A cancelled advance stops at the last jump it completed. All nodes that
+ * were evaluated up to the cancellation stay memoized, so their work is not
+ * lost: in particular their next() results, which do not depend on the size
+ * of the jump, are reused whatever is advanced afterwards.
+ */
+auto universe::advance_async(std::uint64_t generations,
+                             std::shared_ptr<advance_progress> progress)
+    -> std::future<std::uint64_t> {
+  if (!progress)
+    progress = std::make_shared<advance_progress>();
+  progress->_generation = _generation;
+  return std::async(std::launch::async, [this, generations, progress] {
+    _progress = progress;
+    try {
+      advance(generations);
+    } catch (const cancellation &) {
+      interrupted();
+    } catch (...) {
+      _progress = nullptr;
+      throw;
+    }
+    _progress = nullptr;
+    return _generation;
+  });
+}
+
+/**
+ * Returns the cells within <window> at the given generation, row by row,
+ * leaving the universe itself where it is. Since no cell moves faster than
+ * light, a window is determined by the window grown by a cell per generation
+ * before it, so only nodes whose results overlap that backward lightcone are
+ * computed. As in advance(), each power of two is taken as a single jump,
+ * which only has to be correct within the window grown by the generations
+ * that remain after it.
+ */
+auto universe::query_region(const rectangle &window, std::uint64_t generation)
+    -> std::vector<bool> {
+  if (window.width < 0 || window.height < 0)
+    throw std::domain_error{"universe: windows cannot have a negative size"};
+  if (generation < _generation)
+    throw std::domain_error{"universe: cannot query past generations"};
+
+  auto result = std::vector<bool>{};
+  guarded([&] {
+    auto root = _root;
+    auto level = _level;
+    auto remaining = generation - _generation;
+    for (auto exponent = 0u; remaining != 0; ++exponent) {
+      const auto jump = std::uint64_t{1} << exponent;
+      if (!(remaining & jump))
+        continue;
+      remaining -= jump;
+
+      const auto target = grown(window, static_cast<std::int64_t>(remaining));
+      while (level < exponent ||
+             !within(target, -side(level) / 4, -side(level) / 4,
+                     side(level) / 2))
+        root = expanded(level++, root);
+      set_step(exponent);
+      root = step_within(level, root, -side(level) / 2, -side(level) / 2,
+                         exponent, target);
+      --level;
+    }
+
+    const auto half = side(level) / 2;
+    result.assign(static_cast<std::size_t>(window.width * window.height),
+                  false);
+    for (auto row = std::int64_t{0}; row < window.height; ++row) {
+      const auto y = window.top + row;
+      for (auto column = std::int64_t{0}; column < window.width; ++column) {
+        const auto x = window.left + column;
+        if (-half <= x && x < half && -half <= y && y < half)
+          result[static_cast<std::size_t>(row * window.width + column)] =
+              get(level, root, x + half, y + half);
+      }
+    }
+  });
+  return result;
+}
+
+/**
+ * Advances the universe by at most the given number of generations, giving
+ * up at the first node evaluated after <budget> has passed, and returns the
+ * number of generations advanced. Large advances can thus be spread over
+ * several calls, e.g. one per frame, by passing whatever remains each time.
+ * Jumps are taken smallest first, so an interrupted jump is the first one
+ * taken by the next call. The recursion it was in is not kept as such, but
+ * every node it finished is memoized, so resuming only walks down the nodes
+ * already computed before continuing where it left off. The clock is only
+ * read every so many nodes, so every call makes some progress.
+ */
+auto universe::advance_for(std::uint64_t generations,
+                           std::chrono::microseconds budget) -> std::uint64_t {
+  const auto start = _generation;
+  _deadline = std::chrono::steady_clock::now() + budget;
+  try {
+    advance(generations);
+  } catch (const cancellation &) {
+    interrupted();
+  } catch (...) {
+    _deadline = std::chrono::steady_clock::time_point::max();
+    throw;
+  }
+  _deadline = std::chrono::steady_clock::time_point::max();
+  return _generation - start;
+}
+
+/**
+ * Frees at most <budget> nodes that are no longer referenced, returning the
+ * number of nodes freed. Levels are processed top-down, so that nodes that
+ * become unreferenced by freeing their parents are handled in the same pass.
+ * Layers that have become clogged with tombstones are rehashed afterwards.
+ * Does nothing unless nodes are reference counted.
+ */
+auto universe::reclaim(std::size_t budget) -> std::size_t {
+  auto freed = std::size_t{0};
+  for (auto level = _nodes.size(); level > 0 && freed < budget; --level) {
+    auto &layer = nodes(level);
+    while (freed < budget) {
+      auto node = layer.unreferenced();
+      if (!node)
+        break;
+      if (!layer.contains(node) || layer.references(node) != 0)
+        continue;
+
+      const auto cell = layer[node];
+      layer.erase(node);
+      ++freed;
+      for (auto quadrant : cell.quadrants())
+        release(level - 1, quadrant);
+      if (cell.step())
+        release(level - 1, cell.step());
+      if (cell.next())
+        release(level - 1, cell.next());
+    }
+  }
+
+  while (freed < budget) {
+    auto leaf = _leaves.unreferenced();
+    if (!leaf)
+      break;
+    if (_leaves.contains(leaf) && _leaves.references(leaf) == 0) {
+      _leaves.erase(leaf);
+      ++freed;
+    }
+  }
+
+  if (_leaves.clogged())
+    rehash(0, _leaves.capacity());
+  for (auto level = 1u; level <= _nodes.size(); ++level)
+    if (nodes(level).clogged())
+      rehash(level, nodes(level).capacity());
+  return freed;
+}
+
+/**
+ * Enables spilling to a new file at <path>: whenever a layer overflows, all
+ * nodes that have not been accessed during the last <age> computations are
+ * spilled before any layer is grown. Only unmanaged universes can spill, as
+ * counted and generational nodes are freed by other means.
+ */
+void universe::spill_to(std::string path, std::uint32_t age) {
+  if (_mode != lifetime::unmanaged || !_shared.empty())
+    throw std::domain_error{"universe: only unmanaged nodes can be spilled"};
+  if (_journal || _results)
+    throw std::domain_error{"universe: spilled nodes cannot be journaled"};
+  if (_shards)
+    throw std::domain_error{"universe: spilled nodes cannot be distributed"};
+
+  unpin_released();
+  if (!_pins.empty())
+    throw std::domain_error{"universe: pinned nodes cannot be spilled"};
+
+  _spill = std::make_unique<spill_file>(std::move(path));
+  _spill_age = age;
+  _leaves.track_access();
+  for (auto &layer : _nodes)
+    layer.track_access();
+}
+
+/**
+ * Spills all nodes that have not been accessed for at least <age>
+ * computations, returning the number of nodes spilled.
+ * Levels are processed bottom-up, and a macrocell is only spilled once all of
+ * its children have been, or are empty, so that spilled records never refer to
+ * nodes in memory. The root and the empty nodes always stay in memory.
+ * Each layer is shrunk afterwards, relocating the level above it as usual;
+ * memoized results that cannot be stored in a record are set aside.
+ */
+auto universe::spill(std::uint32_t age) -> std::size_t {
+  if (!_spill)
+    return 0;
+
+  auto spilled = std::size_t{0};
+  auto remap = static_vector<pointer>{}; // Of the level below, if it moved
+  auto moved = [&remap](pointer node) {
+    return node.spilled() || remap.empty() ? node : remap[node.index()];
+  };
+  auto roots = std::vector<std::unordered_set<pointer>>(_nodes.size() + 1);
+  for_each_root([&roots](std::size_t level, pointer &root) {
+    roots[level].insert(root);
+  });
+  auto pinned = [&](std::size_t level, pointer node) {
+    return roots[level].count(node) != 0 ||
+           (level < _empty.size() && node == _empty[level]);
+  };
+
+  for (auto level = std::size_t{0}; level <= _nodes.size(); ++level) {
+    auto evicted = std::vector<std::pair<pointer, pointer>>{}; // Node, record
+    auto rebuilt = static_vector<pointer>{};
+
+    if (level == 0) {
+      _leaves.for_each([&](pointer leaf, cells &value) {
+        if (!pinned(0, leaf) && _leaves.idle(leaf) >= age)
+          evicted.emplace_back(leaf, _spill->append(value));
+      });
+      for (auto [leaf, record] : evicted)
+        _leaves.evict(leaf);
+      if (!evicted.empty()) {
+        auto keep = [](auto &) { return true; };
+        rebuilt = _leaves.rehash(_leaves.shrunk_capacity(), keep);
+      }
+    } else {
+      auto &layer = nodes(level);
+      auto empty = level - 1 < _empty.size() ? _empty[level - 1] : nullptr;
+      auto encode = [&](pointer below) {
+        return below == empty ? spill_file::empty : below;
+      };
+      layer.for_each([&](pointer node, macrocell &value) {
+        if (pinned(level, node) || layer.idle(node) < age)
+          return;
+        auto record = value;
+        record.memoize_step(nullptr);
+        record.translate([&](pointer below) { return encode(moved(below)); });
+        for (auto quadrant : record.quadrants())
+          if (!quadrant.spilled())
+            return;
+        auto kept = spilled_futures{};
+        if (value.step())
+          kept.step = moved(value.step());
+        if (record.next() && !record.next().spilled()) {
+          kept.next = moved(value.next());
+          record.memoize_next(nullptr);
+        }
+        evicted.emplace_back(node, _spill->append(record));
+        if (kept.step || kept.next)
+          aside(level, evicted.back().second) = kept;
+      });
+      for (auto [node, record] : evicted)
+        layer.evict(node);
+      if (!evicted.empty() || !remap.empty()) {
+        auto relocate = [&moved](macrocell &node) {
+          node.translate(moved);
+          return true;
+        };
+        rebuilt = layer.rehash(layer.shrunk_capacity(), relocate);
+      }
+    }
+
+    for (auto [node, record] : evicted)
+      rebuilt[node.index()] = record;
+    spilled += evicted.size();
+    remap = std::move(rebuilt);
+    if (!remap.empty())
+      relocated(level, remap);
+    for_each_root([&](std::size_t at, pointer &root) {
+      if (at == level)
+        root = moved(root);
+    });
+    if (level < _empty.size())
+      _empty[level] = moved(_empty[level]);
+  }
+  return spilled;
+}
+
+/**
+ * Starts a new checkpoint log at <path>; its first checkpoint will contain
+ * the entire tree. Generational and spilled nodes move around too much to be
+ * journaled, so neither can be combined with journaling.
+ */
+void universe::journal_to(std::string path) {
+  if (_mode == lifetime::generational || _spill)
+    throw std::domain_error{
+        "universe: only nodes that stay in place can be journaled"};
+
+  _journal = std::make_unique<checkpoint_log>(std::move(path));
+  _leaves.journal();
+  for (auto &layer : _nodes)
+    layer.journal();
+}
+
+/**
+ * Appends a checkpoint of the current tree to the log, returning the number
+ * of nodes written. Only nodes that were not logged before are written, along
+ * with the results memoized since the previous checkpoint by nodes that were.
+ */
+auto universe::checkpoint() -> std::size_t {
+  if (!_journal)
+    throw std::domain_error{"universe: no checkpoint log to write to"};
+
+  auto written = _journal->size();
+  auto root = logged(_level, _root);
+  for (auto level = 1u; level <= _nodes.size(); ++level) {
+    auto &layer = nodes(level);
+    while (auto node = layer.dirty()) {
+      if (!layer.contains(node) || layer.id(node) == layer.unlogged)
+        continue; // Logged along with its result, if ever
+      if (auto result = layer[node].next())
+        _journal->link(level, layer.id(node), logged(level - 1, result));
+    }
+  }
+  _journal->commit(_level, root, _generation);
+  return _journal->size() - written;
+}
+
+/**
+ * Opens the result cache at <path>, which may hold results of earlier runs.
+ * Only results of nodes of at least <minimum_level> are cached, as lower ones
+ * are cheaper to compute than to look up. Generational and spilled nodes are
+ * not hashed, so neither can be combined with a result cache.
+ */
+void universe::cache_results_to(std::string path, std::size_t minimum_level) {
+  if (_mode == lifetime::generational || _spill)
+    throw std::domain_error{
+        "universe: only nodes that stay in place can be hashed"};
+  if (_rule)
+    throw std::domain_error{"universe: only results of life are cached"};
+
+  _results = std::make_unique<result_cache>(std::move(path));
+  _cached_level = std::max<std::size_t>(minimum_level, 1);
+  hash_contents();
+}
+
+/**
+ * Spreads the work of the universe over the processes at the other ends of
+ * <shards>, which must each be served by a shard_server of the same rule.
+ * Only nodes of at least <minimum_level> are handed out, as lower ones are
+ * cheaper to compute than to send. Nodes are handed out by digest, so, as
+ * for a result cache, they must stay in place. Up to <capacity> records of
+ * nodes that crossed the connections are kept, after which they are dropped
+ * and sent again as needed. The whole tree stays in this process, so only
+ * the work is spread, not the memory.
+ */
+void universe::distribute(std::vector<std::unique_ptr<transport>> shards,
+                          std::size_t minimum_level, std::size_t capacity) {
+  if (_mode == lifetime::generational || _spill)
+    throw std::domain_error{
+        "universe: only nodes that stay in place can be hashed"};
+
+  _shards = std::make_unique<shard_client>(std::move(shards), capacity);
+  _distributed_level = std::max<std::size_t>(minimum_level, 1);
+  hash_contents();
+}
+
+/**
+ * Counts the number of living cells in the universe.
+ * Counts are cached per node, since identical subtrees are likely to occur
+ * many times within the same tree.
+ */
+auto universe::population() const -> std::uint64_t {
+  auto cache = std::vector<static_vector<std::uint64_t>>{};
+  for (auto level = 0u; level <= _level; ++level) {
+    auto capacity = level == 0 ? _leaves.capacity() : nodes(level).capacity();
+    cache.emplace_back(capacity, std::numeric_limits<std::uint64_t>::max());
+  }
+  auto spilled = std::unordered_map<std::size_t, std::uint64_t>{};
+  return population(_level, _root, cache, spilled);
+}
+
+/**
+ * Compacts the tree into a snapshot: all nodes reachable from the root are
+ * numbered in depth-first Z-order, and copied into contiguous arrays with
+ * their children and futures rewritten to that numbering. Futures that are
+ * not themselves reachable from the root are dropped.
+ */
+auto universe::snapshot() const -> life::snapshot {
+  auto order = std::vector<static_vector<pointer>>{};
+  auto spilled = std::unordered_map<std::size_t, pointer>{};
+  auto origin = std::vector<std::vector<pointer>>(_level + 1);
+  order.emplace_back(_leaves.capacity(), pointer{nullptr});
+  for (auto level = 1u; level <= _level; ++level)
+    order.emplace_back(nodes(level).capacity(), pointer{nullptr});
+  number(_level, _root, order, spilled, origin);
+
+  auto leaves = std::vector<cells>{};
+  leaves.reserve(origin[0].size());
+  for (auto leaf : origin[0])
+    leaves.push_back(fetch(leaf));
+
+  auto levels = std::vector<std::vector<macrocell>>{};
+  for (auto level = 1u; level <= _level; ++level) {
+    auto &compacted = levels.emplace_back();
+    compacted.reserve(origin[level].size());
+    const auto &below = order[level - 1];
+    for (auto node : origin[level]) {
+      compacted.push_back(fetch(level, node));
+      compacted.back().translate([&](pointer child) -> pointer {
+        if (!child.spilled())
+          return below[child.index()];
+        auto numbered = spilled.find(child.index());
+        return numbered == spilled.end() ? nullptr : numbered->second;
+      });
+    }
+  }
+  return life::snapshot{std::move(leaves), std::move(levels), _generation};
+}
+
+/**
+ * Pins the root for readers on other threads, which may traverse it through
+ * the returned handle while this universe keeps advancing. Spilled nodes would
+ * have to be read back from the spill file, and shared ones lie in tables of
+ * another layout, so neither can be pinned.
+ */
+auto universe::pin() -> pinned_root {
+  if (_spill || !_shared.empty())
+    throw std::domain_error{"universe: only nodes in memory can be pinned"};
+
+  auto empty = std::vector<pointer>{};
+  guarded([&] {
+    this->empty(_level);
+    empty.assign(_empty.begin(), _empty.begin() + _level + 1);
+  });
+  auto tables = std::vector<const macrocell *>{};
+  for (auto level = 1u; level <= _level; ++level)
+    tables.push_back(nodes(level).data());
+
+  auto ticket = _readers->pin();
+  _pins.push_back({ticket, _root, _level});
+  retain(_level, _root);
+  return pinned_root{_readers, ticket, std::move(tables), _leaves.data(),
+                     std::move(empty), _root, _level, _generation};
+}
+
+/**
+ * Prepares the layer of a level that is used for the first time in the same
+ * way as the layers already in use.
+ */
+void universe::opened(std::size_t level, layer<macrocell> &layer) {
+  layer.protect(_readers.get());
+  if (_spill)
+    layer.track_access();
+  if (_journal)
+    layer.journal();
+  if (_hashed)
+    layer.hash_contents();
+  if (!_shared.empty()) {
+    layer.share(_shared + "." + std::to_string(level), _shared_capacity);
+    _steps.emplace_back(_shared_capacity, pointer{nullptr});
+  }
+}
+
+/**
+ * Returns a copy of the given node, reading it back from the spill file if
+ * it has been spilled. Empty markers in spilled records are replaced by the
+ * actual empty node, so that empty nodes remain unique. Shared nodes are
+ * copied field by field, since other processes may memoize their results.
+ * The non-constant versions count as an access of the node.
+ */
+auto universe::fetch(std::size_t level, pointer node) -> macrocell {
+  if (!node.spilled() && _shared.empty())
+    return nodes(level)[node];
+  return std::as_const(*this).fetch(level, node);
+}
+
+auto universe::fetch(std::size_t level, pointer node) const -> macrocell {
+  if (!_shared.empty()) {
+    const auto &cell = nodes(level)[node];
+    auto result = macrocell{cell.nw(), cell.ne(), cell.sw(), cell.se()};
+    result.memoize_next(cell.shared_next());
+    return result;
+  }
+  if (!node.spilled())
+    return nodes(level)[node];
+  auto result = _spill->node(node);
+  result.translate([&](pointer below) {
+    return below == spill_file::empty ? _empty[level - 1] : below;
+  });
+  return result;
+}
+
+auto universe::fetch(pointer leaf) -> cells {
+  return leaf.spilled() ? _spill->leaf(leaf) : _leaves[leaf];
+}
+
+auto universe::fetch(pointer leaf) const -> cells {
+  return leaf.spilled() ? _spill->leaf(leaf) : _leaves[leaf];
+}
+
+/**
+ * Exchanges the root, level and generation of the universe with those of the
+ * given parked root. References move along, so none have to be counted.
+ */
+void universe::swap_root(std::size_t parked) noexcept {
+  auto &other = _parked[parked];
+  std::swap(_root, other.root);
+  std::swap(_level, other.level);
+  std::swap(_generation, other.generation);
+}
+
+/**
+ * Replaces the root by an empty one, as in a new universe.
+ */
+void universe::reset_root() {
+  guarded([&] { replace_root(1, empty(1)); });
+  _generation = 0;
+}
+
+/**
+ * Calls <function> with the level of, and a reference to, the root and every
+ * parked root that is in use.
+ */
+template <typename Function> void universe::for_each_root(Function &&function) {
+  if (_root)
+    function(_level, _root);
+  for (auto &parked : _parked)
+    if (parked.root)
+      function(parked.level, parked.root);
+  for (auto &pinned : _pins)
+    function(pinned.level, pinned.root);
+}
+
+/**
+ * Lets go of the roots whose readers have all unpinned.
+ */
+void universe::unpin_released() {
+  auto released = std::remove_if(_pins.begin(), _pins.end(), [&](auto &pin) {
+    return !_readers->pinned(pin.ticket);
+  });
+  for (auto pin = released; pin != _pins.end(); ++pin)
+    release(pin->level, pin->root);
+  _pins.erase(released, _pins.end());
+}
+
+/**
+ * Moves the results set aside for spilled nodes along with the layer of the
+ * given level, which they lie in, to the locations given by <remap>.
+ */
+void universe::relocated(std::size_t level,
+                         const static_vector<pointer> &remap) {
+  if (level + 1 >= _aside.size())
+    return;
+  for (auto &[node, futures] : _aside[level + 1])
+    for (auto *result : {&futures.step, &futures.next})
+      if (*result && !result->spilled())
+        *result = remap[result->index()];
+}
+
+/**
+ * Returns the results set aside for the given spilled node.
+ */
+auto universe::aside(std::size_t level, pointer node) -> spilled_futures & {
+  if (_aside.size() <= level)
+    _aside.resize(level + 1);
+  return _aside[level][node];
+}
+
+/**
+ * Looks up a cell inside a node, with coordinates relative to its top-left.
+ */
+auto universe::get(std::size_t level, pointer node, std::uint64_t x,
+                   std::uint64_t y) const -> bool {
+  for (; level > 0; --level) {
+    auto half = static_cast<std::uint64_t>(side(level) / 2);
+    auto quadrant = (x >= half) + 2 * (y >= half);
+    node = fetch(level, node).quadrants()[quadrant];
+    x %= half, y %= half;
+  }
+  return fetch(node)(x, y);
+}
+
+/**
+ * Returns a copy of the given node in which a single cell is changed.
+ * Only the nodes along the path towards the cell are rebuilt.
+ */
+auto universe::set(std::size_t level, pointer node, std::uint64_t x,
+                   std::uint64_t y, bool alive) -> pointer {
+  if (level == 0) {
+    auto bitmap = fetch(node).bits();
+    auto mask = std::uint64_t{1} << (x + y * cells::columns);
+    return make(cells{alive ? bitmap | mask : bitmap & ~mask});
+  }
+
+  auto half = static_cast<std::uint64_t>(side(level) / 2);
+  auto quadrants = fetch(level, node).quadrants();
+  auto quadrant = (x >= half) + 2 * (y >= half);
+  quadrants[quadrant] =
+      set(level - 1, quadrants[quadrant], x % half, y % half, alive);
+  return make(level, quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+}
+
+/**
+ * Returns a copy of the given node in which the leaf containing the given
+ * cell is replaced by <block>.
+ */
+auto universe::set_block(std::size_t level, pointer node, std::uint64_t x,
+                         std::uint64_t y, cells block) -> pointer {
+  if (level == 0)
+    return make(block);
+
+  auto half = static_cast<std::uint64_t>(side(level) / 2);
+  auto quadrants = fetch(level, node).quadrants();
+  auto quadrant = (x >= half) + 2 * (y >= half);
+  quadrants[quadrant] =
+      set_block(level - 1, quadrants[quadrant], x % half, y % half, block);
+  return make(level, quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+}
+
+/**
+ * Sets the blocks in [first, last), which lie within <node> and are sorted in
+ * the order of the quadtree, with the top-left cell of the node at (x, y).
+ * The blocks of each quadrant are then a contiguous part of the range.
+ */
+auto universe::set_blocks(std::size_t level, pointer node, std::int64_t x,
+                          std::int64_t y,
+                          std::vector<placed_block>::const_iterator first,
+                          std::vector<placed_block>::const_iterator last)
+    -> pointer {
+  if (first == last)
+    return node;
+  if (level == 0)
+    return make(std::prev(last)->contents);
+
+  auto half = side(level) / 2;
+  auto quadrant_of = [&](const placed_block &block) {
+    return (block.x >= x + half) + 2 * (block.y >= y + half);
+  };
+  auto quadrants = fetch(level, node).quadrants();
+  for (auto quadrant = 0; quadrant < 4; ++quadrant) {
+    auto end = std::partition_point(first, last, [&](const auto &block) {
+      return quadrant_of(block) <= quadrant;
+    });
+    quadrants[quadrant] =
+        set_blocks(level - 1, quadrants[quadrant], x + half * (quadrant % 2),
+                   y + half * (quadrant / 2), first, end);
+    first = end;
+  }
+  return make(level, quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+}
+
+/**
+ * Spilled nodes are cached by record number, which is unique across levels.
+ */
+auto universe::population(
+    std::size_t level, pointer node,
+    std::vector<static_vector<std::uint64_t>> &cache,
+    std::unordered_map<std::size_t, std::uint64_t> &spilled) const
+    -> std::uint64_t {
+  auto unknown = std::numeric_limits<std::uint64_t>::max();
+  auto &count = node.spilled() ? spilled.try_emplace(node.index(), unknown)
+                                     .first->second
+                               : cache[level][node.index()];
+  if (count != unknown)
+    return count;
+
+  if (level == 0) {
+    count = fetch(node).population_count();
+  } else {
+    count = 0;
+    const auto cell = fetch(level, node);
+    for (auto quadrant : cell.quadrants())
+      count += population(level - 1, quadrant, cache, spilled);
+  }
+  return count;
+}
+
+/**
+ * Assigns consecutive numbers to all nodes reachable from <node>, in pre-order
+ * depth-first Z-order, keeping track of the mapping in both directions.
+ */
+auto universe::number(std::size_t level, pointer node,
+                      std::vector<static_vector<pointer>> &order,
+                      std::unordered_map<std::size_t, pointer> &spilled,
+                      std::vector<std::vector<pointer>> &origin) const
+    -> pointer {
+  auto &number =
+      node.spilled() ? spilled[node.index()] : order[level][node.index()];
+  if (number)
+    return number;
+
+  number = pointer{origin[level].size()};
+  origin[level].push_back(node);
+  if (level > 0) {
+    const auto cell = fetch(level, node);
+    for (auto quadrant : cell.quadrants())
+      this->number(level - 1, quadrant, order, spilled, origin);
+  }
+  return number;
+}
+
+/**
+ * Advances the inner 6x6 cells of a leaf by a single generation, following
+ * the rule of the universe.
+ */
+auto universe::step_leaf(cells square) const noexcept -> cells {
+  return _rule ? _rule->step(square) : square.step();
+}
+
+/**
+ * Advances the center 4x4 cells of a leaf by two generations, following the
+ * rule of the universe.
+ */
+auto universe::next_leaf(cells square) const noexcept -> cells {
+  return _rule ? _rule->next(square) : square.next();
+}
+
+/**
+ * Counts the evaluation of a node towards the progress of an asynchronous
+ * advance, if any, and bails out if that advance has been cancelled, or if
+ * the deadline of a timed advance has passed.
+ */
+void universe::evaluate() {
+  constexpr auto poll_interval = std::uint32_t{256}; // Nodes per clock read
+  if (_progress) {
+    _progress->_evaluated.fetch_add(1, std::memory_order_relaxed);
+    if (_progress->_cancelled)
+      throw cancellation{};
+  }
+  if (_deadline != std::chrono::steady_clock::time_point::max() &&
+      ++_polls % poll_interval == 0 &&
+      std::chrono::steady_clock::now() >= _deadline)
+    throw cancellation{};
+}
+
+/**
+ * Computes the center of a node of level 1 one, two or four generations into
+ * the future, following the rule of the universe. Its nine subnodes are
+ * combined into four overlapping squares, which are advanced by one or two
+ * generations; for four generations, each subnode is first advanced by two
+ * generations on its own.
+ */
+auto universe::advance_base(pointer node, std::uint64_t generations)
+    -> pointer {
+  auto [n00, n01, n02, n10, n11, n12, n20, n21, n22] = subnodes(1, node);
+  auto r = [&](pointer leaf) {
+    auto square = fetch(leaf);
+    return generations == 4 ? next_leaf(square) : square;
+  };
+  auto q = [&](cells nw, cells ne, cells sw, cells se) {
+    auto quadrant = cells::combine(nw, ne, sw, se);
+    return generations == 1 ? step_leaf(quadrant) : next_leaf(quadrant);
+  };
+  return make(cells::combine(q(r(n00), r(n01), r(n10), r(n11)),
+                             q(r(n01), r(n02), r(n11), r(n12)),
+                             q(r(n10), r(n11), r(n20), r(n21)),
+                             q(r(n11), r(n12), r(n21), r(n22))));
+}
+
+/**
+ * Rebuilds the node recorded under <node> and computes its next() result, as
+ * a computation of its own, retried should some layer overflow.
+ */
+auto universe::next(std::size_t level, life::digest node,
+                    const node_records &records) -> pointer {
+  auto result = pointer{nullptr};
+  guarded([&] {
+    auto built = std::unordered_map<life::digest, pointer>{};
+    result = next(level, rebuild(level, node, records, built));
+  });
+  return result;
+}
+
+/**
+ * As step(), advancing by 2^exponent generations, but only correct within
+ * <window>, with the top-left cell of the node at (x, y). Quadrants of the
+ * result outside the window are left empty, and so are the parts of the
+ * first half of the computation they alone depend on. Results that lie
+ * within the window entirely are computed, and memoized, as usual, but
+ * partial ones depend on the window, so they are not memoized.
+ */
+auto universe::step_within(std::size_t level, pointer node, std::int64_t x,
+                           std::int64_t y, std::size_t exponent,
+                           const rectangle &window) -> pointer {
+  const auto quarter = side(level) / 4;
+  if (!overlaps(window, x + quarter, y + quarter, 2 * quarter))
+    return empty(level - 1);
+  if (level == 1 || covers(window, x + quarter, y + quarter, 2 * quarter))
+    return exponent == level + 1 ? next(level, node) : step(level, node);
+
+  const auto down = level - 1;
+  const auto subnodes = this->subnodes(level, node);
+  auto needed = std::array<bool, 4>{};
+  for (auto i = 0u; i < 4; ++i)
+    needed[i] = overlaps(window, x + (i % 2 + 1) * quarter,
+                         y + (i / 2 + 1) * quarter, quarter);
+
+  // Without a first half, the nine subnodes are only centered.
+  const auto halved = exponent == level + 1;
+  const auto inner_exponent = halved ? exponent - 1 : exponent;
+  const auto inner_window =
+      halved ? grown(window, std::int64_t{1} << inner_exponent) : window;
+  auto inner = std::array<pointer, 9>{};
+  for (auto i = 0u; i < 9; ++i) {
+    const auto row = i / 3, column = i % 3;
+    auto used = false;
+    for (auto j = 0u; j < 4; ++j)
+      used |= needed[j] && row - j / 2 <= 1 && column - j % 2 <= 1;
+    if (!used)
+      inner[i] = empty(down - 1);
+    else if (halved)
+      inner[i] = step_within(down, subnodes[i], x + column * quarter,
+                             y + row * quarter, inner_exponent, inner_window);
+    else
+      inner[i] = center(down, subnodes[i]);
+  }
+
+  auto result = std::array<pointer, 4>{};
+  for (auto i = 0u; i < 4; ++i) {
+    const auto row = i / 2, column = i % 2, at = 3 * row + column;
+    if (!needed[i]) {
+      result[i] = empty(down - 1);
+      continue;
+    }
+    const auto quadrant =
+        make(down, inner[at], inner[at + 1], inner[at + 3], inner[at + 4]);
+    result[i] = step_within(down, quadrant, x + column * quarter + quarter / 2,
+                            y + row * quarter + quarter / 2, inner_exponent,
+                            window);
+  }
+  return make(down, result[0], result[1], result[2], result[3]);
+}
+
+/**
+ * Returns the memoized next() result of <node>, if any, looking at the
+ * results set aside before reading the record of a spilled node.
+ */
+auto universe::memoized_next(std::size_t level, pointer node) -> pointer {
+  if (node.spilled() && level < _aside.size()) {
+    auto futures = _aside[level].find(node);
+    if (futures != _aside[level].end() && futures->second.next)
+      return futures->second.next;
+  }
+  return fetch(level, node).next();
+}
+
+/**
+ * Memoizes <result> as the next() result of <node>, returning it.
+ * Spilled records are immutable, so their results are set aside instead.
+ * Shared nodes may be read by other processes meanwhile, so their results are
+ * published atomically.
+ */
+auto universe::memoize_next(std::size_t level, pointer node, pointer result)
+    -> pointer {
+  if (node.spilled()) {
+    aside(level, node).next = result;
+  } else {
+    if (_shared.empty())
+      nodes(level)[node].memoize_next(result);
+    else
+      nodes(level)[node].memoize_shared_next(result);
+    nodes(level).mark_dirty(node);
+    retain(level - 1, result);
+    remember(level, node, result);
+  }
+  return result;
+}
+
+/**
+ * As above, but for the step() result of <node>. Shared nodes keep their
+ * step() results in this process only.
+ */
+auto universe::memoize_step(std::size_t level, pointer node, pointer result)
+    -> pointer {
+  if (!_shared.empty()) {
+    _steps[level - 1][node.index()] = result;
+  } else if (node.spilled()) {
+    aside(level, node).step = result;
+  } else {
+    nodes(level)[node].memoize_step(result);
+    retain(level - 1, result);
+    remember(level, node, result);
+  }
+  return result;
+}
+
+/**
+ * Returns the memoized step() result of <node>, if any.
+ */
+auto universe::memoized_step(std::size_t level, pointer node) -> pointer {
+  if (!_shared.empty())
+    return _steps[level - 1][node.index()];
+  if (!node.spilled())
+    return nodes(level)[node].step();
+  if (level < _aside.size()) {
+    auto futures = _aside[level].find(node);
+    if (futures != _aside[level].end())
+      return futures->second.step;
+  }
+  return nullptr;
+}
+
+/**
+ * Forgets all memoized step() results when the exponent of step() changes.
+ */
+void universe::forget_steps() {
+  if (_shared.empty()) {
+    hashlife_tree::forget_steps();
+    for (auto &level : _aside)
+      for (auto &[node, futures] : level)
+        futures.step = nullptr;
+    return;
+  }
+  for (auto &steps : _steps)
+    steps.fill(nullptr);
+}
+
+/**
+ * Records a tenured node whose memoized future lies in the nursery. Since
+ * tenured nodes are never scanned as a whole, this is the only way in which
+ * such a future is found, and kept alive, by the next collection.
+ */
+void universe::remember(std::size_t level, pointer node, pointer result) {
+  if (!node.nursery() && result.nursery())
+    _remembered.emplace_back(level, node);
+}
+
+/**
+ * Returns the identifier of <node> in the checkpoint log, writing it first if
+ * it has not been logged yet. Quadrants are logged before their parent, and a
+ * newly logged node brings its memoized next() result along.
+ */
+auto universe::logged(std::size_t level, pointer node) -> std::uint32_t {
+  if (level == 0) {
+    auto id = _leaves.id(node);
+    if (id == _leaves.unlogged) {
+      id = _journal->append(_leaves[node]);
+      _leaves.identify(node, id);
+    }
+    return id;
+  }
+
+  if (auto id = nodes(level).id(node); id != nodes(level).unlogged)
+    return id;
+  const auto cell = nodes(level)[node];
+  auto children = std::array<std::uint32_t, 4>{};
+  for (auto quadrant = 0u; quadrant < 4; ++quadrant)
+    children[quadrant] = logged(level - 1, cell.quadrants()[quadrant]);
+  auto id = _journal->append(level, children);
+  nodes(level).identify(node, id);
+  if (cell.next())
+    _journal->link(level, id, logged(level - 1, cell.next()));
+  return id;
+}
+
+/**
+ * Keeps the digest of every node from now on, for a result cache or other
+ * shards to refer to nodes by.
+ */
+void universe::hash_contents() {
+  _hashed = true;
+  _leaves.hash_contents();
+  for (auto &layer : _nodes)
+    layer.hash_contents();
+}
+
+/**
+ * Returns the digest of <node>, computing it from the digests of its quadrants
+ * if it is not known yet.
+ */
+auto universe::digest(std::size_t level, pointer node) -> life::digest {
+  if (level == 0) {
+    auto digest = _leaves.digest(node);
+    if (!digest) {
+      digest = life::digest::of(_leaves[node]);
+      _leaves.set_digest(node, digest);
+    }
+    return digest;
+  }
+
+  if (auto digest = nodes(level).digest(node))
+    return digest;
+  const auto cell = nodes(level)[node];
+  auto quadrants = std::array<life::digest, 4>{};
+  for (auto quadrant = 0u; quadrant < 4; ++quadrant)
+    quadrants[quadrant] = digest(level - 1, cell.quadrants()[quadrant]);
+  auto digest = life::digest::of(quadrants);
+  nodes(level).set_digest(node, digest);
+  return digest;
+}
+
+/**
+ * Stores the contents of <node> in the result cache, quadrants first.
+ * Subtrees that are stored already are skipped entirely.
+ */
+void universe::store(std::size_t level, pointer node) {
+  auto key = digest(level, node);
+  if (_results->contains(key))
+    return;
+  if (level == 0) {
+    _results->store(key, fetch(node));
+    return;
+  }
+
+  const auto cell = fetch(level, node);
+  auto quadrants = std::array<life::digest, 4>{};
+  for (auto quadrant = 0u; quadrant < 4; ++quadrant) {
+    store(level - 1, cell.quadrants()[quadrant]);
+    quadrants[quadrant] = digest(level - 1, cell.quadrants()[quadrant]);
+  }
+  _results->store(key, quadrants);
+}
+
+/**
+ * Recreates the node recorded under <node> in <records>. Nodes rebuilt so
+ * far are kept in <built>, so that shared subtrees are only visited once.
+ */
+auto universe::rebuild(std::size_t level, life::digest node,
+                       const node_records &records,
+                       std::unordered_map<life::digest, pointer> &built)
+    -> pointer {
+  if (auto found = built.find(node); found != built.end())
+    return found->second;
+
+  auto result = pointer{nullptr};
+  if (level == 0) {
+    result = make(records.leaf(node));
+    _leaves.set_digest(result, node);
+  } else {
+    const auto &quadrants = records.quadrants(node);
+    auto nw = rebuild(level - 1, quadrants[0], records, built),
+         ne = rebuild(level - 1, quadrants[1], records, built),
+         sw = rebuild(level - 1, quadrants[2], records, built),
+         se = rebuild(level - 1, quadrants[3], records, built);
+    result = make(level, nw, ne, sw, se);
+    nodes(level).set_digest(result, node);
+  }
+  built.emplace(node, result);
+  return result;
+}
+
+/**
+ * Looks up the result of advancing <node> by 2^exponent generations in the
+ * result cache, returning the null pointer if it is not there.
+ */
+auto universe::recall(std::size_t level, pointer node, std::size_t exponent)
+    -> pointer {
+  if (!_results || level < _cached_level)
+    return nullptr;
+  auto result = _results->find(digest(level, node), exponent);
+  if (!result)
+    return nullptr;
+  auto built = std::unordered_map<life::digest, pointer>{};
+  return rebuild(level - 1, result, _results->records(), built);
+}
+
+/**
+ * Adds a freshly computed result to the result cache, if any.
+ */
+void universe::record(std::size_t level, pointer node, std::size_t exponent,
+                      pointer result) {
+  if (!_results || level < _cached_level)
+    return;
+  store(level - 1, result);
+  _results->insert(digest(level, node), exponent, digest(level - 1, result));
+}
+
+/**
+ * Appends the records of <node> and of all nodes below it to <message>,
+ * skipping the subtrees of nodes that are <known> to the receiver already,
+ * which the receiver then knows as well.
+ */
+void universe::encode(std::size_t level, pointer node,
+                      std::unordered_set<life::digest> &known,
+                      shard_message &message) {
+  auto key = digest(level, node);
+  if (!known.insert(key).second)
+    return;
+  if (level == 0) {
+    message.record(key, fetch(node));
+    return;
+  }
+
+  const auto cell = fetch(level, node);
+  auto quadrants = std::array<life::digest, 4>{};
+  for (auto quadrant = 0u; quadrant < 4; ++quadrant) {
+    encode(level - 1, cell.quadrants()[quadrant], known, message);
+    quadrants[quadrant] = digest(level - 1, cell.quadrants()[quadrant]);
+  }
+  message.record(key, quadrants);
+}
+
+/**
+ * Has the next() results of those <nodes> that other shards own computed by
+ * their owners, in one batch per shard, and memoizes them. Results that some
+ * shard sent before are rebuilt right away, without asking again. Once the
+ * results are rebuilt, the records they were rebuilt from may be dropped.
+ */
+void universe::dispatch(std::size_t level,
+                        std::initializer_list<pointer> nodes) {
+  if (!_shards || level < _distributed_level)
+    return;
+
+  auto batches = _shards->batches();
+  for (auto node : nodes) {
+    if (fetch(level, node).next())
+      continue;
+    auto key = digest(level, node);
+    auto owner = _shards->owner(key);
+    if (owner == 0 || _shards->future(key))
+      continue;
+    encode(level, node, _shards->known(owner), batches[owner]);
+    batches[owner].request(level, key);
+  }
+  _shards->exchange(batches);
+
+  auto built = std::unordered_map<life::digest, pointer>{};
+  for (auto node : nodes) {
+    if (fetch(level, node).next())
+      continue;
+    if (auto result = _shards->future(digest(level, node)))
+      memoize_next(level, node,
+                   rebuild(level - 1, result, _shards->records(), built));
+  }
+  _shards->trim();
+}
+
+/**
+ * Marks <node> and all nursery nodes it refers to, both as children and as
+ * memoized futures, as survivors. Tenured nodes only ever have tenured
+ * children, so the traversal stops at them.
+ */
+void universe::mark(std::size_t level, pointer node,
+                    std::vector<std::vector<pointer>> &survivors,
+                    std::vector<std::vector<bool>> &marked) const {
+  if (!node.nursery() || marked[level][node.index()])
+    return;
+  marked[level][node.index()] = true;
+  survivors[level].push_back(node);
+  if (level == 0)
+    return;
+
+  const auto &cell = nodes(level)[node];
+  for (auto quadrant : cell.quadrants())
+    mark(level - 1, quadrant, survivors, marked);
+  for (auto result : {cell.step(), cell.next()})
+    if (result)
+      mark(level - 1, result, survivors, marked);
+}
+
+/**
+ * Promotes the nursery nodes that survived the last computation into the
+ * tenured tables, and resets the nurseries. Survivors are the nodes reachable
+ * from the roots, the empty nodes, and the remembered futures of tenured nodes.
+ * If the computation was <interrupted>, the nodes it already evaluated are
+ * only reachable from its lost recursion, so every nursery node with a
+ * memoized result survives as well.
+ * Levels are promoted bottom-up, so that the pointers held by each level can
+ * be translated using the promotion of the level below. Should a tenured
+ * table be rehashed to make room, all tenured tables above it are relocated
+ * along the way.
+ */
+void universe::collect(bool interrupted) {
+  auto survivors = std::vector<std::vector<pointer>>(_nodes.size() + 1);
+  auto marked = std::vector<std::vector<bool>>{};
+  marked.emplace_back(_leaves.nursery_capacity(), false);
+  for (const auto &layer : _nodes)
+    marked.emplace_back(layer.nursery_capacity(), false);
+
+  for_each_root([&](std::size_t level, pointer &root) {
+    mark(level, root, survivors, marked);
+  });
+  for (auto level = 0u; level < _empty.size(); ++level)
+    mark(level, _empty[level], survivors, marked);
+  for (auto [level, node] : _remembered) {
+    const auto &cell = nodes(level)[node];
+    for (auto result : {cell.step(), cell.next()})
+      if (result)
+        mark(level - 1, result, survivors, marked);
+  }
+  for (auto level = 1u; interrupted && level <= _nodes.size(); ++level)
+    nodes(level).for_each_young([&](pointer node, const macrocell &cell) {
+      if (cell.step() || cell.next())
+        mark(level, node, survivors, marked);
+    });
+
+  auto keep = [](auto &) { return true; };
+  auto promotions = std::vector<promotion>{};
+  promotions.push_back(_leaves.promote(survivors[0], false, keep));
+  for (auto level = 1u; level <= _nodes.size(); ++level) {
+    const auto &below = promotions.back();
+    auto translate = [&below](macrocell &node) {
+      node.translate(below);
+      return true;
+    };
+    auto relocate = !below.relocated.empty();
+    auto promoted = nodes(level).promote(survivors[level], relocate, translate);
+    promotions.push_back(std::move(promoted));
+  }
+
+  for_each_root([&promotions](std::size_t level, pointer &root) {
+    root = promotions[level](root);
+  });
+  for (auto level = 0u; level < _empty.size(); ++level)
+    _empty[level] = promotions[level](_empty[level]);
+  for (auto [level, node] : _remembered) {
+    // Rehashed tables have been translated as a whole already
+    if (promotions[level].relocated.empty())
+      nodes(level)[node].translate(promotions[level - 1]);
+  }
+
+  _remembered.clear();
+  _leaves.reset_nursery();
+  for (auto &layer : _nodes)
+    layer.reset_nursery();
+}
+
+/**
+ * Cleans up after a jump that was cancelled or ran out of time. Its recursion
+ * is lost, but the results it computed are kept, so that the next attempt at
+ * the jump continues from them instead of starting over.
+ */
+void universe::interrupted() {
+  guarded([&] {
+    if (_mode == lifetime::generational)
+      collect(true);
+  });
+}
+
+/**
+ * Runs <function> as hashlife_tree::guarded() does, once the roots whose
+ * readers have all let go are released.
+ */
+template <typename Function> void universe::guarded(Function &&function) {
+  unpin_released();
+  hashlife_tree::guarded(std::forward<Function>(function));
+}
+
+/**
+ * Ends a computation: if nodes are generational, the survivors are promoted.
+ */
+void universe::completed() {
+  if (_mode == lifetime::generational)
+    collect();
+  tick();
+}
+
+/**
+ * Makes room after an attempt at a computation overflowed a layer, returning
+ * whether another attempt is worthwhile. If nodes are counted, the first
+ * overflow reclaims all unreferenced nodes, so that layers only grow when the
+ * space is actually needed. If spilling is enabled, the first overflow spills
+ * cold nodes instead. If nodes are generational, the survivors are promoted
+ * first, so that results computed by the failed attempt are kept. Shared
+ * layers cannot grow at all.
+ */
+auto universe::recover(std::size_t attempt) -> bool {
+  if (_mode == lifetime::generational) {
+    collect();
+  } else if (attempt == 0 && _mode == lifetime::counted) {
+    reclaim();
+    return true;
+  } else if (attempt == 0 && _spill && spill(_spill_age) != 0) {
+    return true;
+  }
+  return _shared.empty() && grow();
+}
+
+/**
+ * Ends the current epoch of access tracking, if any.
+ */
+void universe::tick() noexcept {
+  _leaves.tick();
+  for (auto &layer : _nodes)
+    layer.tick();
+}
+
@@ -0,0 +1,122 @@
+/**
+ * Hashlife
+ * Many universes sharing a single store of nodes and memoized results.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "universe_pool.hpp"
+
+#include <utility>
+
+#include "snapshot.hpp"
+
+using namespace life;
+
+universe_pool::universe_pool(lifetime mode) : _store{mode} {}
+
+/**
+ * Adds a new, empty universe to the pool. Slots of destroyed handles are
+ * reused, so that the number of parked roots stays bounded.
+ */
+auto universe_pool::create() -> handle {
+  auto slot = _store._parked.size();
+  if (_free.empty()) {
+    _store._parked.push_back({nullptr, 1, 0});
+  } else {
+    slot = _free.back();
+    _free.pop_back();
+    _store._parked[slot] = {nullptr, 1, 0};
+  }
+
+  try {
+    with(slot, [](universe &store) { store.reset_root(); });
+  } catch (...) {
+    _free.push_back(slot);
+    throw;
+  }
+  return handle{*this, slot};
+}
+
+/**
+ * Frees at most <budget> nodes that are no longer used by any universe of the
+ * pool, if nodes are counted.
+ */
+auto universe_pool::reclaim(std::size_t budget) -> std::size_t {
+  return _store.reclaim(budget);
+}
+
+auto universe_pool::statistics() const -> std::vector<layer_statistics> {
+  return _store.statistics();
+}
+
+/**
+ * Gives up the root of <slot>, and makes the slot available for reuse.
+ */
+void universe_pool::release(std::size_t slot) {
+  auto &parked = _store._parked[slot];
+  if (parked.root)
+    _store.release(parked.level, parked.root);
+  parked.root = nullptr;
+  _free.push_back(slot);
+}
+
+universe_pool::handle::handle(handle &&other) noexcept
+    : _pool{std::exchange(other._pool, nullptr)}, _slot{other._slot} {}
+
+auto universe_pool::handle::operator=(handle &&other) noexcept -> handle & {
+  if (this != &other) {
+    if (_pool)
+      _pool->release(_slot);
+    _pool = std::exchange(other._pool, nullptr);
+    _slot = other._slot;
+  }
+  return *this;
+}
+
+universe_pool::handle::~handle() {
+  if (_pool)
+    _pool->release(_slot);
+}
+
+auto universe_pool::handle::get(std::int64_t x, std::int64_t y) const
+    -> bool {
+  return _pool->with(_slot, [&](universe &store) { return store.get(x, y); });
+}
+
+void universe_pool::handle::set(std::int64_t x, std::int64_t y, bool alive) {
+  _pool->with(_slot, [&](universe &store) { store.set(x, y, alive); });
+}
+
+void universe_pool::handle::advance(std::uint64_t generations) {
+  _pool->with(_slot, [&](universe &store) { store.advance(generations); });
+}
+
+auto universe_pool::handle::generation() const -> std::uint64_t {
+  return _pool->_store._parked[_slot].generation;
+}
+
+auto universe_pool::handle::level() const -> std::size_t {
+  return _pool->_store._parked[_slot].level;
+}
+
+auto universe_pool::handle::population() const -> std::uint64_t {
+  return _pool->with(_slot,
+                     [](universe &store) { return store.population(); });
+}
+
+auto universe_pool::handle::snapshot() const -> life::snapshot {
+  return _pool->with(_slot, [](universe &store) { return store.snapshot(); });
+}
@@ -0,0 +1,88 @@
+/**
+ * Hashlife
+ * Patterns and reference implementations shared by the tests.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "universe.hpp"
+
+namespace life::testing {
+using coordinates = std::set<std::pair<std::int64_t, std::int64_t>>;
+
+/**
+ * Straightforward implementation of the life rules, to compare against.
+ */
+inline auto reference_step(const coordinates &alive) -> coordinates {
+  auto counts = std::map<std::pair<std::int64_t, std::int64_t>, int>{};
+  for (auto [x, y] : alive)
+    for (auto dx = -1; dx <= 1; ++dx)
+      for (auto dy = -1; dy <= 1; ++dy)
+        if (dx != 0 || dy != 0)
+          ++counts[{x + dx, y + dy}];
+
+  auto result = coordinates{};
+  for (auto [cell, count] : counts)
+    if (count == 3 || (count == 2 && alive.count(cell)))
+      result.insert(cell);
+  return result;
+}
+
+/**
+ * Fills a width x height box, with its top-left cell at (left, top), with
+ * living cells at the given density.
+ */
+inline auto random_soup(std::int64_t left, std::int64_t top,
+                        std::int64_t width, std::int64_t height, unsigned seed,
+                        double density = 0.4) -> coordinates {
+  auto engine = std::mt19937{seed};
+  auto coin = std::bernoulli_distribution{density};
+  auto result = coordinates{};
+  for (auto y = top; y < top + height; ++y)
+    for (auto x = left; x < left + width; ++x)
+      if (coin(engine))
+        result.insert({x, y});
+  return result;
+}
+
+/**
+ * Fills a square of the given size around the origin.
+ */
+inline auto random_soup(std::int64_t size, unsigned seed) -> coordinates {
+  return random_soup(-size / 2, -size / 2, size, size, seed);
+}
+
+/**
+ * Lists the living cells of a collection of blocks.
+ */
+inline auto living(const std::vector<placed_block> &blocks) -> coordinates {
+  auto result = coordinates{};
+  for (const auto &block : blocks)
+    for (auto y = 0; y < cells::rows; ++y)
+      for (auto x = 0; x < cells::columns; ++x)
+        if (block.contents(x, y))
+          result.insert({block.x + x, block.y + y});
+  return result;
+}
+} // namespace life::testing
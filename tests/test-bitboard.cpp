@@ -0,0 +1,139 @@
+/**
+ * Hashlife
+ * Tests for dense, bounded boards.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "bitboard.hpp"
+#include "helpers.hpp"
+#include "thread_pool.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace life;
+using namespace life::testing;
+
+namespace {
+/**
+ * Straightforward implementation of the life rules on a bounded grid.
+ */
+auto reference_step(const std::vector<std::vector<bool>> &alive,
+                    boundary edges) -> std::vector<std::vector<bool>> {
+  const auto height = static_cast<int>(alive.size());
+  const auto width = static_cast<int>(alive.front().size());
+  auto result = alive;
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      auto count = 0;
+      for (auto dy = -1; dy <= 1; ++dy) {
+        for (auto dx = -1; dx <= 1; ++dx) {
+          auto nx = x + dx, ny = y + dy;
+          if (edges == boundary::torus)
+            nx = (nx + width) % width, ny = (ny + height) % height;
+          else if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+            continue;
+          count += (dx != 0 || dy != 0) && alive[ny][nx];
+        }
+      }
+      result[y][x] = count == 3 || (count == 2 && alive[y][x]);
+    }
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Boards must consist of whole words", "[bitboard]") {
+  REQUIRE_THROWS_AS(bitboard(60, 8), std::domain_error);
+  REQUIRE_THROWS_AS(bitboard(64, 12), std::domain_error);
+  REQUIRE_THROWS_AS(bitboard(64, 8).get(64, 0), std::out_of_range);
+}
+
+TEST_CASE("Boards follow the life rules", "[bitboard]") {
+  for (auto edges : {boundary::torus, boundary::dead}) {
+    for (auto threads : {1u, 3u}) {
+      auto board = bitboard{128, 24, edges};
+      auto alive = std::vector<std::vector<bool>>(24, std::vector<bool>(128));
+      for (auto [x, y] : random_soup(0, 0, 128, 24, 19))
+        board.set(x, y), alive[y][x] = true;
+
+      for (auto generation = 0; generation < 40; ++generation) {
+        board.step(threads);
+        alive = reference_step(alive, edges);
+        for (auto y = 0u; y < 24; ++y)
+          for (auto x = 0u; x < 128; ++x)
+            REQUIRE(board.get(x, y) == alive[y][x]);
+      }
+      REQUIRE(board.generation() == 40);
+    }
+  }
+}
+
+TEST_CASE("Gliders wrap around tori", "[bitboard]") {
+  auto board = bitboard{64, 64};
+  for (auto [x, y] : {std::pair{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}})
+    board.set((x + 62) % 64, (y + 62) % 64);
+  auto before = bitboard{board};
+
+  board.advance(4 * 64, 2);
+  REQUIRE(board.population() == 5);
+  for (auto y = 0u; y < 64; ++y)
+    for (auto x = 0u; x < 64; ++x)
+      REQUIRE(board.get(x, y) == before.get(x, y));
+}
+
+TEST_CASE("Boards convert to and from universes", "[bitboard]") {
+  auto life = universe{};
+  for (auto [x, y] : random_soup(16, 23))
+    life.set(x, y);
+
+  auto board = bitboard::from(life, -64, -64, 128, 128, boundary::dead);
+  REQUIRE(board.population() == life.population());
+  REQUIRE(board.get(64 - 8, 64 - 8) == life.get(-8, -8));
+
+  board.advance(30);
+  life.advance(30);
+  auto copy = universe{};
+  board.write_to(copy, -64, -64);
+  REQUIRE(copy.population() == life.population());
+  for (auto y = -64; y < 64; ++y)
+    for (auto x = -64; x < 64; ++x)
+      REQUIRE(copy.get(x, y) == life.get(x, y));
+}
+
+TEST_CASE("Boards step on pinned thread pools", "[bitboard]") {
+  auto pool = thread_pool{3, thread_pool::spread(3)};
+  auto board = bitboard{128, 16}, reference = bitboard{128, 16};
+  for (auto [x, y] : random_soup(0, 0, 128, 16, 29))
+    board.set(x, y), reference.set(x, y);
+
+  board.place(pool);
+  REQUIRE(board.population() == reference.population());
+  board.advance(30, pool);
+  reference.advance(30);
+  for (auto y = 0u; y < 16; ++y)
+    for (auto x = 0u; x < 128; ++x)
+      REQUIRE(board.get(x, y) == reference.get(x, y));
+
+  auto wide = thread_pool{20};
+  board.step(wide);
+  reference.step();
+  REQUIRE(board.population() == reference.population());
+}
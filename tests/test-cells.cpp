@@ -89,4 +89,15 @@ TEST_CASE("Cell square combinations", "[cell-combine]") {
   REQUIRE(filled == cells::center(filled, filled, filled, filled));
   REQUIRE(filled == cells::horizontal(filled, filled));
   REQUIRE(filled == cells::vertical(filled, filled));
+
+  auto east = cells{0xf0f0f0f0f0f0f0f0ull};
+  auto south = cells{0xffffffff00000000ull};
+  auto empty = cells::empty_square();
+  REQUIRE(cells::horizontal(east, empty) == cells{0x0f0f0f0f0f0f0f0full});
+  REQUIRE(cells::vertical(south, empty) == cells{0x00000000ffffffffull});
+  REQUIRE(cells::center(filled, empty, empty, empty) ==
+          cells{0x000000000f0f0f0full});
+  REQUIRE(cells::combine(filled, filled, filled, filled) == filled);
+  REQUIRE(cells::combine(cells::block(), empty, empty, empty) ==
+          cells{0x0000000000060600ull});
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+/**
+ * Hashlife
+ * Tests for the append-only checkpoint log.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "checkpoint_log.hpp"
+#include "snapshot.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace life;
+
+TEST_CASE("Checkpoint logs replay up to their last checkpoint",
+          "[checkpoint_log]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.log";
+  auto log = checkpoint_log{path.string()};
+
+  SECTION("Incomplete logs hold no checkpoint") {
+    REQUIRE_THROWS_AS(checkpoint_log::replay(path.string()),
+                      std::domain_error);
+    log.append(cells::glider());
+    REQUIRE_THROWS_AS(checkpoint_log::replay(path.string()),
+                      std::domain_error);
+  }
+
+  SECTION("Children must be logged first") {
+    REQUIRE_THROWS_AS(log.append(1, {0, 0, 0, 0}), std::domain_error);
+    log.append(cells::glider());
+    REQUIRE_THROWS_AS(log.append(0, {0, 0, 0, 0}), std::domain_error);
+  }
+
+  SECTION("Records with unknown children end the log") {
+    auto glider = log.append(cells::glider());
+    auto root = log.append(1, {glider, glider, glider, glider});
+    log.commit(1, root, 4);
+
+    auto file = std::ofstream{path, std::ios::binary | std::ios::app};
+    auto put = [&file](auto word) {
+      file.write(reinterpret_cast<const char *>(&word), sizeof(word));
+    };
+    file.put('N');
+    for (auto word : {1u, 0u, 0u, 0u, 99u}) // Level, then children
+      put(std::uint32_t{word});
+    file.put('R');
+    put(std::uint32_t{1}), put(std::uint32_t{1}), put(std::uint64_t{8});
+    file.close();
+
+    auto replayed = checkpoint_log::replay(path.string());
+    REQUIRE(replayed.generation() == 4);
+    REQUIRE(replayed.population() == 4 * cells::glider().population_count());
+  }
+
+  SECTION("Torn checkpoints are ignored") {
+    auto glider = log.append(cells::glider());
+    auto block = log.append(cells::block());
+    auto root = log.append(1, {glider, block, block, glider});
+    log.commit(1, root, 4);
+
+    auto empty = log.append(cells::empty_square());
+    auto other = log.append(1, {empty, empty, empty, glider});
+    log.link(1, root, block);
+    log.append(2, {other, other, root, other}); // Never committed
+
+    auto replayed = checkpoint_log::replay(path.string());
+    REQUIRE(log.checkpoints() == 1);
+    REQUIRE(replayed.level() == 1);
+    REQUIRE(replayed.generation() == 4);
+    REQUIRE(replayed.leaves().size() == 2);
+    REQUIRE(replayed.population() ==
+            2 * (cells::glider().population_count() +
+                 cells::block().population_count()));
+    REQUIRE(!replayed.nodes(1).front().next());
+  }
+
+  SECTION("Links apply once committed") {
+    auto glider = log.append(cells::glider());
+    auto block = log.append(cells::block());
+    auto root = log.append(1, {glider, glider, glider, glider});
+    log.link(1, root, block);
+    log.commit(1, root, 0);
+
+    auto replayed = checkpoint_log::replay(path.string());
+    const auto &node = replayed.nodes(1).front();
+    REQUIRE(node.next());
+    REQUIRE(replayed.leaves()[node.next().index()] == cells::block());
+  }
+
+  std::filesystem::remove(path);
+}
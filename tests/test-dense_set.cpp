@@ -80,6 +80,42 @@ TEST_CASE("Hash-set works as expected") {
     REQUIRE(set.size() == test.size());
   }
 
+  SECTION("Erasing shall not affect other elements") {
+    auto first = set.emplace(10).first;
+    set.emplace(15);
+    set.erase(first - set.begin());
+
+    REQUIRE(set.size() == 1);
+    REQUIRE(set.tombstones() == 1);
+    REQUIRE(set.find(10) == set.end());
+    REQUIRE(set.find(15) != set.end());
+
+    set.emplace(10);
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.tombstones() == 0);
+  }
+
+  SECTION("Clearing shall forget all elements, also over many epochs") {
+    for (auto round = 0; round < 300; ++round) {
+      set.emplace(round);
+      set.emplace(round + 1);
+      set.clear();
+      REQUIRE(set.size() == 0);
+      REQUIRE(set.find(round) == set.end());
+      REQUIRE(!set.filled(0));
+    }
+    REQUIRE(set.emplace(7).second);
+    REQUIRE(set.find(7) != set.end());
+  }
+
+  SECTION("A custom probe limit shall allow insertion past the default one") {
+    auto limited = dense_set<int>{8, 1};
+    limited.emplace(0);
+    REQUIRE(!limited.emplace(8).second);
+    REQUIRE(limited.insert(8, limited.capacity()).second);
+    REQUIRE(limited.find(8) != limited.end());
+  }
+
   SECTION("Iterator difference shall represent pointer distance") {
     REQUIRE(set.end() - set.begin() == set.capacity());
   }
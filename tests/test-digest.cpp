@@ -0,0 +1,53 @@
+/**
+ * Hashlife
+ * Tests for the content hashes of nodes.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "digest.hpp"
+
+#include <unordered_set>
+
+using namespace life;
+
+TEST_CASE("Digests identify contents", "[digest]") {
+  auto glider = digest::of(cells::glider());
+  auto block = digest::of(cells::block());
+  auto empty = digest::of(cells::empty_square());
+
+  SECTION("Digests are known and deterministic") {
+    REQUIRE(!digest{});
+    REQUIRE(glider);
+    REQUIRE(empty);
+    REQUIRE(glider == digest::of(cells::glider()));
+    REQUIRE(digest::of({glider, block, empty, empty}) ==
+            digest::of({glider, block, empty, empty}));
+  }
+
+  SECTION("Different contents have different digests") {
+    REQUIRE(glider != block);
+    REQUIRE(digest::of({glider, block, empty, empty}) !=
+            digest::of({block, glider, empty, empty}));
+    REQUIRE(digest::of({empty, empty, empty, empty}) != empty);
+
+    auto seen = std::unordered_set<digest>{};
+    for (auto bits = std::uint64_t{0}; bits < 4096; ++bits)
+      seen.insert(digest::of(cells{bits * 0x9e3779b97f4a7c15}));
+    REQUIRE(seen.size() == 4096);
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * Hashlife
+ * Tests for epoch-based reclamation.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "epochs.hpp"
+
+#include <memory>
+
+using namespace life;
+
+TEST_CASE("Retired memory outlives the readers that may see it",
+          "[epochs]") {
+  auto readers = epochs{};
+  auto garbage = std::make_shared<int>(42);
+  auto observer = std::weak_ptr<int>{garbage};
+
+  SECTION("Without readers, memory is freed right away") {
+    readers.retire(std::move(garbage));
+    REQUIRE(observer.expired());
+    REQUIRE(readers.retired() == 0);
+  }
+
+  SECTION("Memory is kept until earlier readers unpin") {
+    auto early = readers.pin();
+    readers.retire(std::move(garbage));
+    auto late = readers.pin();
+    REQUIRE(readers.readers() == 2);
+    REQUIRE(!observer.expired());
+
+    auto later_garbage = std::make_shared<int>(43);
+    auto later_observer = std::weak_ptr<int>{later_garbage};
+    readers.retire(std::move(later_garbage));
+    REQUIRE(readers.retired() == 2);
+
+    readers.unpin(early);
+    REQUIRE(observer.expired());
+    REQUIRE(!later_observer.expired());
+    REQUIRE(readers.pinned(late));
+    REQUIRE(!readers.pinned(early));
+
+    readers.unpin(late);
+    REQUIRE(later_observer.expired());
+    REQUIRE(readers.retired() == 0);
+  }
+
+  SECTION("Retiring starts a new epoch") {
+    auto epoch = readers.epoch();
+    readers.retire(std::move(garbage));
+    REQUIRE(readers.epoch() == epoch + 1);
+  }
+}
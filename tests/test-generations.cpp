@@ -0,0 +1,110 @@
+/**
+ * Hashlife
+ * Tests for multi-state cell squares and Generations rules.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "generations.hpp"
+
+#include <random>
+#include <stdexcept>
+
+using namespace life;
+
+namespace {
+/**
+ * Straightforward implementation of a Generations rule on the inner 6x6 cells
+ * of a square.
+ */
+auto reference_step(const state_cells &square, const generations_rule &rule)
+    -> state_cells {
+  auto result = state_cells{};
+  for (auto y = 1u; y < 7; ++y) {
+    for (auto x = 1u; x < 7; ++x) {
+      auto neighbours = 0u;
+      for (auto dy = -1; dy <= 1; ++dy)
+        for (auto dx = -1; dx <= 1; ++dx)
+          neighbours += (dx != 0 || dy != 0) && square(x + dx, y + dy) == 1;
+
+      auto state = square(x, y);
+      if (state == 0)
+        state = (rule.birth() >> neighbours) & 1u;
+      else if (state != 1 || !((rule.survival() >> neighbours) & 1u))
+        state = (state + 1) % rule.states();
+      result = result.with(x, y, static_cast<std::uint8_t>(state));
+    }
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Rules are parsed in B/S/C notation", "[generations]") {
+  REQUIRE(generations_rule::parse("B2/S/C3") ==
+          generations_rule::brians_brain());
+  REQUIRE(generations_rule::parse("B2/S345/C4") ==
+          generations_rule::star_wars());
+  REQUIRE(generations_rule::parse("b3/s23") == generations_rule::conway());
+  REQUIRE(generations_rule::parse("B2/S/C3").planes() == 2);
+  REQUIRE(generations_rule::parse("B3/S23/C256").planes() == 8);
+
+  REQUIRE_THROWS_AS(generations_rule::parse("B3"), std::domain_error);
+  REQUIRE_THROWS_AS(generations_rule::parse("B9/S"), std::domain_error);
+  REQUIRE_THROWS_AS(generations_rule::parse("B2/S/C1"), std::domain_error);
+  REQUIRE_THROWS_AS(generations_rule::parse("B2/S/C257"), std::domain_error);
+  REQUIRE_THROWS_AS(generations_rule::parse("B03/S23"), std::domain_error);
+}
+
+TEST_CASE("States are stored in bit planes", "[generations]") {
+  auto square = state_cells{}.with(2, 3, 5).with(7, 7, 255);
+  REQUIRE(square(2, 3) == 5);
+  REQUIRE(square(7, 7) == 255);
+  REQUIRE(square(0, 0) == 0);
+  REQUIRE(square.population_count() == 2);
+  REQUIRE(square.plane(0) == ((1ull << 26) | (1ull << 63)));
+  REQUIRE(square != state_cells{}.with(2, 3, 4).with(7, 7, 255));
+  REQUIRE(square.with(2, 3, 0).with(7, 7, 0) == state_cells{});
+}
+
+TEST_CASE("Two-state rules match cells", "[generations]") {
+  auto engine = std::mt19937{29};
+  for (auto i = 0; i < 100; ++i) {
+    auto square = cells{(std::uint64_t{engine()} << 32) | engine()};
+    REQUIRE(state_cells{square}.step(generations_rule::conway()) ==
+            state_cells{square.step()});
+    REQUIRE(state_cells{square}.next(generations_rule::conway()) ==
+            state_cells{square.next()});
+  }
+}
+
+TEST_CASE("Kernel follows the Generations rules", "[generations]") {
+  auto engine = std::mt19937{31};
+  for (auto rule :
+       {generations_rule::brians_brain(), generations_rule::star_wars(),
+        generations_rule::parse("B1357/S02468/C7"),
+        generations_rule::parse("B38/S078/C256")}) {
+    auto state =
+        std::uniform_int_distribution<std::size_t>{0, rule.states() - 1};
+    for (auto i = 0; i < 100; ++i) {
+      auto square = state_cells{};
+      for (auto y = 0u; y < 8; ++y)
+        for (auto x = 0u; x < 8; ++x)
+          square = square.with(x, y, static_cast<std::uint8_t>(state(engine)));
+      REQUIRE(square.step(rule) == reference_step(square, rule));
+    }
+  }
+}
@@ -0,0 +1,133 @@
+/**
+ * Hashlife
+ * Tests for universes of multi-state cells.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "generations_universe.hpp"
+#include "helpers.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+using namespace life;
+using namespace life::testing;
+
+namespace {
+using states = std::map<std::pair<std::int64_t, std::int64_t>, unsigned>;
+
+/**
+ * Straightforward implementation of a Generations rule, to compare against.
+ */
+auto reference_step(const states &cells, const generations_rule &rule)
+    -> states {
+  auto counts = std::map<std::pair<std::int64_t, std::int64_t>, unsigned>{};
+  for (auto [cell, state] : cells)
+    if (state == 1)
+      for (auto dx = -1; dx <= 1; ++dx)
+        for (auto dy = -1; dy <= 1; ++dy)
+          if (dx != 0 || dy != 0)
+            ++counts[{cell.first + dx, cell.second + dy}];
+
+  auto result = states{};
+  for (auto [cell, count] : counts)
+    if (!cells.count(cell) && ((rule.birth() >> count) & 1u))
+      result[cell] = 1;
+  for (auto [cell, state] : cells) {
+    auto count = counts.count(cell) ? counts[cell] : 0u;
+    if (state == 1 && ((rule.survival() >> count) & 1u))
+      result[cell] = 1;
+    else if (state + 1 < rule.states())
+      result[cell] = state + 1;
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Multi-state universes follow their rule",
+          "[generations_universe]") {
+  for (auto rule :
+       {generations_rule::brians_brain(), generations_rule::star_wars()}) {
+    auto life = generations_universe{rule};
+    auto cells = states{};
+    auto engine = std::mt19937{37};
+    auto state =
+        std::uniform_int_distribution<std::size_t>{0, rule.states() - 1};
+    for (auto y = -12; y < 12; ++y)
+      for (auto x = -12; x < 12; ++x)
+        if (auto s = state(engine); s != 0)
+          life.set(x, y, static_cast<std::uint8_t>(s)), cells[{x, y}] = s;
+    REQUIRE(life.population() == cells.size());
+
+    for (auto generations : {1u, 2u, 5u, 8u, 16u}) {
+      life.advance(generations);
+      for (auto i = 0u; i < generations; ++i)
+        cells = reference_step(cells, rule);
+      REQUIRE(life.population() == cells.size());
+      for (auto [cell, s] : cells)
+        REQUIRE(life.get(cell.first, cell.second) == s);
+    }
+  }
+}
+
+TEST_CASE("Two-state universes match the life universe",
+          "[generations_universe]") {
+  auto life = universe{};
+  auto multi = generations_universe{generations_rule::conway()};
+  for (auto [x, y] : random_soup(32, 41))
+    life.set(x, y), multi.set(x, y, 1);
+
+  life.advance(1000);
+  multi.advance(1000);
+  REQUIRE(multi.population() == life.population());
+  REQUIRE_THROWS_AS(multi.set(0, 0, 2), std::domain_error);
+}
+
+TEST_CASE("Repetitive multi-state patterns are memoized",
+          "[generations_universe]") {
+  auto life = generations_universe{generations_rule::brians_brain()};
+  for (auto i = 0; i < 64; ++i) { // Row of identical oscillators
+    life.set(8 * i, 0, 1), life.set(8 * i + 1, 0, 1);
+    life.set(8 * i, 1, 2), life.set(8 * i + 1, 1, 2);
+  }
+  life.advance(std::uint64_t{1} << 30);
+  REQUIRE(life.generation() == std::uint64_t{1} << 30);
+  REQUIRE(life.population() == 256);
+  REQUIRE(life.statistics()[0].size < 1000);
+}
+
+TEST_CASE("Jumps that overflow a layer do not grow the root",
+          "[generations_universe]") {
+  auto life = universe{};
+  auto multi = generations_universe{generations_rule::conway()};
+  for (auto [x, y] : random_soup(64, 43))
+    life.set(x, y), multi.set(x, y, 1);
+
+  life.advance(std::uint64_t{1} << 12);
+  multi.advance(std::uint64_t{1} << 12);
+  auto rehashes = std::size_t{0};
+  for (const auto &layer : multi.statistics())
+    rehashes += layer.rehashes;
+  REQUIRE(rehashes > 0);
+  REQUIRE(multi.level() == life.level());
+  REQUIRE(multi.population() == life.population());
+}
@@ -0,0 +1,75 @@
+/**
+ * Hashlife
+ * Tests for universes switching between hashlife and sparse tiles.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "hybrid_universe.hpp"
+
+#include <cstdint>
+
+using namespace life;
+using namespace life::testing;
+
+TEST_CASE("Hybrid universes fall back to tiles", "[hybrid_universe]") {
+  auto policy = hybrid_policy{};
+  policy.minimum_hit_rate = 1.0; // Judge every memo to be useless
+  policy.maximum_activity = 0.0; // Never switch back
+  policy.minimum_lookups = 0;
+  policy.window = 16;
+
+  auto hybrid = hybrid_universe{policy};
+  auto life = universe{};
+  for (auto [x, y] : random_soup(48, 17))
+    hybrid.set(x, y), life.set(x, y);
+
+  REQUIRE(hybrid.current() == engine::tree);
+  for (auto generations : {16u, 5u, 27u, 64u}) {
+    hybrid.advance(generations);
+    life.advance(generations);
+    REQUIRE(hybrid.current() == engine::tiles);
+    REQUIRE(hybrid.generation() == life.generation());
+    REQUIRE(hybrid.population() == life.population());
+    for (auto y = -80; y < 80; ++y)
+      for (auto x = -80; x < 80; ++x)
+        REQUIRE(hybrid.get(x, y) == life.get(x, y));
+  }
+}
+
+TEST_CASE("Hybrid universes return to the tree", "[hybrid_universe]") {
+  auto policy = hybrid_policy{};
+  policy.minimum_hit_rate = 1.0;
+  policy.minimum_lookups = 0;
+  policy.window = 8;
+
+  auto hybrid = hybrid_universe{policy};
+  for (auto [x, y] : {std::pair{0, 0}, {1, 0}, {0, 1}, {1, 1}, {-30, 4}})
+    hybrid.set(x, y);
+
+  hybrid.advance(8);
+  REQUIRE(hybrid.current() == engine::tiles);
+  hybrid.advance(8); // Only the block is left, so no tile changes
+  REQUIRE(hybrid.current() == engine::tree);
+  REQUIRE(hybrid.population() == 4);
+  REQUIRE(hybrid.get(1, 1));
+
+  hybrid.advance(100);
+  REQUIRE(hybrid.generation() == 116);
+  REQUIRE(hybrid.population() == 4);
+}
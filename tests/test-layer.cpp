@@ -0,0 +1,162 @@
+/**
+ * Hashlife
+ * Tests for the per-level node tables.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "cells.hpp"
+#include "layer.hpp"
+
+#include <stdexcept>
+
+using namespace life;
+
+TEST_CASE("Layers hash-cons their nodes", "[layer]") {
+  auto leaves = layer<cells>{layer_policy{16, 0.5, 16}};
+
+  SECTION("Identical nodes are stored once") {
+    auto a = leaves.insert(cells::glider());
+    auto b = leaves.insert(cells::glider());
+    auto c = leaves.insert(cells::block());
+
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+    REQUIRE(leaves.size() == 2);
+    REQUIRE(leaves[a] == cells::glider());
+    REQUIRE(leaves[c] == cells::block());
+  }
+
+  SECTION("Statistics track lookups and hits") {
+    leaves.insert(cells::glider());
+    leaves.insert(cells::glider());
+    auto statistics = leaves.statistics();
+
+    REQUIRE(statistics.size == 1);
+    REQUIRE(statistics.capacity == 16);
+    REQUIRE(statistics.lookups == 2);
+    REQUIRE(statistics.hits == 1);
+  }
+
+  SECTION("Insertion beyond the maximum load factor overflows") {
+    for (auto i = 0u; i < 8; ++i)
+      leaves.insert(cells{i});
+
+    REQUIRE_THROWS_AS(leaves.insert(cells{8}), std::length_error);
+    REQUIRE(leaves.overflowed());
+    REQUIRE(leaves.size() == 8);
+  }
+
+  SECTION("Rehashing keeps all nodes and reports their new locations") {
+    auto pointers = std::vector<pointer>{};
+    for (auto i = 0u; i < 8; ++i)
+      pointers.push_back(leaves.insert(cells{i}));
+
+    auto remap = leaves.rehash(leaves.grown_capacity(),
+                               [](const cells &) { return true; });
+
+    REQUIRE(leaves.capacity() > 16);
+    REQUIRE(!leaves.overflowed());
+    for (auto i = 0u; i < 8; ++i)
+      REQUIRE(leaves[remap[pointers[i].index()]] == cells{i});
+  }
+
+  SECTION("Rehashing drops rejected nodes") {
+    auto kept = leaves.insert(cells::glider());
+    auto dropped = leaves.insert(cells::block());
+    auto remap = leaves.rehash(
+        16, [](const cells &leaf) { return leaf == cells::glider(); });
+
+    REQUIRE(leaves.size() == 1);
+    REQUIRE(remap[kept.index()]);
+    REQUIRE(!remap[dropped.index()]);
+  }
+}
+
+TEST_CASE("Generational layers create nodes in a nursery", "[layer-nursery]") {
+  auto leaves =
+      layer<cells>{layer_policy{16, 0.5, 16}, lifetime::generational};
+  auto keep = [](const cells &) { return true; };
+
+  SECTION("New nodes are young until promoted") {
+    auto young = leaves.insert(cells::glider());
+    auto dropped = leaves.insert(cells::block());
+
+    REQUIRE(young.nursery());
+    REQUIRE(leaves.size() == 0);
+    REQUIRE(leaves.nursery_size() == 2);
+    REQUIRE(leaves.find(cells::glider()) == young);
+
+    auto promotion = leaves.promote({young}, false, keep);
+    leaves.reset_nursery();
+
+    auto tenured = promotion(young);
+    REQUIRE(!tenured.nursery());
+    REQUIRE(!promotion(dropped));
+    REQUIRE(leaves[tenured] == cells::glider());
+    REQUIRE(leaves.size() == 1);
+    REQUIRE(leaves.nursery_size() == 0);
+    REQUIRE(leaves.statistics().promoted == 1);
+    REQUIRE(leaves.find(cells::glider()) == tenured);
+    REQUIRE(!leaves.find(cells::block()));
+  }
+
+  SECTION("Promotion grows the tenured table as needed") {
+    auto young = std::vector<pointer>{};
+    for (auto i = 0u; i < 8; ++i)
+      young.push_back(leaves.insert(cells{i}));
+    leaves.promote(young, false, keep);
+    leaves.reset_nursery();
+
+    young.clear();
+    for (auto i = 8u; i < 16; ++i)
+      young.push_back(leaves.insert(cells{i}));
+    auto promotion = leaves.promote(young, false, keep);
+
+    REQUIRE(!promotion.relocated.empty());
+    REQUIRE(leaves.size() == 16);
+    REQUIRE(leaves.load_factor() <= leaves.max_load_factor());
+    for (auto i = 0u; i < 8; ++i)
+      REQUIRE(leaves[promotion(young[i])] == cells{i + 8});
+  }
+
+  SECTION("Overflowing nurseries can be grown once emptied") {
+    for (auto i = 0u; i < 8; ++i)
+      leaves.insert(cells{i});
+    REQUIRE_THROWS_AS(leaves.insert(cells{8}), std::length_error);
+    REQUIRE(leaves.overflowed());
+
+    leaves.reset_nursery();
+    leaves.grow_nursery();
+    REQUIRE(!leaves.overflowed());
+    REQUIRE(leaves.nursery_capacity() == 32);
+    for (auto i = 0u; i < 16; ++i)
+      leaves.insert(cells{i});
+    REQUIRE(leaves.nursery_size() == 16);
+  }
+}
+
+TEST_CASE("Layer policies depend on the level", "[layer-policy]") {
+  auto bottom = layer_policy::for_level(0);
+  auto middle = layer_policy::for_level(5);
+  auto top = layer_policy::for_level(40);
+
+  REQUIRE(bottom.capacity >= middle.capacity);
+  REQUIRE(middle.capacity >= top.capacity);
+  REQUIRE(top.capacity > 0);
+  REQUIRE(top.max_load_factor <= bottom.max_load_factor);
+}
@@ -0,0 +1,78 @@
+/**
+ * Hashlife
+ * Tests for Larger-than-Life rules.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "ltl_rule.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace life;
+
+TEST_CASE("Larger-than-Life rules are parsed", "[ltl_rule]") {
+  auto bosco = ltl_rule::parse("R5,C0,M1,S34..58,B34..45,NM");
+  REQUIRE(bosco == ltl_rule{5, 34, 45, 34, 58});
+  REQUIRE(bosco.range() == 5);
+  REQUIRE(bosco.born(34));
+  REQUIRE(!bosco.born(46));
+  REQUIRE(bosco.survives(58));
+  REQUIRE(ltl_rule::parse("r1,m0,s2..3,b3..3") ==
+          ltl_rule{1, 3, 3, 2, 3, false});
+
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,S34..58"), std::domain_error);
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,C3,S1..2,B3..4"), std::domain_error);
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,S1..2,B0..4"), std::domain_error);
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,S1..2,B4..3"), std::domain_error);
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,S1..2,B3..4,NN"), std::domain_error);
+  REQUIRE_THROWS_AS(ltl_rule::parse("R5,S1-2,B3..4"), std::domain_error);
+}
+
+TEST_CASE("Neighbourhoods are summed over the full range", "[ltl_rule]") {
+  constexpr auto side = std::size_t{24};
+  auto engine = std::mt19937{53};
+  auto coin = std::bernoulli_distribution{0.5};
+  for (auto rule :
+       {ltl_rule{2, 3, 9, 5, 12}, ltl_rule{3, 8, 20, 4, 25, false}}) {
+    auto grid = std::vector<std::uint8_t>(side * side);
+    for (auto &cell : grid)
+      cell = coin(engine);
+
+    auto expected = grid;
+    const auto r = static_cast<int>(rule.range());
+    for (auto y = 0; y < int(side); ++y) {
+      for (auto x = 0; x < int(side); ++x) {
+        auto count = std::size_t{0};
+        for (auto dy = -r; dy <= r; ++dy)
+          for (auto dx = -r; dx <= r; ++dx)
+            if (x + dx >= 0 && x + dx < int(side) && y + dy >= 0 &&
+                y + dy < int(side) && (dx || dy || rule.middle()))
+              count += grid[(y + dy) * side + x + dx];
+        auto alive = grid[y * side + x];
+        expected[y * side + x] =
+            alive ? rule.survives(count) : rule.born(count);
+      }
+    }
+
+    rule.step(grid, side);
+    REQUIRE(grid == expected);
+  }
+}
@@ -0,0 +1,109 @@
+/**
+ * Hashlife
+ * Tests for universes following Larger-than-Life rules.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "ltl_universe.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+
+using namespace life;
+using namespace life::testing;
+
+namespace {
+/**
+ * Straightforward implementation of a Larger-than-Life rule.
+ */
+auto reference_step(const coordinates &alive, const ltl_rule &rule)
+    -> coordinates {
+  const auto r = static_cast<std::int64_t>(rule.range());
+  auto counts = std::map<std::pair<std::int64_t, std::int64_t>, std::size_t>{};
+  for (auto [x, y] : alive)
+    for (auto dy = -r; dy <= r; ++dy)
+      for (auto dx = -r; dx <= r; ++dx)
+        if (dx != 0 || dy != 0 || rule.middle())
+          ++counts[{x + dx, y + dy}];
+
+  auto result = coordinates{};
+  for (auto [cell, count] : counts)
+    if (alive.count(cell) ? rule.survives(count) : rule.born(count))
+      result.insert(cell);
+  return result;
+}
+} // namespace
+
+TEST_CASE("Range-one rules match life", "[ltl_universe]") {
+  auto life = universe{};
+  auto ltl = ltl_universe{ltl_rule::parse("R1,C0,M0,S2..3,B3..3,NM")};
+  REQUIRE(ltl.base_level() == 1);
+
+  for (auto [x, y] : random_soup(32, 59))
+    life.set(x, y), ltl.set(x, y);
+
+  for (auto generations : {1u, 6u, 100u, 1000u}) {
+    life.advance(generations);
+    ltl.advance(generations);
+    REQUIRE(ltl.population() == life.population());
+    for (auto y = -64; y < 64; ++y)
+      for (auto x = -64; x < 64; ++x)
+        REQUIRE(ltl.get(x, y) == life.get(x, y));
+  }
+}
+
+TEST_CASE("Larger ranges follow their rule", "[ltl_universe]") {
+  for (auto rule : {ltl_rule::parse("R2,C0,M1,S5..9,B6..8,NM"),
+                    ltl_rule::parse("R5,C0,M1,S34..58,B34..45,NM")}) {
+    auto life = ltl_universe{rule};
+    REQUIRE(rule.range() <= std::size_t{2} << life.base_level());
+
+    auto alive = random_soup(-12, -12, 24, 24, 61, 0.5);
+    for (auto [x, y] : alive)
+      life.set(x, y);
+
+    for (auto generations : {1u, 2u, 5u, 8u}) {
+      life.advance(generations);
+      for (auto i = 0u; i < generations; ++i)
+        alive = reference_step(alive, rule);
+      REQUIRE(life.population() == alive.size());
+      for (auto [x, y] : alive)
+        REQUIRE(life.get(x, y));
+    }
+  }
+}
+
+TEST_CASE("Overflowing jumps do not grow the root of a range-one rule",
+          "[ltl_universe]") {
+  auto life = universe{};
+  auto ltl = ltl_universe{ltl_rule::parse("R1,C0,M0,S2..3,B3..3,NM")};
+  for (auto [x, y] : random_soup(64, 67))
+    life.set(x, y), ltl.set(x, y);
+
+  life.advance(std::uint64_t{1} << 12);
+  ltl.advance(std::uint64_t{1} << 12);
+  auto rehashes = std::size_t{0};
+  for (const auto &layer : ltl.statistics())
+    rehashes += layer.rehashes;
+  REQUIRE(rehashes > 0);
+  REQUIRE(ltl.level() == life.level());
+  REQUIRE(ltl.population() == life.population());
+}
@@ -0,0 +1,88 @@
+/**
+ * Hashlife
+ * Tests for the neighbourhood policies of the leaf kernels.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "neighbourhood.hpp"
+#include "rule_table.hpp"
+
+#include <cstdint>
+#include <random>
+
+using namespace life;
+
+namespace {
+/**
+ * Counts the living cells around (x, y) one by one, the cell itself included.
+ */
+template <typename Neighbourhood>
+auto reference(std::uint64_t bitmap, unsigned x, unsigned y) {
+  auto count = 0u;
+  for (auto dy = 0u; dy < 3; ++dy)
+    for (auto dx = 0u; dx < 3; ++dx) {
+      auto member = dx + 3 * dy == 4 ||
+                    ((Neighbourhood::neighbours >> (dx + 3 * dy)) & 1u);
+      auto bit = (x + dx - 1) + 8 * (y + dy - 1);
+      count += member && ((bitmap >> bit) & 1u);
+    }
+  return count;
+}
+
+template <typename Neighbourhood> void check_counts() {
+  auto engine = std::mt19937{17};
+  for (auto i = 0; i < 200; ++i) {
+    auto bitmap = (std::uint64_t{engine()} << 32) | engine();
+    auto [sum1, sum2, sum4, sum8] = Neighbourhood::count(bitmap);
+    for (auto y = 1u; y < 7; ++y)
+      for (auto x = 1u; x < 7; ++x) {
+        auto bit = x + 8 * y;
+        auto count = ((sum1 >> bit) & 1u) | ((sum2 >> bit) & 1u) << 1 |
+                     ((sum4 >> bit) & 1u) << 2 | ((sum8 >> bit) & 1u) << 3;
+        REQUIRE(count == reference<Neighbourhood>(bitmap, x, y));
+      }
+  }
+}
+
+/**
+ * Advances a square by looking up each neighbourhood in the table, which a
+ * table changed by hand always does.
+ */
+auto lookup(rule_table rule, cells square) {
+  rule.set(0, false);
+  return rule.step(square);
+}
+} // namespace
+
+TEST_CASE("Neighbourhoods count exactly", "[neighbourhood]") {
+  check_counts<moore>();
+  check_counts<von_neumann>();
+  check_counts<hexagonal>();
+}
+
+TEST_CASE("Kernels agree with table lookups", "[neighbourhood]") {
+  auto engine = std::mt19937{29};
+  for (auto rule : {"B3/S23", "B36/S125", "B1/S1V", "B13/S024V", "B2/S34H",
+                    "B245/S3H", "B2-a/S12"}) {
+    auto table = rule_table::parse(rule);
+    for (auto i = 0; i < 100; ++i) {
+      auto square = cells{(std::uint64_t{engine()} << 32) | engine()};
+      REQUIRE(table.step(square) == lookup(table, square));
+    }
+  }
+}
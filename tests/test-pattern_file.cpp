@@ -0,0 +1,124 @@
+/**
+ * Hashlife
+ * Tests for reading pattern files in place.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "catch2/catch.hpp"
+
+#include "pattern_file.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace life;
+
+namespace {
+auto write(const std::string &text) -> std::string {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.pattern";
+  std::ofstream{path, std::ios::binary} << text;
+  return path.string();
+}
+
+/**
+ * Checks that a glider lies with its bounding box at (x, y), and nothing else.
+ */
+void require_glider(const universe &life, std::int64_t x, std::int64_t y) {
+  REQUIRE(life.population() == 5);
+  for (auto [dx, dy] : std::vector<std::pair<int, int>>{
+           {1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}})
+    REQUIRE(life.get(x + dx, y + dy));
+}
+} // namespace
+
+TEST_CASE("Pattern files are recognised by their contents",
+          "[pattern_file]") {
+  REQUIRE(pattern_file::detect("#N Glider\nx = 3, y = 3\nbo$2bo$3o!") ==
+          pattern_format::rle);
+  REQUIRE(pattern_file::detect("!Name: Glider\n.O.\n..O\nOOO\n") ==
+          pattern_format::plaintext);
+  REQUIRE(pattern_file::detect("#Life 1.06\n0 0\n") ==
+          pattern_format::life_106);
+  REQUIRE(pattern_file::detect("[M2] (golly 2.0)\n") ==
+          pattern_format::macrocell);
+}
+
+TEST_CASE("Pattern files are read in every format", "[pattern_file]") {
+  auto life = universe{};
+  life.set(-100, -100);
+
+  SECTION("Run-length encoded") {
+    auto file = pattern_file{write("#N Glider\nx = 3, y = 3, rule = B3/S23\n"
+                                   "bo$2bo$\n3o!\n")};
+    REQUIRE(file.format() == pattern_format::rle);
+    file.load_into(life, 2);
+    require_glider(life, 0, 0);
+  }
+
+  SECTION("Plaintext") {
+    auto file = pattern_file{write("!Name: Glider\r\n.O.\r\n..O\r\nOOO\r\n")};
+    REQUIRE(file.format() == pattern_format::plaintext);
+    file.load_into(life);
+    require_glider(life, 0, 0);
+  }
+
+  SECTION("Life 1.06") {
+    auto file = pattern_file{write("#Life 1.06\n-4 -9\n-3 -8\n-5 -7\n"
+                                   "-4 -7\n-3 -7\n")};
+    REQUIRE(file.format() == pattern_format::life_106);
+    file.load_into(life);
+    require_glider(life, -5, -9);
+  }
+
+  SECTION("Macrocell") {
+    auto file = pattern_file{write("[M2] (golly 2.0)\n#R B3/S23\n"
+                                   ".*$..*$***$\n4 0 0 0 1\n")};
+    REQUIRE(file.format() == pattern_format::macrocell);
+    file.load_into(life);
+    require_glider(life, 0, 0);
+    REQUIRE(life.level() == 1);
+
+    auto shared = pattern_file{write("[M2] (golly 2.0)\n"
+                                     ".*$..*$***$\n4 0 0 0 1\n5 2 2 2 2\n")};
+    shared.load_into(life);
+    REQUIRE(life.level() == 2);
+    REQUIRE(life.population() == 20);
+    REQUIRE(life.get(-16 + 8 + 1, -16 + 8));
+    REQUIRE(life.get(8 + 2, 8 + 1));
+
+    auto broken = pattern_file{write("[M2]\n4 0 0 0 2\n")};
+    REQUIRE_THROWS_AS(broken.load_into(life), std::domain_error);
+  }
+
+  std::filesystem::remove(write(""));
+}
+
+TEST_CASE("Missing pattern files are refused", "[pattern_file]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-missing";
+  std::filesystem::remove(path);
+  REQUIRE_THROWS_AS(pattern_file{path.string()}, std::runtime_error);
+
+  auto empty = pattern_file{write("")};
+  REQUIRE(empty.text().empty());
+  std::filesystem::remove(write(""));
+}
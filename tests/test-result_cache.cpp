@@ -0,0 +1,80 @@
+/**
+ * Hashlife
+ * Tests for the persistent cache of computed results.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "result_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace life;
+
+TEST_CASE("Result caches persist across runs", "[result_cache]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.cache";
+  std::filesystem::remove(path);
+  auto glider = digest::of(cells::glider());
+  auto block = digest::of(cells::block());
+  auto node = digest::of({glider, glider, block, block});
+
+  {
+    auto cache = result_cache{path.string()};
+    REQUIRE(!cache.find(node, 1));
+    REQUIRE_THROWS_AS(cache.insert(node, 1, block), std::domain_error);
+    REQUIRE_THROWS_AS(cache.store(node, {glider, glider, block, block}),
+                      std::domain_error);
+
+    cache.store(glider, cells::glider());
+    cache.store(block, cells::block());
+    cache.store(node, {glider, glider, block, block});
+    cache.insert(node, 1, block);
+    REQUIRE(cache.find(node, 1) == block);
+    REQUIRE(!cache.find(node, 2));
+  }
+
+  SECTION("Results are read back") {
+    auto cache = result_cache{path.string()};
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.find(node, 1) == block);
+    REQUIRE(cache.leaf(glider) == cells::glider());
+    REQUIRE(cache.quadrants(node)[2] == block);
+  }
+
+  SECTION("Torn records are discarded") {
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 3);
+    {
+      auto cache = result_cache{path.string()};
+      REQUIRE(cache.size() == 0);
+      REQUIRE(cache.contains(node));
+      cache.insert(node, 2, glider);
+    }
+    auto cache = result_cache{path.string()};
+    REQUIRE(cache.find(node, 2) == glider);
+    REQUIRE(!cache.find(node, 1));
+  }
+
+  SECTION("Other files are refused") {
+    std::ofstream{path, std::ios::trunc} << "not a cache";
+    REQUIRE_THROWS_AS(result_cache{path.string()}, std::domain_error);
+  }
+
+  std::filesystem::remove(path);
+}
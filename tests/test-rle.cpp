@@ -0,0 +1,137 @@
+/**
+ * Hashlife
+ * Tests for reading run-length encoded patterns.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "rle.hpp"
+#include "thread_pool.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+using namespace life;
+using namespace life::testing;
+
+namespace {
+/**
+ * Encodes living cells, with the top-left one of a width x height box at the
+ * origin, wrapping lines as pattern collections do.
+ */
+auto encode(const coordinates &alive, std::int64_t width,
+            std::int64_t height) -> std::string {
+  auto body = std::string{};
+  auto put = [&](std::int64_t count, char tag) {
+    if (count > 1)
+      body += std::to_string(count);
+    body += tag;
+  };
+
+  auto rows = std::int64_t{0};
+  for (auto y = std::int64_t{0}; y < height; ++y) {
+    auto cells = std::string{};
+    for (auto x = std::int64_t{0}; x < width; ++x)
+      cells += alive.count({x, y}) ? 'o' : 'b';
+    while (!cells.empty() && cells.back() == 'b')
+      cells.pop_back();
+    if (cells.empty()) {
+      ++rows;
+      continue;
+    }
+    if (y > 0)
+      put(rows, '$');
+    rows = 1;
+    for (auto at = std::size_t{0}; at < cells.size();) {
+      auto end = cells.find_first_not_of(cells[at], at);
+      end = end == cells.npos ? cells.size() : end;
+      put(static_cast<std::int64_t>(end - at), cells[at]);
+      at = end;
+    }
+  }
+  body += '!';
+
+  auto text = "#C Random soup\nx = " + std::to_string(width) +
+              ", y = " + std::to_string(height) + ", rule = B3/S23\n";
+  for (auto at = std::size_t{0}; at < body.size(); at += 70)
+    text += body.substr(at, 70) + '\n';
+  return text;
+}
+} // namespace
+
+TEST_CASE("Run-length encoded patterns can be read", "[rle]") {
+  auto glider = rle_pattern::parse("#N Glider\n"
+                                   "x = 3, y = 3, rule = B3/S23\n"
+                                   "bo$2bo$3o!");
+  REQUIRE(glider.width() == 3);
+  REQUIRE(glider.height() == 3);
+  REQUIRE(glider.rule() == "B3/S23");
+  REQUIRE(glider.population() == 5);
+  REQUIRE(glider.blocks().size() == 1);
+  REQUIRE(glider.blocks().front().x == 0);
+  REQUIRE(glider.blocks().front().y == 0);
+  REQUIRE(glider.blocks().front().contents == cells{".*$..*$***"});
+
+  SECTION("Runs may cross leaves and rows may be skipped") {
+    auto pattern = rle_pattern::parse("x = 20, y = 12\n20o10$o!");
+    REQUIRE(pattern.population() == 21);
+    REQUIRE(pattern.blocks().size() == 4);
+    REQUIRE(pattern.blocks()[2].x == 16);
+    REQUIRE(pattern.blocks()[2].contents == cells{"****"});
+    REQUIRE(pattern.blocks()[3].y == 8);
+    REQUIRE(pattern.blocks()[3].contents == cells{"$$*"});
+  }
+
+  SECTION("Malformed patterns are refused") {
+    REQUIRE_THROWS_AS(rle_pattern::parse("#C Nothing\n"), std::domain_error);
+    REQUIRE_THROWS_AS(rle_pattern::parse("x = 3\nooo!"), std::domain_error);
+    REQUIRE_THROWS_AS(rle_pattern::parse("x = 3, y = 1\no?o!"),
+                      std::domain_error);
+  }
+}
+
+TEST_CASE("Patterns are decoded in parallel chunks", "[rle]") {
+  auto alive = coordinates{};
+  for (auto cell : random_soup(0, 0, 150, 203, 1, 0.3))
+    if ((cell.second / 5) % 4 != 3) // Leaves runs of empty rows
+      alive.insert(cell);
+  auto text = encode(alive, 150, 203);
+  auto sequential = rle_pattern::parse(text);
+  REQUIRE(sequential.population() == alive.size());
+
+  auto life = universe{};
+  life.set_blocks(sequential.blocks());
+  REQUIRE(life.population() == alive.size());
+  for (auto [x, y] : alive)
+    REQUIRE(life.get(x, y));
+
+  for (auto threads : {2u, 3u, 7u}) {
+    auto pool = thread_pool{threads};
+    auto parallel = rle_pattern::parse(text, pool);
+    REQUIRE(parallel.blocks().size() == sequential.blocks().size());
+    for (auto i = std::size_t{0}; i < parallel.blocks().size(); ++i) {
+      REQUIRE(parallel.blocks()[i].x == sequential.blocks()[i].x);
+      REQUIRE(parallel.blocks()[i].y == sequential.blocks()[i].y);
+      REQUIRE(parallel.blocks()[i].contents ==
+              sequential.blocks()[i].contents);
+    }
+  }
+}
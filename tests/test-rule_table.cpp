@@ -0,0 +1,159 @@
+/**
+ * Hashlife
+ * Tests for rule tables and Hensel notation.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "rule_table.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace life;
+
+namespace {
+auto entries(const rule_table &rule) {
+  auto count = 0;
+  for (auto neighbourhood = 0u; neighbourhood < 512; ++neighbourhood)
+    count += rule(neighbourhood);
+  return count;
+}
+
+auto rotate(std::uint32_t neighbourhood) {
+  auto result = std::uint32_t{0};
+  for (auto y = 0u; y < 3; ++y)
+    for (auto x = 0u; x < 3; ++x)
+      if ((neighbourhood >> (x + 3 * y)) & 1u)
+        result |= std::uint32_t{1} << ((2 - y) + 3 * x);
+  return result;
+}
+/**
+ * Reads a neighbourhood drawn as three rows of three cells, separated by
+ * slashes, with 'O' marking living cells.
+ */
+auto drawn(const std::string &picture) {
+  auto result = std::uint32_t{0};
+  auto bit = 0u;
+  for (auto c : picture) {
+    if (c == '/')
+      continue;
+    if (c == 'O')
+      result |= std::uint32_t{1} << bit;
+    ++bit;
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Totalistic rules match cells", "[rule_table]") {
+  auto rule = rule_table::conway();
+  REQUIRE(entries(rule) == 56 + 28 + 56);
+  REQUIRE(rule == rule_table::parse("b3/s23"));
+  REQUIRE(rule == rule_table::parse("B3aceijknqry/S2aceikn3aceijknqry"));
+
+  auto engine = std::mt19937{43};
+  for (auto i = 0; i < 200; ++i) {
+    auto square = cells{(std::uint64_t{engine()} << 32) | engine()};
+    REQUIRE(rule.step(square) == square.step());
+    REQUIRE(rule.next(square) == square.next());
+  }
+}
+
+TEST_CASE("Letters select configurations", "[rule_table]") {
+  REQUIRE(entries(rule_table::parse("B2a/S")) == 8);
+  REQUIRE(entries(rule_table::parse("B2-a/S")) == 20);
+  REQUIRE(entries(rule_table::parse("B4c/S")) == 1);
+  REQUIRE(entries(rule_table::parse("B4ez/S")) == 1 + 4);
+  REQUIRE(entries(rule_table::parse("B5c/S")) == 4);
+  REQUIRE(entries(rule_table::parse("B/S7e")) == 4);
+
+  auto rule = rule_table::parse("B2a/S1c");
+  REQUIRE(rule(0b000'000'011)); // Corner next to an edge
+  REQUIRE(!rule(0b000'000'101)); // Two corners
+  REQUIRE(rule(0b000'010'001)); // Living cell with a single corner
+  REQUIRE(!rule(0b000'010'010));
+
+  auto isotropic = rule_table::parse("B2-a3j4iwz5cq/S12k4nt6e7");
+  for (auto neighbourhood = 0u; neighbourhood < 512; ++neighbourhood)
+    REQUIRE(isotropic(neighbourhood) == isotropic(rotate(neighbourhood)));
+}
+
+TEST_CASE("Each letter names its configuration", "[rule_table]") {
+  struct {
+    char count;
+    char letter;
+    const char *picture;
+  } const shapes[] = {
+      {'1', 'c', "O../.../..."}, {'1', 'e', ".O./.../..."},
+      {'2', 'c', "O.O/.../..."}, {'2', 'e', ".O./O../..."},
+      {'2', 'a', "OO./.../..."}, {'2', 'i', ".../O.O/..."},
+      {'2', 'k', "O../..O/..."}, {'2', 'n', "..O/.../O.."},
+      {'3', 'c', "O.O/.../..O"}, {'3', 'e', ".O./O.O/..."},
+      {'3', 'a', "OO./O../..."}, {'3', 'i', "O../O../O.."},
+      {'3', 'k', ".O./..O/O.."}, {'3', 'n', "O.O/O../..."},
+      {'3', 'j', "..O/..O/.O."}, {'3', 'q', "OO./.../..O"},
+      {'3', 'r', "..O/O.O/..."}, {'3', 'y', "O../..O/O.."},
+      {'4', 'c', "O.O/.../O.O"}, {'4', 'e', ".O./O.O/.O."},
+      {'4', 'a', "OOO/O../..."}, {'4', 'i', "O.O/O.O/..."},
+      {'4', 'k', "OO./..O/O.."}, {'4', 'n', "OOO/.../O.."},
+      {'4', 'j', ".O./O.O/O.."}, {'4', 'q', ".OO/..O/O.."},
+      {'4', 'r', "OO./O.O/..."}, {'4', 'y', "O.O/..O/O.."},
+      {'4', 't', "OOO/.../.O."}, {'4', 'w', ".OO/O../O.."},
+      {'4', 'z', "OO./.../.OO"}};
+
+  for (const auto &shape : shapes) {
+    auto neighbourhood = drawn(shape.picture);
+    for (const auto &other : shapes) {
+      if (other.count != shape.count)
+        continue;
+      auto rule = rule_table::parse(
+          std::string{'B', other.count, other.letter} + "/S");
+      INFO(shape.count << shape.letter << " against " << other.count
+                       << other.letter);
+      REQUIRE(rule(neighbourhood) == (other.letter == shape.letter));
+    }
+  }
+}
+
+TEST_CASE("Invalid rules are rejected", "[rule_table]") {
+  REQUIRE_THROWS_AS(rule_table::parse("B3"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B2z/S"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B3-/S23"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B9/S"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B0/S"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B3/S23/S2"), std::domain_error);
+}
+
+TEST_CASE("Rules may restrict the neighbourhood", "[rule_table]") {
+  auto hexagonal = rule_table::parse("B2/S34H");
+  REQUIRE(entries(hexagonal) == 4 * (15 + 20 + 15));
+  REQUIRE(hexagonal(0b000'000'011)); // North-west and north
+  REQUIRE(!hexagonal(0b000'000'110)); // North-east is not a neighbour
+  REQUIRE(hexagonal != rule_table::parse("B2/S34"));
+
+  auto von_neumann = rule_table::parse("B1/S1v");
+  REQUIRE(von_neumann(0b000'000'010));
+  REQUIRE(!von_neumann(0b000'000'001));
+  REQUIRE(von_neumann(0b000'011'001));
+
+  REQUIRE_THROWS_AS(rule_table::parse("B2a/S34H"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B5/S1V"), std::domain_error);
+  REQUIRE_THROWS_AS(rule_table::parse("B7/SH"), std::domain_error);
+}
@@ -0,0 +1,104 @@
+/**
+ * Hashlife
+ * Tests for the batches exchanged between a universe and its shards.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "catch2/catch.hpp"
+
+#include "shard.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+using namespace life;
+
+TEST_CASE("Shard messages carry records and requests", "[shard]") {
+  auto glider = digest::of(cells::glider());
+  auto block = digest::of(cells::block());
+  auto node = digest::of({glider, glider, block, block});
+
+  auto message = shard_message{};
+  REQUIRE(message.empty());
+  message.record(glider, cells::glider());
+  message.record(block, cells::block());
+  message.record(node, {glider, glider, block, block});
+  message.request(1, node);
+  message.reply(1, node, block);
+
+  auto records = node_records{};
+  auto known = std::unordered_set<digest>{};
+  auto entries = shard_message{message.words()}.read(records, known);
+  REQUIRE(entries.size() == 2);
+  REQUIRE(entries[0].level == 1);
+  REQUIRE(entries[0].node == node);
+  REQUIRE(!entries[0].result);
+  REQUIRE(entries[1].result == block);
+  REQUIRE(known.size() == 3);
+  REQUIRE(records.size() == 3);
+  REQUIRE(records.leaf(glider) == cells::glider());
+  REQUIRE(records.quadrants(node)[2] == block);
+
+  SECTION("Malformed messages are rejected") {
+    auto words = message.words();
+    words.pop_back();
+    REQUIRE_THROWS_AS(shard_message{words}.read(records, known),
+                      std::runtime_error);
+    REQUIRE_THROWS_AS(shard_message{{99}}.read(records, known),
+                      std::runtime_error);
+  }
+}
+
+TEST_CASE("Shards are told to forget first", "[shard]") {
+  auto glider = digest::of(cells::glider());
+  auto message = shard_message{};
+  message.forget();
+  message.record(glider, cells::glider());
+  REQUIRE(message.forgets());
+  REQUIRE_THROWS_AS(message.forget(), std::domain_error);
+
+  auto records = node_records{};
+  auto known = std::unordered_set<digest>{};
+  REQUIRE(shard_message{message.words()}.read(records, known).empty());
+  REQUIRE(records.contains(glider));
+
+  auto words = message.words();
+  words.push_back(words.front());
+  REQUIRE_THROWS_AS(shard_message{words}.read(records, known),
+                    std::runtime_error);
+}
+
+TEST_CASE("Shards own equal ranges of digests", "[shard]") {
+  auto links = std::vector<std::unique_ptr<transport>>{};
+  REQUIRE_THROWS_AS(shard_client{std::move(links)}, std::domain_error);
+
+  for (auto shard = 0; shard < 3; ++shard)
+    links.push_back(socket_transport::pair().first);
+  auto client = shard_client{std::move(links)};
+  constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+  REQUIRE(client.shards() == 4);
+  REQUIRE(client.owner(digest{0, 1}) == 0);
+  REQUIRE(client.owner(digest{max / 4, 1}) == 0);
+  REQUIRE(client.owner(digest{max / 4 + 1, 1}) == 1);
+  REQUIRE(client.owner(digest{max / 2 + 1, 1}) == 2);
+  REQUIRE(client.owner(digest{max, 1}) == 3);
+  REQUIRE(!client.future(digest{1, 1}));
+}
@@ -0,0 +1,136 @@
+/**
+ * Hashlife
+ * Tests for the hash set in shared memory.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "shared_set.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace life;
+
+TEST_CASE("Shared sets are shared between handles", "[shared_set]") {
+  auto name = "/hashlife-test-" + std::to_string(::getpid());
+  shared_set<std::uint64_t>::remove(name);
+  auto set = shared_set<std::uint64_t>{name, 1024};
+
+  SECTION("Elements are found at the same index by every handle") {
+    auto other = shared_set<std::uint64_t>{name, 1024};
+    auto [index, inserted] = set.emplace(42);
+    REQUIRE(inserted);
+    REQUIRE(other.find(42) == index);
+    REQUIRE(other.emplace(42) == std::pair{index, false});
+    REQUIRE(other.size() == 1);
+    REQUIRE(other.find(43) == other.capacity());
+  }
+
+  SECTION("Layouts must match") {
+    REQUIRE_THROWS_AS((shared_set<std::uint64_t>{name, 512}),
+                      std::domain_error);
+  }
+
+  SECTION("Full sets refuse new elements") {
+    auto small = shared_set<std::uint64_t>{name + "-small", 4, 4};
+    for (auto key = 0u; key < 4; ++key)
+      REQUIRE(small.emplace(key).second);
+    REQUIRE(small.emplace(4) == std::pair{small.capacity(), false});
+    shared_set<std::uint64_t>::remove(name + "-small");
+  }
+
+  SECTION("Concurrent insertions agree on a single index") {
+    auto indices = std::vector<std::vector<std::size_t>>(4);
+    auto workers = std::vector<std::thread>{};
+    for (auto &found : indices)
+      workers.emplace_back([&found, &name] {
+        auto handle = shared_set<std::uint64_t>{name, 1024};
+        for (auto key = std::uint64_t{0}; key < 600; ++key)
+          found.push_back(handle.emplace(key * 7919).first);
+      });
+    for (auto &worker : workers)
+      worker.join();
+
+    REQUIRE(set.size() == 600);
+    for (const auto &found : indices)
+      REQUIRE(found == indices.front());
+  }
+
+  SECTION("Other processes see the same elements") {
+    auto child = ::fork();
+    if (child == 0) {
+      auto handle = shared_set<std::uint64_t>{name, 1024};
+      handle.emplace(7);
+      ::_exit(handle.find(7) == handle.capacity());
+    }
+    auto status = 0;
+    ::waitpid(child, &status, 0);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    REQUIRE(set.find(7) != set.capacity());
+  }
+
+  // Claims slot 7 as <state>: the header takes 32 bytes, and every slot 16,
+  // starting with its state
+  auto forge = [&name](std::uint64_t state) {
+    auto descriptor = ::shm_open(name.c_str(), O_RDWR, 0600);
+    auto bytes = 32 + 1024 * 16;
+    auto address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          descriptor, 0);
+    ::close(descriptor);
+    REQUIRE(address != MAP_FAILED);
+    std::memcpy(static_cast<char *>(address) + 32 + 7 * 16, &state,
+                sizeof(state));
+    ::munmap(address, bytes);
+  };
+
+  SECTION("Slots claimed by dead processes are taken over") {
+    auto child = ::fork();
+    if (child == 0)
+      ::_exit(0);
+    ::waitpid(child, nullptr, 0);
+
+    forge(std::uint64_t{static_cast<std::uint32_t>(child)} << 2 | 1u);
+    REQUIRE(set.emplace(7) == std::pair{std::size_t{7}, true});
+    REQUIRE(set.find(7) == 7);
+    REQUIRE(set.size() == 1);
+  }
+
+  SECTION("Claims of reused process ids are taken over") {
+    if (!std::ifstream{"/proc/self/stat"})
+      return;
+
+    // The id of this process, but not its start time
+    forge(std::uint64_t{0xffffffff} << 32 |
+          std::uint64_t{static_cast<std::uint32_t>(::getpid())} << 2 | 1u);
+    REQUIRE(set.emplace(7) == std::pair{std::size_t{7}, true});
+    REQUIRE(set.size() == 1);
+  }
+
+  shared_set<std::uint64_t>::remove(name);
+}
@@ -0,0 +1,76 @@
+/**
+ * Hashlife
+ * Tests for compacted snapshots of the universe.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "snapshot.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+
+using namespace life;
+
+TEST_CASE("Snapshots compact the reachable tree", "[snapshot]") {
+  auto life = universe{};
+  for (auto x = -40; x < 40; x += 3)
+    for (auto y = -30; y < 30; y += 2)
+      if ((x * 7 + y * 13) % 5 < 2)
+        life.set(x, y);
+  life.advance(20);
+  auto compact = life.snapshot();
+
+  SECTION("Contents match the universe") {
+    REQUIRE(compact.level() == life.level());
+    REQUIRE(compact.generation() == life.generation());
+    REQUIRE(compact.population() == life.population());
+    for (auto x = -80; x < 80; ++x)
+      for (auto y = -80; y < 80; ++y)
+        REQUIRE(compact.get(x, y) == life.get(x, y));
+  }
+
+  SECTION("Nodes are stored once, children after their parents") {
+    for (auto level = 1u; level <= compact.level(); ++level) {
+      const auto &nodes = compact.nodes(level);
+      auto below = level == 1 ? compact.leaves().size()
+                              : compact.nodes(level - 1).size();
+      auto expected = std::size_t{0};
+      for (const auto &node : nodes) {
+        for (auto quadrant : node.quadrants()) {
+          REQUIRE(quadrant.index() < below);
+          REQUIRE(quadrant.index() <= expected);
+          if (quadrant.index() == expected)
+            ++expected;
+        }
+        if (node.next())
+          REQUIRE(node.next().index() < below);
+      }
+    }
+  }
+
+  SECTION("Leaf traversal visits all living cells") {
+    auto population = std::uint64_t{0};
+    compact.for_each_leaf([&](std::int64_t x, std::int64_t y, cells leaf) {
+      population += leaf.population_count();
+      for (auto row = 0; row < cells::rows; ++row)
+        for (auto column = 0; column < cells::columns; ++column)
+          REQUIRE(leaf(column, row) == life.get(x + column, y + row));
+    });
+    REQUIRE(population == life.population());
+  }
+}
@@ -0,0 +1,63 @@
+/**
+ * Hashlife
+ * Tests for the append-only file of spilled nodes.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "spill_file.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+
+using namespace life;
+
+TEST_CASE("Spill files store nodes by record", "[spill_file]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.spill";
+
+  SECTION("Records read back as written") {
+    auto file = spill_file{path.string()};
+    auto glider = file.append(cells::glider());
+    auto block = file.append(cells::block());
+    auto node = macrocell{glider, block, spill_file::empty, glider};
+    node.memoize_step(glider);
+    node.memoize_next(block);
+    auto parent = file.append(node);
+
+    REQUIRE(glider.spilled());
+    REQUIRE(file.size() == 3);
+    REQUIRE(file.leaf(glider) == cells::glider());
+    REQUIRE(file.leaf(block) == cells::block());
+
+    auto read = file.node(parent);
+    REQUIRE(read == node);
+    REQUIRE(read.next() == block);
+    REQUIRE(!read.step());
+  }
+
+  SECTION("Records may only refer to other records") {
+    auto file = spill_file{path.string()};
+    auto node = macrocell{pointer{std::size_t{0}}, spill_file::empty,
+                          spill_file::empty, spill_file::empty};
+    REQUIRE_THROWS_AS(file.append(node), std::domain_error);
+  }
+
+  SECTION("Spill files are removed along with their owner") {
+    { auto file = spill_file{path.string()}; }
+    REQUIRE(!std::filesystem::exists(path));
+  }
+}
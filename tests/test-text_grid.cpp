@@ -0,0 +1,106 @@
+/**
+ * Hashlife
+ * Tests for parsing dense grids of cells written as text.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "text_grid.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace life;
+using namespace life::testing;
+
+TEST_CASE("Grids in the cell format span many leaves", "[text_grid]") {
+  for (auto leaf : {cells::glider(), cells::beacon(), cells::loaf()}) {
+    auto text = std::string{};
+    for (auto y = 0; y < cells::rows; ++y) {
+      for (auto x = 0; x < cells::columns; ++x)
+        text += leaf(x, y) ? '*' : '.';
+      text += '$';
+    }
+    auto blocks = parse_rokicki(text);
+    REQUIRE(blocks.size() == 1);
+    REQUIRE(blocks.front().contents == leaf);
+  }
+
+  auto blocks =
+      parse_rokicki("$$...*$..*$..***" + std::string(21, '$') + ".........*");
+  REQUIRE(blocks.size() == 2);
+  REQUIRE(blocks[0].contents == cells::glider());
+  REQUIRE(blocks[1].x == 8);
+  REQUIRE(blocks[1].y == 24);
+  REQUIRE(blocks[1].contents == cells{"$.*"});
+
+  REQUIRE_THROWS_AS(parse_rokicki("..*..o..*"), std::domain_error);
+}
+
+TEST_CASE("Whitespace in the cell format takes up no column", "[text_grid]") {
+  REQUIRE(parse_rokicki(" *").front().contents == cells{"*"});
+  REQUIRE(parse_rokicki("..*$\n.*.$").front().contents == cells{"..*$.*.$"});
+
+  auto engine = std::mt19937{31};
+  auto coin = std::bernoulli_distribution{0.5};
+  auto spaces = std::uniform_int_distribution<std::size_t>{0, 3};
+  for (auto i = 0; i < 100; ++i) {
+    auto text = std::string{};
+    for (auto y = 0; y < cells::rows; ++y) {
+      for (auto x = 0; x < cells::columns; ++x)
+        text += std::string{coin(engine) ? '*' : '.'} +
+                std::string{" \t\n"}.substr(0, spaces(engine));
+      text += '$';
+    }
+    auto blocks = parse_rokicki(text);
+    auto expected = cells{text};
+    REQUIRE(blocks.size() == (expected.bits() != 0));
+    if (!blocks.empty())
+      REQUIRE(blocks.front().contents == expected);
+  }
+}
+
+TEST_CASE("Plaintext grids are read a word at a time", "[text_grid]") {
+  auto engine = std::mt19937{29};
+  auto coin = std::bernoulli_distribution{0.35};
+  auto length = std::uniform_int_distribution<int>{0, 90};
+  auto expected = coordinates{};
+  auto text = std::string{"!Name: soup\r\n!\r\n"};
+  for (auto y = 0; y < 77; ++y) {
+    auto columns = length(engine);
+    for (auto x = 0; x < columns; ++x) {
+      auto alive = coin(engine);
+      text += alive ? (x % 13 == 0 ? '*' : 'O') : (x % 17 == 0 ? ' ' : '.');
+      if (alive)
+        expected.insert({x, y});
+    }
+    text += y % 2 ? "\r\n" : "\n";
+  }
+
+  auto blocks = parse_plaintext(text);
+  REQUIRE(living(blocks) == expected);
+  for (auto i = std::size_t{1}; i < blocks.size(); ++i)
+    REQUIRE(std::pair{blocks[i - 1].y, blocks[i - 1].x} <
+            std::pair{blocks[i].y, blocks[i].x});
+
+  REQUIRE_THROWS_AS(parse_plaintext(".O.\n.X.\n"), std::domain_error);
+}
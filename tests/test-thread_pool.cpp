@@ -0,0 +1,95 @@
+/**
+ * Hashlife
+ * Tests for the thread pool.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace life;
+
+TEST_CASE("Jobs run once on every worker", "[thread_pool]") {
+  auto pool = thread_pool{4};
+  REQUIRE(pool.size() == 4);
+  REQUIRE(!pool.pinned());
+
+  for (auto round = 0; round < 50; ++round) {
+    auto visits = std::vector<std::atomic<int>>(4);
+    pool.run([&](std::size_t worker) { ++visits[worker]; });
+    for (const auto &count : visits)
+      REQUIRE(count == 1);
+  }
+
+  auto threads = std::set<std::thread::id>{};
+  auto ids = std::vector<std::thread::id>(4);
+  pool.run([&](std::size_t worker) {
+    ids[worker] = std::this_thread::get_id();
+  });
+  threads.insert(ids.begin(), ids.end());
+  REQUIRE(threads.size() == 4);
+  REQUIRE(threads.count(std::this_thread::get_id()) == 0);
+}
+
+TEST_CASE("Exceptions of workers reach the caller", "[thread_pool]") {
+  auto pool = thread_pool{3};
+  auto failing = [](std::size_t worker) {
+    if (worker == 1)
+      throw std::runtime_error{"worker failed"};
+  };
+  REQUIRE_THROWS_AS(pool.run(failing), std::runtime_error);
+  auto ran = std::atomic<int>{0};
+  pool.run([&](std::size_t) { ++ran; });
+  REQUIRE(ran == 3);
+  REQUIRE_THROWS_AS(thread_pool{0}, std::domain_error);
+}
+
+TEST_CASE("Workers are pinned across NUMA nodes", "[thread_pool]") {
+  const auto nodes = thread_pool::numa_nodes();
+  REQUIRE(!nodes.empty());
+  REQUIRE(!nodes.front().empty());
+
+  const auto cpus = thread_pool::spread(5);
+  REQUIRE(cpus.size() == 5);
+  auto pool = thread_pool{5, cpus};
+  REQUIRE(pool.pinned());
+  for (auto worker = 0u; worker < 5; ++worker) {
+    REQUIRE(pool.cpu(worker) == cpus[worker]);
+    REQUIRE(pool.node(worker) < nodes.size());
+  }
+  REQUIRE(pool.node(0) == 0);
+}
+
+TEST_CASE("Nodes without CPUs are left out", "[thread_pool]") {
+  REQUIRE(thread_pool::spread({{}, {3}, {}}, 3) ==
+          std::vector<unsigned>{3, 3, 3});
+
+  const auto cpus = thread_pool::spread({{}, {}}, 4);
+  REQUIRE(cpus.size() == 4);
+  const auto available = std::max(1u, std::thread::hardware_concurrency());
+  for (auto cpu : cpus)
+    REQUIRE(cpu < available);
+
+  REQUIRE_THROWS_AS((thread_pool{1, {1u << 20}}), std::runtime_error);
+}
@@ -0,0 +1,84 @@
+/**
+ * Hashlife
+ * Tests for the sparse tile engine.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "tile_engine.hpp"
+#include "universe.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+using namespace life;
+using namespace life::testing;
+
+TEST_CASE("Tile cells can be set and read back", "[tile_engine]") {
+  auto tiles = tile_engine{};
+  tiles.set(0, 0);
+  tiles.set(-1, -1);
+  tiles.set(-9, 17);
+  REQUIRE(tiles.get(0, 0));
+  REQUIRE(tiles.get(-1, -1));
+  REQUIRE(tiles.get(-9, 17));
+  REQUIRE(!tiles.get(1, 0));
+  REQUIRE(tiles.population() == 3);
+  REQUIRE(tiles.size() == 3);
+
+  REQUIRE(tiles.block(-8, -8) == cells{std::uint64_t{1} << 63});
+  REQUIRE_THROWS_AS(tiles.block(-1, 0), std::domain_error);
+  tiles.set(0, 0, false);
+  REQUIRE(tiles.population() == 2);
+}
+
+TEST_CASE("Tiles follow the life rules", "[tile_engine]") {
+  auto tiles = tile_engine{};
+  auto life = universe{};
+  for (auto [x, y] : random_soup(40, 13))
+    tiles.set(x, y), life.set(x, y);
+
+  for (auto generations : {1u, 1u, 2u, 5u, 8u, 31u}) {
+    tiles.advance(generations);
+    life.advance(generations);
+    REQUIRE(tiles.generation() == life.generation());
+    REQUIRE(tiles.population() == life.population());
+    tiles.for_each_block([&](auto x, auto y, cells block) {
+      REQUIRE(life.block(x, y) == block);
+    });
+  }
+}
+
+TEST_CASE("Stable tiles are not recomputed", "[tile_engine]") {
+  auto tiles = tile_engine{};
+  tiles.set_block(0, 0, cells::block());
+  tiles.set_block(80, 0, cells::blinker());
+  tiles.step();
+  tiles.step();
+  REQUIRE(tiles.active() == 1);
+  REQUIRE(tiles.size() == 2);
+  REQUIRE(tiles.block(0, 0) == cells::block());
+  REQUIRE(tiles.block(80, 0) == cells::blinker());
+
+  tiles.set_block(80, 0, cells::empty_square());
+  tiles.step();
+  tiles.step();
+  REQUIRE(tiles.active() == 0);
+  REQUIRE(tiles.size() == 1);
+  REQUIRE(tiles.population() == 4);
+}
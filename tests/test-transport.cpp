@@ -0,0 +1,87 @@
+/**
+ * Hashlife
+ * Tests for the transports between processes.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "catch2/catch.hpp"
+
+#include "transport.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace life;
+
+TEST_CASE("Sockets carry whole messages", "[transport]") {
+  auto [left, right] = socket_transport::pair();
+  auto message = std::vector<std::uint64_t>{};
+
+  left->send({1, 2, 3});
+  left->send({});
+  auto large = std::vector<std::uint64_t>(1 << 16);
+  for (auto i = 0u; i < large.size(); ++i)
+    large[i] = i * 0x9e3779b97f4a7c15;
+  auto sender = std::thread{[&, &left = left] { left->send(large); }};
+
+  REQUIRE(right->receive(message));
+  REQUIRE(message == std::vector<std::uint64_t>{1, 2, 3});
+  REQUIRE(right->receive(message));
+  REQUIRE(message.empty());
+  REQUIRE(right->receive(message));
+  REQUIRE(message == large);
+  sender.join();
+
+  right->send({4});
+  REQUIRE(left->receive(message));
+  REQUIRE(message == std::vector<std::uint64_t>{4});
+
+  SECTION("Receiving stops once the other end hangs up") {
+    left.reset();
+    REQUIRE(!right->receive(message));
+    REQUIRE_THROWS_AS(right->send({5}), std::runtime_error);
+  }
+}
+
+TEST_CASE("Sockets connect by path", "[transport]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.sock";
+  auto accepted = std::unique_ptr<socket_transport>{};
+  auto listener = std::thread{
+      [&] { accepted = socket_transport::accept(path.string()); }};
+
+  auto connected = std::unique_ptr<socket_transport>{};
+  for (auto attempt = 0; !connected; ++attempt) {
+    try {
+      connected = socket_transport::connect(path.string());
+    } catch (const std::runtime_error &) {
+      REQUIRE(attempt < 1000);
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+  listener.join();
+  REQUIRE(!std::filesystem::exists(path));
+
+  auto message = std::vector<std::uint64_t>{};
+  connected->send({7, 8});
+  REQUIRE(accepted->receive(message));
+  REQUIRE(message == std::vector<std::uint64_t>{7, 8});
+}
@@ -0,0 +1,795 @@
+/**
+ * Hashlife
+ * Tests for the hashlife universe.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "helpers.hpp"
+#include "shard_server.hpp"
+#include "snapshot.hpp"
+#include "transport.hpp"
+#include "universe.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace life;
+using namespace life::testing;
+
+
+TEST_CASE("Cells can be set and read back", "[universe-cells]") {
+  auto life = universe{};
+
+  REQUIRE(life.population() == 0);
+  REQUIRE(!life.get(0, 0));
+
+  life.set(0, 0);
+  life.set(-5, 3);
+  life.set(1000, -5000);
+
+  REQUIRE(life.get(0, 0));
+  REQUIRE(life.get(-5, 3));
+  REQUIRE(life.get(1000, -5000));
+  REQUIRE(!life.get(1, 0));
+  REQUIRE(life.population() == 3);
+
+  life.set(0, 0, false);
+  REQUIRE(!life.get(0, 0));
+  REQUIRE(life.population() == 2);
+}
+
+TEST_CASE("Universe follows the life rules", "[universe-advance]") {
+  auto life = universe{};
+
+  SECTION("Glider moves one cell diagonally every four generations") {
+    auto glider = coordinates{{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}};
+    for (auto [x, y] : glider)
+      life.set(x, y);
+
+    life.advance(4);
+    REQUIRE(life.generation() == 4);
+    REQUIRE(life.population() == 5);
+    for (auto [x, y] : glider)
+      REQUIRE(life.get(x + 1, y + 1));
+
+    life.advance(400);
+    REQUIRE(life.population() == 5);
+    for (auto [x, y] : glider)
+      REQUIRE(life.get(x + 101, y + 101));
+  }
+
+  SECTION("Random soup matches the reference implementation") {
+    auto alive = random_soup(40, 1);
+    for (auto [x, y] : alive)
+      life.set(x, y);
+
+    for (auto generations : {1u, 2u, 3u, 8u, 13u, 37u}) {
+      life.advance(generations);
+      for (auto i = 0u; i < generations; ++i)
+        alive = reference_step(alive);
+
+      REQUIRE(life.population() == alive.size());
+      for (auto [x, y] : alive)
+        REQUIRE(life.get(x, y));
+    }
+  }
+}
+
+TEST_CASE("Universe follows rule tables", "[universe-rule]") {
+  auto rule = rule_table::parse("B2-a3/S12-e3ij4nz");
+  auto life = universe{rule};
+  REQUIRE(life.rule() == rule);
+  REQUIRE(universe{}.rule() == rule_table::conway());
+  REQUIRE_THROWS_AS(life.cache_results_to("unused.cache"), std::domain_error);
+
+  auto alive = random_soup(16, 47);
+  for (auto [x, y] : alive)
+    life.set(x, y);
+
+  for (auto generations : {1u, 2u, 3u, 8u, 13u}) {
+    life.advance(generations);
+    for (auto i = 0u; i < generations; ++i) {
+      auto next = coordinates{};
+      auto minimum = std::numeric_limits<std::int64_t>::max();
+      auto maximum = std::numeric_limits<std::int64_t>::min();
+      for (auto [x, y] : alive) {
+        minimum = std::min({minimum, x, y});
+        maximum = std::max({maximum, x, y});
+      }
+      for (auto y = minimum - 1; y <= maximum + 1; ++y) {
+        for (auto x = minimum - 1; x <= maximum + 1; ++x) {
+          auto neighbourhood = std::uint32_t{0};
+          for (auto dy = -1; dy <= 1; ++dy)
+            for (auto dx = -1; dx <= 1; ++dx)
+              if (alive.count({x + dx, y + dy}))
+                neighbourhood |= 1u << ((dx + 1) + 3 * (dy + 1));
+          if (rule(neighbourhood))
+            next.insert({x, y});
+        }
+      }
+      alive = std::move(next);
+    }
+
+    REQUIRE(life.population() == alive.size());
+    for (auto [x, y] : alive)
+      REQUIRE(life.get(x, y));
+  }
+}
+
+TEST_CASE("Each level has its own table", "[universe-layers]") {
+  auto life = universe{};
+  for (auto [x, y] : random_soup(128, 2))
+    life.set(x, y);
+  life.advance(100);
+
+  auto statistics = life.statistics();
+  REQUIRE(statistics.size() > life.level());
+  for (const auto &level : statistics)
+    REQUIRE(level.size <= level.capacity);
+  REQUIRE(statistics.front().lookups > 0);
+}
+
+TEST_CASE("Memo hits and misses are counted", "[universe-memo]") {
+  auto run = [](std::size_t copies) {
+    auto life = universe{};
+    for (auto copy = 0; copy < static_cast<int>(copies); ++copy)
+      for (auto [x, y] : random_soup(32, 3))
+        life.set(x + 1024 * copy, y);
+    REQUIRE(life.memo_usage().hits == 0);
+    REQUIRE(life.memo_usage().misses == 0);
+    life.advance(100);
+    return life.memo_usage();
+  };
+
+  auto single = run(1), twice = run(2);
+  REQUIRE(single.misses > 0);
+  REQUIRE(twice.hits > single.hits);
+  REQUIRE(twice.misses < 2 * single.misses);
+}
+
+TEST_CASE("Reference counting reclaims unused nodes", "[universe-counted]") {
+  auto counted = universe{lifetime::counted};
+  auto unmanaged = universe{};
+  auto alive = random_soup(24, 3);
+  for (auto [x, y] : alive) {
+    counted.set(x, y);
+    unmanaged.set(x, y);
+  }
+
+  auto nodes = [](const universe &life) {
+    auto total = std::size_t{0};
+    for (const auto &level : life.statistics())
+      total += level.size;
+    return total;
+  };
+
+  SECTION("Reclamation is bounded by its budget") {
+    auto before = nodes(counted);
+    REQUIRE(counted.reclaim(10) == 10);
+    REQUIRE(nodes(counted) == before - 10);
+  }
+
+  SECTION("Reclaimed universes keep evolving correctly") {
+    for (auto generations : {5u, 16u, 7u}) {
+      counted.advance(generations);
+      unmanaged.advance(generations);
+      counted.reclaim();
+      for (auto i = 0u; i < generations; ++i)
+        alive = reference_step(alive);
+
+      REQUIRE(counted.population() == alive.size());
+      for (auto [x, y] : alive)
+        REQUIRE(counted.get(x, y));
+    }
+    REQUIRE(nodes(counted) < nodes(unmanaged));
+    REQUIRE(counted.reclaim() == 0);
+  }
+}
+
+TEST_CASE("Generational collection promotes only survivors",
+          "[universe-generational]") {
+  auto generational = universe{lifetime::generational};
+  auto unmanaged = universe{};
+  auto alive = random_soup(24, 5);
+  for (auto [x, y] : alive) {
+    generational.set(x, y);
+    unmanaged.set(x, y);
+  }
+
+  auto nodes = [](const universe &life) {
+    auto total = std::size_t{0};
+    for (const auto &level : life.statistics())
+      total += level.size;
+    return total;
+  };
+
+  for (auto generations : {5u, 16u, 7u, 32u}) {
+    generational.advance(generations);
+    unmanaged.advance(generations);
+    for (auto i = 0u; i < generations; ++i)
+      alive = reference_step(alive);
+
+    REQUIRE(generational.population() == alive.size());
+    for (auto [x, y] : alive)
+      REQUIRE(generational.get(x, y));
+  }
+
+  auto promoted = std::size_t{0};
+  for (const auto &level : generational.statistics())
+    promoted += level.promoted;
+  REQUIRE(promoted == nodes(generational));
+  REQUIRE(nodes(generational) < nodes(unmanaged));
+}
+
+TEST_CASE("Cold nodes can be spilled to disk", "[universe-spill]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.spill";
+  auto life = universe{};
+  life.spill_to(path.string());
+  auto alive = random_soup(24, 7);
+  for (auto [x, y] : alive)
+    life.set(x, y);
+
+  SECTION("Only unmanaged universes spill") {
+    auto counted = universe{lifetime::counted};
+    REQUIRE_THROWS_AS(counted.spill_to(path.string()), std::domain_error);
+  }
+
+  SECTION("Spilled universes keep evolving correctly") {
+    for (auto generations : {5u, 16u, 7u, 32u}) {
+      life.advance(generations);
+      auto spilled = life.spill(0);
+      for (auto i = 0u; i < generations; ++i)
+        alive = reference_step(alive);
+
+      REQUIRE(spilled > 0);
+      REQUIRE(life.population() == alive.size());
+      REQUIRE(life.snapshot().population() == alive.size());
+      for (auto [x, y] : alive)
+        REQUIRE(life.get(x, y));
+    }
+
+    auto spilled = std::size_t{0};
+    for (const auto &level : life.statistics())
+      spilled += level.spilled;
+    REQUIRE(spilled > 0);
+  }
+
+  SECTION("Recently accessed nodes stay in memory") {
+    REQUIRE(life.spill(1000) == 0);
+  }
+
+  SECTION("Results of spilled nodes are computed once") {
+    // Repeats a single tile, so that each level shares a single spilled node
+    auto tiled = universe{};
+    auto twin = universe{};
+    tiled.spill_to(path.string());
+    for (auto y = -128; y < 128; y += 32)
+      for (auto x = -128; x < 128; x += 32)
+        for (auto [dx, dy] : random_soup(0, 0, 12, 12, 5)) {
+          tiled.set(x + dx, y + dy);
+          twin.set(x + dx, y + dy);
+        }
+
+    REQUIRE(tiled.spill(0) > 0);
+    tiled.advance(64);
+    twin.advance(64);
+    REQUIRE(tiled.population() == twin.population());
+    INFO(tiled.memo_usage().misses);
+    INFO(twin.memo_usage().misses);
+    REQUIRE(tiled.memo_usage().misses < 2 * twin.memo_usage().misses);
+  }
+}
+
+TEST_CASE("Checkpoints only log what is new", "[universe-checkpoint]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.log";
+  auto life = universe{lifetime::counted};
+  life.journal_to(path.string());
+  auto alive = random_soup(24, 11);
+  for (auto [x, y] : alive)
+    life.set(x, y);
+
+  SECTION("Journaled universes cannot spill") {
+    REQUIRE_THROWS_AS(life.spill_to(path.string() + ".spill"),
+                      std::domain_error);
+    auto generational = universe{lifetime::generational};
+    REQUIRE_THROWS_AS(generational.journal_to(path.string()),
+                      std::domain_error);
+  }
+
+  SECTION("Replaying restores the last checkpoint") {
+    REQUIRE(life.checkpoint() > 0);
+    life.advance(13);
+    auto incremental = life.checkpoint();
+    REQUIRE(incremental > 0);
+    REQUIRE(life.checkpoint() == 0);
+    for (auto i = 0u; i < 13; ++i)
+      alive = reference_step(alive);
+
+    auto replayed = checkpoint_log::replay(path.string());
+    REQUIRE(replayed.generation() == 13);
+    REQUIRE(replayed.population() == alive.size());
+    for (auto [x, y] : alive)
+      REQUIRE(replayed.get(x, y));
+
+    auto restored = universe{replayed};
+    REQUIRE(restored.generation() == 13);
+    restored.advance(21);
+    for (auto i = 0u; i < 21; ++i)
+      alive = reference_step(alive);
+    REQUIRE(restored.population() == alive.size());
+    for (auto [x, y] : alive)
+      REQUIRE(restored.get(x, y));
+  }
+
+  SECTION("Small changes make small checkpoints") {
+    auto full = life.checkpoint();
+    life.set(3, 5, !life.get(3, 5));
+    auto incremental = life.checkpoint();
+    REQUIRE(incremental <= life.level() + 1);
+    REQUIRE(incremental < full);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Results are reused across runs", "[universe-results]") {
+  auto path = std::filesystem::temp_directory_path() / "hashlife-test.cache";
+  std::filesystem::remove(path);
+  auto alive = random_soup(24, 13);
+  auto expected = alive;
+  for (auto i = 0u; i < 45; ++i)
+    expected = reference_step(expected);
+
+  auto run = [&](lifetime mode) {
+    auto life = universe{mode};
+    life.cache_results_to(path.string(), 2);
+    for (auto [x, y] : alive)
+      life.set(x, y);
+    life.advance(45);
+    REQUIRE(life.population() == expected.size());
+    for (auto [x, y] : expected)
+      REQUIRE(life.get(x, y));
+
+    auto lookups = std::size_t{0};
+    for (const auto &level : life.statistics())
+      lookups += level.lookups;
+    return lookups;
+  };
+
+  auto computed = run(lifetime::unmanaged);
+  auto size = std::filesystem::file_size(path);
+  REQUIRE(size > 0);
+  REQUIRE(run(lifetime::counted) < computed);
+  REQUIRE(std::filesystem::file_size(path) == size);
+
+  SECTION("Only nodes that stay in place can be hashed") {
+    auto generational = universe{lifetime::generational};
+    REQUIRE_THROWS_AS(generational.cache_results_to(path.string()),
+                      std::domain_error);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Universes can share their nodes", "[universe-shared]") {
+  auto name = std::string{"/hashlife-test-universe"};
+  universe::remove_shared(name);
+  auto alive = random_soup(24, 17);
+  auto expected = alive;
+  for (auto i = 0u; i < 37; ++i)
+    expected = reference_step(expected);
+
+  auto run = [&] {
+    auto life = universe{name, 1 << 14};
+    for (auto [x, y] : alive)
+      life.set(x, y);
+    life.advance(37);
+    REQUIRE(life.population() == expected.size());
+    for (auto [x, y] : expected)
+      REQUIRE(life.get(x, y));
+
+    auto lookups = std::size_t{0};
+    for (const auto &level : life.statistics())
+      lookups += level.lookups;
+    return std::pair{life.statistics().front().size, lookups};
+  };
+
+  auto [size, lookups] = run();
+  auto [shared_size, shared_lookups] = run();
+  REQUIRE(shared_size == size);
+  REQUIRE(shared_lookups < lookups);
+
+  SECTION("Shared stores do not grow") {
+    auto life = universe{name + "-small", 16};
+    REQUIRE_THROWS_AS(
+        [&] {
+          for (auto [x, y] : alive)
+            life.set(x, y);
+        }(),
+        std::length_error);
+    universe::remove_shared(name + "-small");
+  }
+
+  SECTION("Shared nodes cannot be spilled") {
+    auto life = universe{name, 1 << 14};
+    REQUIRE_THROWS_AS(life.spill_to(name), std::domain_error);
+  }
+
+  universe::remove_shared(name);
+}
+
+TEST_CASE("Blocks can be set in bulk", "[universe-blocks]") {
+  auto engine = std::mt19937{23};
+  auto bits = std::uniform_int_distribution<std::uint64_t>{};
+  auto blocks = std::vector<placed_block>{};
+  for (auto y = -64; y < 96; y += 8)
+    for (auto x = -200; x < 40; x += 8)
+      if (bits(engine) % 3 == 0)
+        blocks.push_back({x, y, cells{bits(engine)}});
+  blocks.push_back({blocks.front().x, blocks.front().y, cells::glider()});
+
+  auto expected = universe{};
+  expected.set(1000, 1000);
+  for (const auto &block : blocks)
+    expected.set_block(block.x, block.y, block.contents);
+
+  auto life = universe{};
+  life.set(1000, 1000);
+  life.set_blocks(blocks);
+  REQUIRE(life.level() == expected.level());
+  REQUIRE(life.population() == expected.population());
+  for (const auto &block : blocks)
+    REQUIRE(life.block(block.x, block.y) == expected.block(block.x, block.y));
+  REQUIRE(life.get(1000, 1000));
+
+  blocks.push_back({3, 0, cells::glider()});
+  REQUIRE_THROWS_AS(life.set_blocks(blocks), std::domain_error);
+}
+
+TEST_CASE("Universes can be built from bitmaps", "[universe-bitmap]") {
+  constexpr auto width = std::size_t{77}, height = std::size_t{45};
+  constexpr auto stride = std::size_t{16};
+  auto engine = std::mt19937{31};
+  auto bytes = std::uniform_int_distribution<unsigned>{0, 255};
+  auto bitmap = std::vector<std::uint8_t>(stride * height);
+  for (auto &byte : bitmap)
+    byte = static_cast<std::uint8_t>(bytes(engine));
+  for (auto y = std::size_t{16}; y < 32; ++y) // Two bands of empty tiles
+    for (auto x = std::size_t{0}; x < stride; ++x)
+      bitmap[y * stride + x] = 0;
+
+  auto expected = coordinates{};
+  for (auto y = std::size_t{0}; y < height; ++y)
+    for (auto x = std::size_t{0}; x < width; ++x)
+      if ((bitmap[y * stride + x / 8] >> (x % 8)) & 1u)
+        expected.insert({x, y});
+
+  for (auto threads : {1u, 3u}) {
+    auto life = universe{};
+    life.set(-50, -50);
+    life.build_from_bitmap(bitmap.data(), width, height, stride, threads);
+    REQUIRE(life.population() == expected.size());
+    for (auto [x, y] : expected)
+      REQUIRE(life.get(x, y));
+  }
+
+  auto life = universe{};
+  REQUIRE_THROWS_AS(life.build_from_bitmap(bitmap.data(), 200, 1, stride),
+                    std::domain_error);
+}
+
+TEST_CASE("Universes can be spread over processes",
+          "[universe-distributed]") {
+  auto alive = random_soup(24, 19);
+  auto expected = alive;
+  for (auto i = 0u; i < 41; ++i)
+    expected = reference_step(expected);
+
+  auto check = [&](universe &life) {
+    for (auto [x, y] : alive)
+      life.set(x, y);
+    life.advance(41);
+    REQUIRE(life.population() == expected.size());
+    for (auto [x, y] : expected)
+      REQUIRE(life.get(x, y));
+  };
+
+  SECTION("Shards on other threads share the work") {
+    auto servers = std::vector<std::unique_ptr<shard_server>>{};
+    auto links = std::vector<std::unique_ptr<transport>>{};
+    for (auto shard = 0; shard < 2; ++shard) {
+      auto [client, server] = socket_transport::pair();
+      servers.push_back(std::make_unique<shard_server>(std::move(server)));
+      links.push_back(std::move(client));
+    }
+    auto threads = std::vector<std::thread>{};
+    for (auto &server : servers)
+      threads.emplace_back([&server] { server->serve(); });
+
+    {
+      auto life = universe{};
+      life.distribute(std::move(links), 2);
+      check(life);
+
+      // Remote results are kept, so asking again costs no round trip
+      auto requested = servers[0]->requested() + servers[1]->requested();
+      life.clear();
+      check(life);
+      REQUIRE(servers[0]->requested() + servers[1]->requested() == requested);
+    }
+    for (auto &thread : threads)
+      thread.join();
+    REQUIRE(servers[0]->evaluated() > 0);
+    REQUIRE(servers[1]->evaluated() > 0);
+  }
+
+  SECTION("Records crossing the connections stay bounded") {
+    auto [client, server] = socket_transport::pair();
+    auto shard = shard_server{std::move(server)};
+    auto thread = std::thread{[&shard] { shard.serve(); }};
+    {
+      auto links = std::vector<std::unique_ptr<transport>>{};
+      links.push_back(std::move(client));
+      auto life = universe{lifetime::counted}, local = universe{};
+      life.distribute(std::move(links), 2, 500);
+      for (auto [x, y] : random_soup(64, 23))
+        life.set(x, y), local.set(x, y);
+      // Both ends read the same messages, so the shard mirrors the client
+      for (auto i = 0; i < 60; ++i) {
+        life.advance(8);
+        local.advance(8);
+        REQUIRE(shard.records().size() < 1000);
+      }
+      REQUIRE(life.population() == local.population());
+    }
+    thread.join();
+  }
+
+  SECTION("Shards may be separate processes") {
+    auto [client, server] = socket_transport::pair();
+    auto child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+      client.reset();
+      try {
+        shard_server{std::move(server)}.serve();
+      } catch (...) {
+        ::_exit(1);
+      }
+      ::_exit(0);
+    }
+    server.reset();
+
+    {
+      auto links = std::vector<std::unique_ptr<transport>>{};
+      links.push_back(std::move(client));
+      auto life = universe{lifetime::counted};
+      life.distribute(std::move(links), 2);
+      check(life);
+    }
+    auto status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+  }
+
+  SECTION("Only nodes that stay in place can be distributed") {
+    auto [client, server] = socket_transport::pair();
+    auto links = std::vector<std::unique_ptr<transport>>{};
+    links.push_back(std::move(client));
+    auto generational = universe{lifetime::generational};
+    REQUIRE_THROWS_AS(generational.distribute(std::move(links)),
+                      std::domain_error);
+  }
+}
+
+TEST_CASE("Regions are computed within their lightcone",
+          "[universe-region]") {
+  auto life = universe{};
+  auto alive = random_soup(64, 5);
+  for (auto [x, y] : alive)
+    life.set(x, y);
+
+  SECTION("Regions match the reference implementation") {
+    auto window = rectangle{-20, 3, 37, 21};
+    auto generation = std::uint64_t{0};
+    for (auto target : {0u, 1u, 6u, 29u, 100u}) {
+      for (; generation < target; ++generation)
+        alive = reference_step(alive);
+      auto region = life.query_region(window, target);
+      REQUIRE(region.size() == 37 * 21);
+      for (auto row = 0; row < window.height; ++row)
+        for (auto column = 0; column < window.width; ++column)
+          REQUIRE(region[row * window.width + column] ==
+                  (alive.count({window.left + column, window.top + row}) != 0));
+    }
+    REQUIRE(life.generation() == 0);
+    REQUIRE(life.population() == random_soup(64, 5).size());
+  }
+
+  SECTION("Regions far from the pattern stay out of reach") {
+    auto region = life.query_region({1000, -1000, 8, 8}, 50);
+    REQUIRE(std::none_of(region.begin(), region.end(),
+                         [](bool cell) { return cell; }));
+  }
+
+  SECTION("Small regions are cheaper than advancing") {
+    auto soup = random_soup(256, 6);
+    auto large = universe{}, small = universe{};
+    for (auto [x, y] : soup)
+      large.set(x, y), small.set(x, y);
+    large.advance(32);
+    auto region = small.query_region({0, 0, 16, 16}, 32);
+    REQUIRE(small.statistics()[0].size < large.statistics()[0].size / 2);
+    for (auto y = 0; y < 16; ++y)
+      for (auto x = 0; x < 16; ++x)
+        REQUIRE(region[y * 16 + x] == large.get(x, y));
+  }
+
+  REQUIRE_THROWS_AS(life.query_region({0, 0, -1, 1}, 1), std::domain_error);
+  life.advance(2);
+  REQUIRE_THROWS_AS(life.query_region({0, 0, 1, 1}, 1), std::domain_error);
+}
+
+TEST_CASE("Universes advance asynchronously", "[universe-async]") {
+  auto life = universe{}, reference = universe{};
+  for (auto [x, y] : random_soup(128, 7))
+    life.set(x, y), reference.set(x, y);
+  auto full = std::make_shared<advance_progress>();
+  reference.advance_async(1000, full).get();
+
+  SECTION("Asynchronous advances report their progress") {
+    auto progress = std::make_shared<advance_progress>();
+    auto result = life.advance_async(1000, progress);
+    REQUIRE(result.get() == 1000);
+    REQUIRE(progress->generation() == 1000);
+    REQUIRE(progress->evaluated() > 0);
+    REQUIRE(life.population() == reference.population());
+    REQUIRE(life.advance_async(0).get() == 1000);
+  }
+
+  SECTION("Cancelled advances stop at a completed jump") {
+    auto progress = std::make_shared<advance_progress>();
+    progress->cancel();
+    REQUIRE(life.advance_async(1000, progress).get() == 0);
+    REQUIRE(progress->cancelled());
+    REQUIRE(life.generation() == 0);
+
+    // The full run evaluates tens of thousands of nodes, so it is still far
+    // from done when the first thousand have been
+    REQUIRE(full->evaluated() > 20000);
+    progress = std::make_shared<advance_progress>();
+    auto result = life.advance_async(1000, progress);
+    while (progress->evaluated() < 1000)
+      std::this_thread::yield();
+    progress->cancel();
+    auto reached = result.get();
+    REQUIRE(reached < 1000);
+    REQUIRE(life.generation() == reached);
+
+    // What was evaluated before the cancellation stays memoized
+    auto resumed = std::make_shared<advance_progress>();
+    REQUIRE(life.advance_async(1000 - reached, resumed).get() == 1000);
+    REQUIRE(resumed->evaluated() < full->evaluated());
+    REQUIRE(life.population() == reference.population());
+    for (auto y = -256; y < 256; y += 8)
+      for (auto x = -256; x < 256; x += 8)
+        REQUIRE(life.block(x, y) == reference.block(x, y));
+  }
+}
+
+TEST_CASE("Advances can be spread over time budgets", "[universe-paced]") {
+  auto life = universe{}, reference = universe{};
+  for (auto [x, y] : random_soup(128, 8))
+    life.set(x, y), reference.set(x, y);
+  reference.advance(1000);
+
+  auto remaining = std::uint64_t{1000};
+  auto calls = 0;
+  while (remaining != 0) {
+    auto advanced = life.advance_for(remaining, std::chrono::microseconds{50});
+    REQUIRE(advanced <= remaining);
+    remaining -= advanced;
+    ++calls;
+  }
+  REQUIRE(calls > 1);
+  REQUIRE(life.generation() == 1000);
+  REQUIRE(life.population() == reference.population());
+  for (auto y = -256; y < 256; y += 8)
+    for (auto x = -256; x < 256; x += 8)
+      REQUIRE(life.block(x, y) == reference.block(x, y));
+
+  REQUIRE(life.advance_for(8, std::chrono::seconds{10}) == 8);
+
+  // Interrupted jumps keep what they computed, even if it lies in a nursery
+  auto generational = universe{lifetime::generational};
+  for (auto [x, y] : random_soup(128, 8))
+    generational.set(x, y);
+  remaining = 1000;
+  for (calls = 0; remaining != 0 && calls < 10000; ++calls)
+    remaining -= generational.advance_for(remaining,
+                                          std::chrono::microseconds{50});
+  REQUIRE(remaining == 0);
+  REQUIRE(generational.population() == reference.population());
+}
+
+TEST_CASE("Pinned roots can be read while advancing", "[universe-pin]") {
+  auto soup = universe{};
+  for (auto [x, y] : random_soup(128, 9))
+    soup.set(x, y);
+  const auto expected = soup.snapshot();
+
+  for (auto mode :
+       {lifetime::unmanaged, lifetime::counted, lifetime::generational}) {
+    auto life = universe{expected, mode};
+
+    auto pinned = life.pin();
+    auto done = std::atomic<bool>{false};
+    auto mismatches = std::atomic<int>{0};
+    auto reader = std::thread{[&] {
+      do {
+        auto population = std::uint64_t{0};
+        pinned.for_each_block([&](auto, auto, cells block) {
+          population += block.population_count();
+        });
+        if (population != expected.population() ||
+            pinned.population() != expected.population())
+          ++mismatches;
+        std::this_thread::yield();
+      } while (!done);
+    }};
+
+    auto rehashes = [&] {
+      auto total = std::size_t{0};
+      for (const auto &level : life.statistics())
+        total += level.rehashes;
+      return total;
+    };
+    auto before = rehashes();
+    life.advance(300);
+    life.reclaim();
+    done = true;
+    reader.join();
+
+    if (mode == lifetime::unmanaged)
+      REQUIRE(rehashes() > before); // Tables were retired under the reader
+    REQUIRE(mismatches == 0);
+    REQUIRE(pinned.generation() == 0);
+    pinned.for_each_block([&](auto x, auto y, cells block) {
+      for (auto row = 0; row < 8; ++row)
+        for (auto column = 0; column < 8; ++column)
+          REQUIRE(block(column, row) == expected.get(x + column, y + row));
+    });
+    REQUIRE(pinned.get(-1, 5) == expected.get(-1, 5));
+
+    pinned = life.pin();
+    REQUIRE(pinned.generation() == 300);
+    REQUIRE(pinned.population() == life.population());
+  }
+}
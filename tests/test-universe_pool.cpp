@@ -0,0 +1,108 @@
+/**
+ * Hashlife
+ * Tests for pools of universes sharing their nodes.
+ *
+ * Copyright 2020 Quinten van Woerkom
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch2/catch.hpp"
+
+#include "snapshot.hpp"
+#include "universe_pool.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace life;
+
+namespace {
+constexpr auto glider = std::array<std::pair<std::int64_t, std::int64_t>, 5>{
+    {{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}}};
+
+void place_glider(universe_pool::handle &life, std::int64_t x,
+                  std::int64_t y) {
+  for (auto [dx, dy] : glider)
+    life.set(x + dx, y + dy);
+}
+
+/**
+ * Gliders move one cell diagonally every four generations.
+ */
+auto has_glider(const universe_pool::handle &life, std::int64_t x,
+                std::int64_t y) -> bool {
+  for (auto [dx, dy] : glider)
+    if (!life.get(x + dx, y + dy))
+      return false;
+  return true;
+}
+} // namespace
+
+TEST_CASE("Pooled universes evolve independently", "[universe_pool]") {
+  for (auto mode :
+       {lifetime::unmanaged, lifetime::counted, lifetime::generational}) {
+    auto pool = universe_pool{mode};
+    auto universes = std::vector<universe_pool::handle>{};
+    for (auto i = 0; i < 20; ++i) {
+      universes.push_back(pool.create());
+      place_glider(universes.back(), 3 * i, -i);
+    }
+    REQUIRE(pool.size() == 20);
+
+    for (auto i = 0; i < 20; ++i)
+      universes[i].advance(4 * (i + 1));
+    for (auto i = 0; i < 20; ++i) {
+      REQUIRE(universes[i].generation() == std::uint64_t(4 * (i + 1)));
+      REQUIRE(universes[i].population() == glider.size());
+      REQUIRE(universes[i].snapshot().population() == glider.size());
+      REQUIRE(has_glider(universes[i], 4 * i + 1, 1));
+    }
+  }
+}
+
+TEST_CASE("Pooled universes share their nodes", "[universe_pool]") {
+  auto pool = universe_pool{lifetime::counted};
+  auto universes = std::vector<universe_pool::handle>{};
+  for (auto i = 0; i < 50; ++i) {
+    universes.push_back(pool.create());
+    place_glider(universes.back(), 0, 0);
+    universes.back().advance(64);
+  }
+
+  SECTION("Identical universes are computed once") {
+    auto first = pool.statistics();
+    universes.push_back(pool.create());
+    place_glider(universes.back(), 0, 0);
+    universes.back().advance(64);
+    REQUIRE(has_glider(universes.back(), 16, 16));
+
+    auto second = pool.statistics();
+    for (auto level = 0u; level < first.size(); ++level)
+      REQUIRE(second[level].size == first[level].size);
+  }
+
+  SECTION("Released universes are reclaimed") {
+    pool.reclaim();
+    universes.erase(universes.begin() + 1, universes.end());
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.reclaim() == 0);
+
+    universes.clear();
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.reclaim() > 0);
+    REQUIRE(pool.create().population() == 0);
+  }
+}
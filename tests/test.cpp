@@ -18,6 +18,7 @@
  */
 
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch2/catch.hpp"
 
 TEST_CASE("Catch2 works", "[catch]") { REQUIRE(1 + 1 == 2); }
\ No newline at end of file